@@ -13,6 +13,7 @@
 #include <lcms2.h>
 
 #include "gcm-cell-renderer-color.h"
+#include "gcm-lcms.h"
 
 enum {
 	PROP_0,
@@ -55,20 +56,21 @@ gcm_cell_renderer_set_color (GcmCellRendererColor *renderer)
 	gint x, y;
 	guchar *pixels;
 	guint pos;
-	cmsHPROFILE profile_srgb = NULL;
-	cmsHPROFILE profile_lab = NULL;
-	cmsHTRANSFORM xform = NULL;
+	cmsHTRANSFORM xform;
+	g_autoptr(GError) error = NULL;
 
 	/* nothing set yet */
 	if (renderer->color == NULL)
 		goto out;
 
 	/* convert the color to sRGB */
-	profile_lab = cmsCreateLab2Profile (NULL);
-	profile_srgb = cmsCreate_sRGBProfile ();
-	xform = cmsCreateTransform (profile_lab, TYPE_Lab_DBL,
-				    profile_srgb, TYPE_RGB_8,
-				    INTENT_ABSOLUTE_COLORIMETRIC, 0);
+	xform = gcm_lcms_get_transform (GCM_LCMS_PROFILE_LAB2, TYPE_Lab_DBL,
+					GCM_LCMS_PROFILE_SRGB, TYPE_RGB_8,
+					INTENT_ABSOLUTE_COLORIMETRIC, &error);
+	if (xform == NULL) {
+		g_warning ("%s", error->message);
+		goto out;
+	}
 	cmsDoTransform (xform, renderer->color, &rgb, 1);
 
 	/* create a pixbuf of the right size */
@@ -86,12 +88,6 @@ gcm_cell_renderer_set_color (GcmCellRendererColor *renderer)
 	}
 out:
 	g_object_set (renderer, "pixbuf", pixbuf, NULL);
-	if (profile_srgb != NULL)
-		cmsCloseProfile (profile_srgb);
-	if (profile_lab != NULL)
-		cmsCloseProfile (profile_lab);
-	if (xform != NULL)
-		cmsDeleteTransform (xform);
 }
 
 static void
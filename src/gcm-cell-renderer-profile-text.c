@@ -10,6 +10,7 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
+#include <locale.h>
 
 #include "gcm-cell-renderer-profile-text.h"
 #include "gcm-utils.h"
@@ -25,6 +26,23 @@ G_DEFINE_TYPE (GcmCellRendererProfileText, gcm_cell_renderer_profile_text, GTK_T
 
 static gpointer parent_class = NULL;
 
+/* profile object path -> GcmCellRendererProfileTextItem */
+static GHashTable *markup_cache = NULL;
+
+typedef struct {
+	gchar		*locale;
+	gchar		*markup[2];	/* indexed by is_default */
+} GcmCellRendererProfileTextItem;
+
+static void
+gcm_cell_renderer_profile_text_item_free (GcmCellRendererProfileTextItem *item)
+{
+	g_free (item->locale);
+	g_free (item->markup[0]);
+	g_free (item->markup[1]);
+	g_free (item);
+}
+
 static void
 gcm_cell_renderer_profile_text_get_property (GObject *object, guint param_id,
 				        GValue *value, GParamSpec *pspec)
@@ -100,23 +118,91 @@ out:
 	return string;
 }
 
-static void
-gcm_cell_renderer_set_markup (GcmCellRendererProfileText *renderer)
+static gchar *
+gcm_cell_renderer_get_profile_markup (CdProfile *profile, gboolean is_default)
 {
 	GString *string;
 
 	/* do we have a profile to load? */
-	string = gcm_cell_renderer_get_profile_text (renderer->profile);
+	string = gcm_cell_renderer_get_profile_text (profile);
 
 	/* this is the default profile */
-	if (renderer->is_default) {
+	if (is_default) {
 		g_string_prepend (string, "<b>");
 		g_string_append (string, "</b>");
 	}
+	return g_string_free (string, FALSE);
+}
+
+static void
+gcm_cell_renderer_profile_changed_cb (CdProfile *profile, gpointer user_data)
+{
+	g_hash_table_remove (markup_cache, cd_profile_get_object_path (profile));
+}
+
+static const gchar *
+gcm_cell_renderer_get_profile_markup_cached (CdProfile *profile, gboolean is_default)
+{
+	GcmCellRendererProfileTextItem *item;
+	const gchar *locale;
+	const gchar *object_path;
+
+	/* not connected yet */
+	object_path = cd_profile_get_object_path (profile);
+	if (object_path == NULL)
+		return NULL;
+
+	/* a new proxy for this path may have newer properties than the one
+	 * the cached markup came from, and it needs its own signal */
+	if (g_object_get_data (G_OBJECT (profile), "GcmCellRendererProfileText") == NULL) {
+		g_object_set_data (G_OBJECT (profile), "GcmCellRendererProfileText",
+				   GINT_TO_POINTER (TRUE));
+		g_signal_connect (profile, "changed",
+				  G_CALLBACK (gcm_cell_renderer_profile_changed_cb), NULL);
+		g_hash_table_remove (markup_cache, object_path);
+	}
+
+	/* the translated prefixes depend on the locale */
+	locale = setlocale (LC_MESSAGES, NULL);
+	item = g_hash_table_lookup (markup_cache, object_path);
+	if (item != NULL && g_strcmp0 (item->locale, locale) != 0) {
+		g_hash_table_remove (markup_cache, object_path);
+		item = NULL;
+	}
+	if (item == NULL) {
+		item = g_new0 (GcmCellRendererProfileTextItem, 1);
+		item->locale = g_strdup (locale);
+		g_hash_table_insert (markup_cache, g_strdup (object_path), item);
+	}
+	if (item->markup[is_default] == NULL)
+		item->markup[is_default] = gcm_cell_renderer_get_profile_markup (profile, is_default);
+	return item->markup[is_default];
+}
+
+static void
+gcm_cell_renderer_set_markup (GcmCellRendererProfileText *renderer)
+{
+	const gchar *markup = NULL;
+	g_autofree gchar *tmp = NULL;
+
+	/* rows are re-rendered on every scroll, so reuse the markup */
+	if (renderer->profile != NULL) {
+		markup = gcm_cell_renderer_get_profile_markup_cached (renderer->profile,
+								      renderer->is_default ? 1 : 0);
+	}
+	if (markup == NULL) {
+		tmp = gcm_cell_renderer_get_profile_markup (renderer->profile,
+							    renderer->is_default);
+		markup = tmp;
+	}
+
+	/* no need to parse the markup again */
+	if (g_strcmp0 (renderer->markup, markup) == 0)
+		return;
 
 	/* assign */
 	g_free (renderer->markup);
-	renderer->markup = g_string_free (string, FALSE);
+	renderer->markup = g_strdup (markup);
 	g_object_set (renderer, "markup", renderer->markup, NULL);
 }
 
@@ -171,6 +257,10 @@ gcm_cell_renderer_profile_text_class_init (GcmCellRendererProfileTextClass *clas
 	g_object_class_install_property (object_class, PROP_IS_DEFAULT,
 					 g_param_spec_boolean ("is-default", "IS_DEFAULT",
 					 "IS_DEFAULT", FALSE, G_PARAM_READWRITE));
+
+	/* shared by all the renderers in the process */
+	markup_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					      (GDestroyNotify) gcm_cell_renderer_profile_text_item_free);
 }
 
 static void
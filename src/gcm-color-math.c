@@ -0,0 +1,606 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "gcm-color-math.h"
+
+/*
+ * Whole images and palettes are converted as planar arrays in single
+ * precision. The planar layout means four colors can be loaded from each
+ * channel and converted at once using the GCC vector extensions, with the
+ * scalar code finishing off any remainder. Generic vectors have no square
+ * root, so that is done for each lane, which is still a single instruction.
+ * The picker converts one color at a time, so it uses the double precision
+ * versions, which are also the reference for the arrays.
+ */
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+#define GCM_COLOR_MATH_HAVE_VECTOR	1
+typedef gfloat GcmColorMathFloat4 __attribute__ ((vector_size (16)));
+typedef gint32 GcmColorMathInt4 __attribute__ ((vector_size (16)));
+#endif
+
+/* the CIE values, rather than the rounded 0.008856 and 903.3 */
+#define GCM_COLOR_MATH_EPSILON		(216.0 / 24389.0)
+#define GCM_COLOR_MATH_KAPPA		(24389.0 / 27.0)
+
+/* the same as cmsD50_XYZ() */
+static const CdColorXYZ gcm_color_math_d50 = { 0.9642, 1.0, 0.8249 };
+
+static gdouble
+gcm_color_math_lab_f (gdouble t)
+{
+	if (t > GCM_COLOR_MATH_EPSILON)
+		return cbrt (t);
+	return (GCM_COLOR_MATH_KAPPA * t + 16.0) / 116.0;
+}
+
+static gdouble
+gcm_color_math_lab_f_inv (gdouble f)
+{
+	gdouble f3 = f * f * f;
+	if (f3 > GCM_COLOR_MATH_EPSILON)
+		return f3;
+	return (116.0 * f - 16.0) / GCM_COLOR_MATH_KAPPA;
+}
+
+/**
+ * gcm_color_math_xyz_to_lab:
+ * @xyz: the color, where the white has a Y of 1
+ * @white: (nullable): the reference white, or %NULL for D50
+ * @lab: the result
+ *
+ * Converts XYZ to CIE Lab, the same as cmsXYZ2Lab().
+ **/
+void
+gcm_color_math_xyz_to_lab (const CdColorXYZ *xyz, const CdColorXYZ *white, CdColorLab *lab)
+{
+	const CdColorXYZ *w = white != NULL ? white : &gcm_color_math_d50;
+	gdouble fx = gcm_color_math_lab_f (xyz->X / w->X);
+	gdouble fy = gcm_color_math_lab_f (xyz->Y / w->Y);
+	gdouble fz = gcm_color_math_lab_f (xyz->Z / w->Z);
+
+	lab->L = 116.0 * fy - 16.0;
+	lab->a = 500.0 * (fx - fy);
+	lab->b = 200.0 * (fy - fz);
+}
+
+/**
+ * gcm_color_math_delta_e2000:
+ *
+ * Returns the CIEDE2000 color difference, using the formulae from
+ * Sharma, Wu and Dalal with the parametric factors all set to 1.
+ **/
+gdouble
+gcm_color_math_delta_e2000 (const CdColorLab *p1, const CdColorLab *p2)
+{
+	const gdouble pow25_7 = 6103515625.0; /* 25^7 */
+	gdouble a1p, a2p, c1, c2, c1p, c2p, cbar, cbarp, cbar7;
+	gdouble dhp, dhp_big, dlp, dcp, g, h1p, h2p, hbarp;
+	gdouble lbar50, rc, rt, sc, sh, sl, t, dtheta;
+
+	/* adjust a* for the neutral axis */
+	c1 = sqrt (p1->a * p1->a + p1->b * p1->b);
+	c2 = sqrt (p2->a * p2->a + p2->b * p2->b);
+	cbar = (c1 + c2) / 2.0;
+	cbar7 = pow (cbar, 7);
+	g = 0.5 * (1.0 - sqrt (cbar7 / (cbar7 + pow25_7)));
+	a1p = (1.0 + g) * p1->a;
+	a2p = (1.0 + g) * p2->a;
+	c1p = sqrt (a1p * a1p + p1->b * p1->b);
+	c2p = sqrt (a2p * a2p + p2->b * p2->b);
+
+	/* hue angles in degrees */
+	h1p = (a1p == 0.0 && p1->b == 0.0) ? 0.0 : atan2 (p1->b, a1p) * 180.0 / G_PI;
+	if (h1p < 0.0)
+		h1p += 360.0;
+	h2p = (a2p == 0.0 && p2->b == 0.0) ? 0.0 : atan2 (p2->b, a2p) * 180.0 / G_PI;
+	if (h2p < 0.0)
+		h2p += 360.0;
+
+	/* differences */
+	dlp = p2->L - p1->L;
+	dcp = c2p - c1p;
+	if (c1p * c2p == 0.0) {
+		dhp = 0.0;
+	} else {
+		dhp = h2p - h1p;
+		if (dhp > 180.0)
+			dhp -= 360.0;
+		else if (dhp < -180.0)
+			dhp += 360.0;
+	}
+	dhp_big = 2.0 * sqrt (c1p * c2p) * sin (dhp * G_PI / 360.0);
+
+	/* means */
+	cbarp = (c1p + c2p) / 2.0;
+	if (c1p * c2p == 0.0) {
+		hbarp = h1p + h2p;
+	} else if (fabs (h1p - h2p) <= 180.0) {
+		hbarp = (h1p + h2p) / 2.0;
+	} else if (h1p + h2p < 360.0) {
+		hbarp = (h1p + h2p + 360.0) / 2.0;
+	} else {
+		hbarp = (h1p + h2p - 360.0) / 2.0;
+	}
+
+	/* weighting functions */
+	t = 1.0 - 0.17 * cos ((hbarp - 30.0) * G_PI / 180.0) +
+		  0.24 * cos ((2.0 * hbarp) * G_PI / 180.0) +
+		  0.32 * cos ((3.0 * hbarp + 6.0) * G_PI / 180.0) -
+		  0.20 * cos ((4.0 * hbarp - 63.0) * G_PI / 180.0);
+	dtheta = 30.0 * exp (-pow ((hbarp - 275.0) / 25.0, 2));
+	rc = 2.0 * sqrt (pow (cbarp, 7) / (pow (cbarp, 7) + pow25_7));
+	lbar50 = pow ((p1->L + p2->L) / 2.0 - 50.0, 2);
+	sl = 1.0 + (0.015 * lbar50) / sqrt (20.0 + lbar50);
+	sc = 1.0 + 0.045 * cbarp;
+	sh = 1.0 + 0.015 * cbarp * t;
+	rt = -sin (2.0 * dtheta * G_PI / 180.0) * rc;
+
+	return sqrt (pow (dlp / sl, 2) +
+		     pow (dcp / sc, 2) +
+		     pow (dhp_big / sh, 2) +
+		     rt * (dcp / sc) * (dhp_big / sh));
+}
+
+/* Robertson's isotemperature lines in CIE 1960 UCS, as used by LCMS, with
+ * the misprint at 325 mired corrected */
+static const struct {
+	gdouble	mired;
+	gdouble	u;
+	gdouble	v;
+	gdouble	t;
+} gcm_color_math_isotemp[] = {
+	{   0,	0.18006,	0.26352,	-0.24341 },
+	{  10,	0.18066,	0.26589,	-0.25479 },
+	{  20,	0.18133,	0.26846,	-0.26876 },
+	{  30,	0.18208,	0.27119,	-0.28539 },
+	{  40,	0.18293,	0.27407,	-0.30470 },
+	{  50,	0.18388,	0.27709,	-0.32675 },
+	{  60,	0.18494,	0.28021,	-0.35156 },
+	{  70,	0.18611,	0.28342,	-0.37915 },
+	{  80,	0.18740,	0.28668,	-0.40955 },
+	{  90,	0.18880,	0.28997,	-0.44278 },
+	{ 100,	0.19032,	0.29326,	-0.47888 },
+	{ 125,	0.19462,	0.30141,	-0.58204 },
+	{ 150,	0.19962,	0.30921,	-0.70471 },
+	{ 175,	0.20525,	0.31647,	-0.84901 },
+	{ 200,	0.21142,	0.32312,	-1.0182 },
+	{ 225,	0.21807,	0.32909,	-1.2168 },
+	{ 250,	0.22511,	0.33439,	-1.4512 },
+	{ 275,	0.23247,	0.33904,	-1.7298 },
+	{ 300,	0.24010,	0.34308,	-2.0637 },
+	{ 325,	0.24792,	0.34655,	-2.4681 },
+	{ 350,	0.25591,	0.34951,	-2.9641 },
+	{ 375,	0.26400,	0.35200,	-3.5814 },
+	{ 400,	0.27218,	0.35407,	-4.3633 },
+	{ 425,	0.28039,	0.35577,	-5.3762 },
+	{ 450,	0.28863,	0.35714,	-6.7262 },
+	{ 475,	0.29685,	0.35823,	-8.5955 },
+	{ 500,	0.30505,	0.35907,	-11.324 },
+	{ 525,	0.31320,	0.35968,	-15.628 },
+	{ 550,	0.32129,	0.36011,	-23.325 },
+	{ 575,	0.32931,	0.36038,	-40.770 },
+	{ 600,	0.33724,	0.36051,	-116.45 },
+};
+
+/**
+ * gcm_color_math_get_cct:
+ * @yxy: the chromaticity, where Y is not used
+ * @cct: (out): the correlated color temperature in Kelvin
+ *
+ * Gets the correlated color temperature using Robertson's method, the
+ * same as cmsTempFromWhitePoint().
+ *
+ * Returns: %FALSE if the color is not between 1667K and infinity
+ **/
+gboolean
+gcm_color_math_get_cct (const CdColorYxy *yxy, gdouble *cct)
+{
+	gdouble denom = -yxy->x + 6.0 * yxy->y + 1.5;
+	gdouble di = 0.0;
+	gdouble us;
+	gdouble vs;
+
+	if (denom == 0.0)
+		return FALSE;
+	us = (2.0 * yxy->x) / denom;
+	vs = (3.0 * yxy->y) / denom;
+	for (guint j = 0; j < G_N_ELEMENTS (gcm_color_math_isotemp); j++) {
+		gdouble t = gcm_color_math_isotemp[j].t;
+		gdouble dj = ((vs - gcm_color_math_isotemp[j].v) -
+			      t * (us - gcm_color_math_isotemp[j].u)) / sqrt (1.0 + t * t);
+
+		/* between this line and the last */
+		if (j > 0 && di / dj < 0.0) {
+			gdouble mired_last = gcm_color_math_isotemp[j - 1].mired;
+			gdouble mired = mired_last + (di / (di - dj)) *
+					(gcm_color_math_isotemp[j].mired - mired_last);
+			*cct = 1000000.0 / mired;
+			return TRUE;
+		}
+		di = dj;
+	}
+	return FALSE;
+}
+
+#ifdef GCM_COLOR_MATH_HAVE_VECTOR
+static inline GcmColorMathFloat4
+gcm_color_math_select4 (GcmColorMathInt4 mask, GcmColorMathFloat4 a, GcmColorMathFloat4 b)
+{
+	return (GcmColorMathFloat4) (((GcmColorMathInt4) a & mask) |
+				     ((GcmColorMathInt4) b & ~mask));
+}
+
+static inline GcmColorMathFloat4
+gcm_color_math_sqrt4 (GcmColorMathFloat4 v)
+{
+	GcmColorMathFloat4 r = { sqrtf (v[0]), sqrtf (v[1]), sqrtf (v[2]), sqrtf (v[3]) };
+	return r;
+}
+
+/* a cube root guessed from the exponent bits, refined with Newton's method */
+static inline GcmColorMathFloat4
+gcm_color_math_lab_f4 (GcmColorMathFloat4 t)
+{
+	GcmColorMathInt4 mask = t > (gfloat) GCM_COLOR_MATH_EPSILON;
+	GcmColorMathInt4 i = (GcmColorMathInt4) t;
+	GcmColorMathFloat4 y;
+
+	i = i / 3 + 709921077;
+	y = (GcmColorMathFloat4) i;
+	for (guint j = 0; j < 3; j++)
+		y = (2.f * y + t / (y * y)) * (1.f / 3.f);
+	return gcm_color_math_select4 (mask, y,
+				       t * (gfloat) (GCM_COLOR_MATH_KAPPA / 116.0) + 16.f / 116.f);
+}
+
+static inline GcmColorMathFloat4
+gcm_color_math_lab_f_inv4 (GcmColorMathFloat4 f)
+{
+	GcmColorMathFloat4 f3 = f * f * f;
+	return gcm_color_math_select4 (f3 > (gfloat) GCM_COLOR_MATH_EPSILON, f3,
+				       (f - 16.f / 116.f) * (gfloat) (116.0 / GCM_COLOR_MATH_KAPPA));
+}
+#endif
+
+/**
+ * gcm_color_math_xyz_to_yxy_array:
+ * @xyz: planar XYZ
+ * @yxy: (out caller-allocates): planar Yxy, in that order
+ * @n: the number of colors
+ *
+ * Converts XYZ to chromaticity, the same as cd_color_xyz_to_yxy().
+ **/
+void
+gcm_color_math_xyz_to_yxy_array (const gfloat *xyz, gfloat *yxy, guint n)
+{
+	guint i = 0;
+
+#ifdef GCM_COLOR_MATH_HAVE_VECTOR
+	for (; i + 4 <= n; i += 4) {
+		GcmColorMathFloat4 x;
+		GcmColorMathFloat4 y;
+		GcmColorMathFloat4 z;
+		GcmColorMathFloat4 sum;
+		GcmColorMathFloat4 zero = { 0.f, 0.f, 0.f, 0.f };
+		GcmColorMathInt4 mask;
+		memcpy (&x, xyz + i, sizeof (x));
+		memcpy (&y, xyz + n + i, sizeof (y));
+		memcpy (&z, xyz + n * 2 + i, sizeof (z));
+		sum = x + y + z;
+		mask = (sum > 1e-6f) | (sum < -1e-6f);
+		sum = gcm_color_math_select4 (mask, 1.f / sum, zero);
+		x = gcm_color_math_select4 (mask, y, zero);
+		memcpy (yxy + i, &x, sizeof (x));
+		x = (GcmColorMathFloat4) { xyz[i], xyz[i + 1], xyz[i + 2], xyz[i + 3] } * sum;
+		memcpy (yxy + n + i, &x, sizeof (x));
+		y *= sum;
+		memcpy (yxy + n * 2 + i, &y, sizeof (y));
+	}
+#endif
+	for (; i < n; i++) {
+		gfloat sum = xyz[i] + xyz[n + i] + xyz[n * 2 + i];
+		if (fabsf (sum) < 1e-6f) {
+			yxy[i] = 0.f;
+			yxy[n + i] = 0.f;
+			yxy[n * 2 + i] = 0.f;
+			continue;
+		}
+		yxy[i] = xyz[n + i];
+		yxy[n + i] = xyz[i] / sum;
+		yxy[n * 2 + i] = xyz[n + i] / sum;
+	}
+}
+
+/**
+ * gcm_color_math_xyz_to_lab_array:
+ * @xyz: planar XYZ, where the white has a Y of 1
+ * @white: (nullable): the reference white, or %NULL for D50
+ * @lab: (out caller-allocates): planar Lab, which may be @xyz
+ * @n: the number of colors
+ *
+ * Converts XYZ to CIE Lab, like gcm_color_math_xyz_to_lab(). Each color
+ * is read before it is written, so this can be done in place.
+ **/
+void
+gcm_color_math_xyz_to_lab_array (const gfloat *xyz,
+				 const CdColorXYZ *white,
+				 gfloat *lab,
+				 guint n)
+{
+	const CdColorXYZ *w = white != NULL ? white : &gcm_color_math_d50;
+	const gfloat scale[3] = { 1.f / (gfloat) w->X, 1.f / (gfloat) w->Y, 1.f / (gfloat) w->Z };
+	guint i = 0;
+
+#ifdef GCM_COLOR_MATH_HAVE_VECTOR
+	for (; i + 4 <= n; i += 4) {
+		GcmColorMathFloat4 f[3];
+		GcmColorMathFloat4 out;
+		for (guint c = 0; c < 3; c++) {
+			GcmColorMathFloat4 t;
+			memcpy (&t, xyz + n * c + i, sizeof (t));
+			f[c] = gcm_color_math_lab_f4 (t * scale[c]);
+		}
+		out = 116.f * f[1] - 16.f;
+		memcpy (lab + i, &out, sizeof (out));
+		out = 500.f * (f[0] - f[1]);
+		memcpy (lab + n + i, &out, sizeof (out));
+		out = 200.f * (f[1] - f[2]);
+		memcpy (lab + n * 2 + i, &out, sizeof (out));
+	}
+#endif
+	for (; i < n; i++) {
+		gfloat fx = (gfloat) gcm_color_math_lab_f (xyz[i] * scale[0]);
+		gfloat fy = (gfloat) gcm_color_math_lab_f (xyz[n + i] * scale[1]);
+		gfloat fz = (gfloat) gcm_color_math_lab_f (xyz[n * 2 + i] * scale[2]);
+		lab[i] = 116.f * fy - 16.f;
+		lab[n + i] = 500.f * (fx - fy);
+		lab[n * 2 + i] = 200.f * (fy - fz);
+	}
+}
+
+/**
+ * gcm_color_math_lab_to_xyz_array:
+ * @lab: planar Lab
+ * @white: (nullable): the reference white, or %NULL for D50
+ * @xyz: (out caller-allocates): planar XYZ, where the white has a Y of 1
+ * @n: the number of colors
+ *
+ * Converts CIE Lab to XYZ, the same as cmsLab2XYZ().
+ **/
+void
+gcm_color_math_lab_to_xyz_array (const gfloat *lab,
+				 const CdColorXYZ *white,
+				 gfloat *xyz,
+				 guint n)
+{
+	const CdColorXYZ *w = white != NULL ? white : &gcm_color_math_d50;
+	const gfloat wx = (gfloat) w->X;
+	const gfloat wy = (gfloat) w->Y;
+	const gfloat wz = (gfloat) w->Z;
+	guint i = 0;
+
+#ifdef GCM_COLOR_MATH_HAVE_VECTOR
+	for (; i + 4 <= n; i += 4) {
+		GcmColorMathFloat4 l;
+		GcmColorMathFloat4 a;
+		GcmColorMathFloat4 b;
+		GcmColorMathFloat4 fy;
+		GcmColorMathFloat4 out;
+		memcpy (&l, lab + i, sizeof (l));
+		memcpy (&a, lab + n + i, sizeof (a));
+		memcpy (&b, lab + n * 2 + i, sizeof (b));
+		fy = (l + 16.f) * (1.f / 116.f);
+		out = wx * gcm_color_math_lab_f_inv4 (fy + a * (1.f / 500.f));
+		memcpy (xyz + i, &out, sizeof (out));
+		out = wy * gcm_color_math_lab_f_inv4 (fy);
+		memcpy (xyz + n + i, &out, sizeof (out));
+		out = wz * gcm_color_math_lab_f_inv4 (fy - b * (1.f / 200.f));
+		memcpy (xyz + n * 2 + i, &out, sizeof (out));
+	}
+#endif
+	for (; i < n; i++) {
+		gfloat fy = (lab[i] + 16.f) / 116.f;
+		xyz[i] = wx * (gfloat) gcm_color_math_lab_f_inv (fy + lab[n + i] / 500.f);
+		xyz[n + i] = wy * (gfloat) gcm_color_math_lab_f_inv (fy);
+		xyz[n * 2 + i] = wz * (gfloat) gcm_color_math_lab_f_inv (fy - lab[n * 2 + i] / 200.f);
+	}
+}
+
+/**
+ * gcm_color_math_delta_e94_array:
+ * @lab1: planar Lab of the reference colors
+ * @lab2: planar Lab
+ * @out: (out caller-allocates): the differences
+ * @n: the number of colors
+ *
+ * Gets the CIE94 color difference with the graphic arts weights for each
+ * pair of colors. The weights only depend on the chroma of @lab1, so the
+ * difference is not symmetric.
+ **/
+void
+gcm_color_math_delta_e94_array (const gfloat *lab1,
+				const gfloat *lab2,
+				gfloat *out,
+				guint n)
+{
+	guint i = 0;
+
+#ifdef GCM_COLOR_MATH_HAVE_VECTOR
+	for (; i + 4 <= n; i += 4) {
+		GcmColorMathFloat4 l1;
+		GcmColorMathFloat4 a1;
+		GcmColorMathFloat4 b1;
+		GcmColorMathFloat4 l2;
+		GcmColorMathFloat4 a2;
+		GcmColorMathFloat4 b2;
+		GcmColorMathFloat4 c1;
+		GcmColorMathFloat4 dc;
+		GcmColorMathFloat4 dh2;
+		GcmColorMathFloat4 sc;
+		GcmColorMathFloat4 sh;
+		GcmColorMathFloat4 zero = { 0.f, 0.f, 0.f, 0.f };
+		memcpy (&l1, lab1 + i, sizeof (l1));
+		memcpy (&a1, lab1 + n + i, sizeof (a1));
+		memcpy (&b1, lab1 + n * 2 + i, sizeof (b1));
+		memcpy (&l2, lab2 + i, sizeof (l2));
+		memcpy (&a2, lab2 + n + i, sizeof (a2));
+		memcpy (&b2, lab2 + n * 2 + i, sizeof (b2));
+		c1 = gcm_color_math_sqrt4 (a1 * a1 + b1 * b1);
+		dc = c1 - gcm_color_math_sqrt4 (a2 * a2 + b2 * b2);
+		l1 -= l2;
+		a1 -= a2;
+		b1 -= b2;
+		dh2 = a1 * a1 + b1 * b1 - dc * dc;
+		dh2 = gcm_color_math_select4 (dh2 > 0.f, dh2, zero);
+		sc = 1.f + 0.045f * c1;
+		sh = 1.f + 0.015f * c1;
+		dc /= sc;
+		l1 = gcm_color_math_sqrt4 (l1 * l1 + dc * dc + dh2 / (sh * sh));
+		memcpy (out + i, &l1, sizeof (l1));
+	}
+#endif
+	for (; i < n; i++) {
+		gfloat a1 = lab1[n + i];
+		gfloat b1 = lab1[n * 2 + i];
+		gfloat a2 = lab2[n + i];
+		gfloat b2 = lab2[n * 2 + i];
+		gfloat c1 = sqrtf (a1 * a1 + b1 * b1);
+		gfloat dl = lab1[i] - lab2[i];
+		gfloat da = a1 - a2;
+		gfloat db = b1 - b2;
+		gfloat dc = c1 - sqrtf (a2 * a2 + b2 * b2);
+		gfloat dh2 = MAX (da * da + db * db - dc * dc, 0.f);
+		gfloat sc = 1.f + 0.045f * c1;
+		gfloat sh = 1.f + 0.015f * c1;
+		dc /= sc;
+		out[i] = sqrtf (dl * dl + dc * dc + dh2 / (sh * sh));
+	}
+}
+
+/**
+ * gcm_color_math_delta_e2000_array:
+ * @lab1: planar Lab
+ * @lab2: planar Lab
+ * @out: (out caller-allocates): the differences
+ * @n: the number of colors
+ *
+ * This is gcm_color_math_delta_e2000() in single precision, with the
+ * angles kept in radians. The hue terms need trigonometric functions that
+ * generic vectors do not have, so this is a plain loop; the libm calls
+ * cost far more than the arithmetic around them.
+ **/
+void
+gcm_color_math_delta_e2000_array (const gfloat *lab1,
+				  const gfloat *lab2,
+				  gfloat *out,
+				  guint n)
+{
+	const gfloat pow25_7 = 6103515625.f; /* 25^7 */
+	const gfloat deg = (gfloat) G_PI / 180.f;
+
+	for (guint x = 0; x < n; x++) {
+		gfloat l1 = lab1[x];
+		gfloat a1 = lab1[n + x];
+		gfloat b1 = lab1[n * 2 + x];
+		gfloat l2 = lab2[x];
+		gfloat a2 = lab2[n + x];
+		gfloat b2 = lab2[n * 2 + x];
+		gfloat c1, c2, cbar, cbar7, g, a1p, a2p, c1p, c2p, h1p, h2p;
+		gfloat dlp, dcp, dhp, dhp_big, cbarp, cbarp7, hbarp, prod;
+		gfloat t, dtheta, rc, lbar50, sl, sc, sh, rt;
+
+		/* adjust a* for the neutral axis */
+		c1 = sqrtf (a1 * a1 + b1 * b1);
+		c2 = sqrtf (a2 * a2 + b2 * b2);
+		cbar = (c1 + c2) * 0.5f;
+		cbar7 = cbar * cbar * cbar;
+		cbar7 = cbar7 * cbar7 * cbar;
+		g = 0.5f * (1.f - sqrtf (cbar7 / (cbar7 + pow25_7)));
+		a1p = (1.f + g) * a1;
+		a2p = (1.f + g) * a2;
+		c1p = sqrtf (a1p * a1p + b1 * b1);
+		c2p = sqrtf (a2p * a2p + b2 * b2);
+
+		/* hue angles, where atan2f (0, 0) is already 0 */
+		h1p = atan2f (b1, a1p);
+		h1p += h1p < 0.f ? 2.f * (gfloat) G_PI : 0.f;
+		h2p = atan2f (b2, a2p);
+		h2p += h2p < 0.f ? 2.f * (gfloat) G_PI : 0.f;
+
+		/* differences */
+		prod = c1p * c2p;
+		dlp = l2 - l1;
+		dcp = c2p - c1p;
+		dhp = h2p - h1p;
+		dhp -= dhp > (gfloat) G_PI ? 2.f * (gfloat) G_PI : 0.f;
+		dhp += dhp < -(gfloat) G_PI ? 2.f * (gfloat) G_PI : 0.f;
+		dhp = prod == 0.f ? 0.f : dhp;
+		dhp_big = 2.f * sqrtf (prod) * sinf (dhp * 0.5f);
+
+		/* means */
+		cbarp = (c1p + c2p) * 0.5f;
+		hbarp = h1p + h2p;
+		if (prod != 0.f && fabsf (h1p - h2p) > (gfloat) G_PI)
+			hbarp += hbarp < 2.f * (gfloat) G_PI ? 2.f * (gfloat) G_PI : -2.f * (gfloat) G_PI;
+		hbarp *= prod == 0.f ? 1.f : 0.5f;
+
+		/* weighting functions */
+		t = 1.f - 0.17f * cosf (hbarp - 30.f * deg) +
+			  0.24f * cosf (2.f * hbarp) +
+			  0.32f * cosf (3.f * hbarp + 6.f * deg) -
+			  0.20f * cosf (4.f * hbarp - 63.f * deg);
+		dtheta = (hbarp - 275.f * deg) / (25.f * deg);
+		dtheta = 30.f * deg * expf (-dtheta * dtheta);
+		cbarp7 = cbarp * cbarp * cbarp;
+		cbarp7 = cbarp7 * cbarp7 * cbarp;
+		rc = 2.f * sqrtf (cbarp7 / (cbarp7 + pow25_7));
+		lbar50 = (l1 + l2) * 0.5f - 50.f;
+		lbar50 *= lbar50;
+		sl = 1.f + (0.015f * lbar50) / sqrtf (20.f + lbar50);
+		sc = 1.f + 0.045f * cbarp;
+		sh = 1.f + 0.015f * cbarp * t;
+		rt = -sinf (2.f * dtheta) * rc;
+
+		dlp /= sl;
+		dcp /= sc;
+		dhp_big /= sh;
+		out[x] = sqrtf (dlp * dlp + dcp * dcp + dhp_big * dhp_big +
+				rt * dcp * dhp_big);
+	}
+}
+
+/**
+ * gcm_color_math_cct_array:
+ * @yxy: planar Yxy, in that order
+ * @cct: (out caller-allocates): the temperatures in Kelvin, or 0 where
+ *	there is none
+ * @n: the number of colors
+ *
+ * This is gcm_color_math_get_cct() for each color. The search through the
+ * isotemperature lines stops at a different line for each color, so this
+ * is not vectorized.
+ **/
+void
+gcm_color_math_cct_array (const gfloat *yxy, gfloat *cct, guint n)
+{
+	for (guint i = 0; i < n; i++) {
+		CdColorYxy tmp;
+		gdouble value = 0.0;
+		tmp.Y = yxy[i];
+		tmp.x = yxy[n + i];
+		tmp.y = yxy[n * 2 + i];
+		if (!gcm_color_math_get_cct (&tmp, &value))
+			value = 0.0;
+		cct[i] = (gfloat) value;
+	}
+}
@@ -0,0 +1,44 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <colord.h>
+
+/* one color at a time, in double precision */
+void		 gcm_color_math_xyz_to_lab		(const CdColorXYZ	*xyz,
+							 const CdColorXYZ	*white,
+							 CdColorLab		*lab);
+gdouble		 gcm_color_math_delta_e2000		(const CdColorLab	*p1,
+							 const CdColorLab	*p2);
+gboolean	 gcm_color_math_get_cct			(const CdColorYxy	*yxy,
+							 gdouble		*cct);
+
+/* planar arrays of @n colors, with each channel stored after the other */
+void		 gcm_color_math_xyz_to_yxy_array	(const gfloat		*xyz,
+							 gfloat			*yxy,
+							 guint			 n);
+void		 gcm_color_math_xyz_to_lab_array	(const gfloat		*xyz,
+							 const CdColorXYZ	*white,
+							 gfloat			*lab,
+							 guint			 n);
+void		 gcm_color_math_lab_to_xyz_array	(const gfloat		*lab,
+							 const CdColorXYZ	*white,
+							 gfloat			*xyz,
+							 guint			 n);
+void		 gcm_color_math_delta_e94_array		(const gfloat		*lab1,
+							 const gfloat		*lab2,
+							 gfloat			*out,
+							 guint			 n);
+void		 gcm_color_math_delta_e2000_array	(const gfloat		*lab1,
+							 const gfloat		*lab2,
+							 gfloat			*out,
+							 guint			 n);
+void		 gcm_color_math_cct_array		(const gfloat		*yxy,
+							 gfloat			*cct,
+							 guint			 n);
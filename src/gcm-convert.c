@@ -0,0 +1,697 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <colord.h>
+
+#include "gcm-debug.h"
+#include "gcm-tiff.h"
+#include "gcm-utils.h"
+
+/*
+ * Images are decoded, converted and encoded by separate threads, which are
+ * connected by queues that only hold a few images at a time. A slow disk or
+ * encoder therefore holds the decoders back rather than filling memory with
+ * decoded images that are waiting to be written.
+ *
+ * Uncompressed TIFF files are not decoded at all: they are mapped and
+ * converted a band at a time as they are written, so that very large scans
+ * can be converted in a fixed amount of memory.
+ */
+
+#define GCM_CONVERT_QUEUE_SIZE		4
+
+typedef struct {
+	GMutex		 mutex;
+	GCond		 cond;
+	GQueue		 items;
+	guint		 max_items;
+	guint		 n_producers;
+} GcmConvertQueue;
+
+typedef struct {
+	GFile		*file_in;
+	GFile		*file_out;
+	GdkPixbuf	*pixbuf;
+	GcmTiff		*tiff;		/* instead of the pixbuf */
+	GcmUtilsTransform *transform;	/* only for the tiff */
+	CdIcc		*embedded;
+} GcmConvertItem;
+
+typedef struct {
+	GPtrArray	*files;		/* of GFile */
+	GFile		*output_dir;
+	const gchar	*output_ext;	/* or %NULL to keep the input name */
+	CdIcc		*input;
+	CdIcc		*abstract;
+	CdIcc		*output;
+	CdRenderingIntent intent;
+	gboolean	 bpc;
+	GBytes		*output_data;	/* to embed in the encoded files */
+	gchar		*output_b64;
+	gint		 file_next;	/* atomic */
+	gint		 n_failed;	/* atomic */
+	GcmConvertQueue	*decoded;
+	GcmConvertQueue	*converted;
+} GcmConvertPrivate;
+
+static void
+gcm_convert_private_free (GcmConvertPrivate *priv)
+{
+	g_ptr_array_unref (priv->files);
+	if (priv->output_dir != NULL)
+		g_object_unref (priv->output_dir);
+	if (priv->input != NULL)
+		g_object_unref (priv->input);
+	if (priv->abstract != NULL)
+		g_object_unref (priv->abstract);
+	if (priv->output != NULL)
+		g_object_unref (priv->output);
+	if (priv->output_data != NULL)
+		g_bytes_unref (priv->output_data);
+	g_free (priv->output_b64);
+	g_free (priv);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmConvertPrivate, gcm_convert_private_free)
+
+static GcmConvertQueue *
+gcm_convert_queue_new (guint max_items, guint n_producers)
+{
+	GcmConvertQueue *queue = g_new0 (GcmConvertQueue, 1);
+	g_mutex_init (&queue->mutex);
+	g_cond_init (&queue->cond);
+	g_queue_init (&queue->items);
+	queue->max_items = max_items;
+	queue->n_producers = n_producers;
+	return queue;
+}
+
+static void
+gcm_convert_queue_free (GcmConvertQueue *queue)
+{
+	g_mutex_clear (&queue->mutex);
+	g_cond_clear (&queue->cond);
+	g_queue_clear (&queue->items);
+	g_free (queue);
+}
+
+/* blocks while the queue is full */
+static void
+gcm_convert_queue_push (GcmConvertQueue *queue, gpointer item)
+{
+	g_mutex_lock (&queue->mutex);
+	while (queue->items.length >= queue->max_items)
+		g_cond_wait (&queue->cond, &queue->mutex);
+	g_queue_push_tail (&queue->items, item);
+	g_cond_broadcast (&queue->cond);
+	g_mutex_unlock (&queue->mutex);
+}
+
+/* blocks while the queue is empty, and returns %NULL once every producer
+ * has finished and the queue has drained */
+static gpointer
+gcm_convert_queue_pop (GcmConvertQueue *queue)
+{
+	gpointer item;
+
+	g_mutex_lock (&queue->mutex);
+	while (queue->items.length == 0 && queue->n_producers > 0)
+		g_cond_wait (&queue->cond, &queue->mutex);
+	item = g_queue_pop_head (&queue->items);
+	if (item != NULL)
+		g_cond_broadcast (&queue->cond);
+	g_mutex_unlock (&queue->mutex);
+	return item;
+}
+
+static void
+gcm_convert_queue_producer_done (GcmConvertQueue *queue)
+{
+	g_mutex_lock (&queue->mutex);
+	queue->n_producers--;
+	g_cond_broadcast (&queue->cond);
+	g_mutex_unlock (&queue->mutex);
+}
+
+static void
+gcm_convert_item_free (GcmConvertItem *item)
+{
+	g_object_unref (item->file_in);
+	g_object_unref (item->file_out);
+	if (item->pixbuf != NULL)
+		g_object_unref (item->pixbuf);
+	if (item->tiff != NULL)
+		gcm_tiff_free (item->tiff);
+	if (item->transform != NULL)
+		gcm_utils_transform_unref (item->transform);
+	if (item->embedded != NULL)
+		g_object_unref (item->embedded);
+	g_free (item);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmConvertItem, gcm_convert_item_free)
+
+static void
+gcm_convert_item_failed (GcmConvertPrivate *priv,
+			 GcmConvertItem *item,
+			 const GError *error)
+{
+	g_autofree gchar *path = g_file_get_path (item->file_in);
+	/* TRANSLATORS: an image could not be converted */
+	g_printerr ("%s %s: %s\n", _("Failed to convert"), path, error->message);
+	g_atomic_int_inc (&priv->n_failed);
+}
+
+static const gchar *
+gcm_convert_get_pixbuf_type (GFile *file)
+{
+	g_autofree gchar *basename = g_file_get_basename (file);
+	const gchar *ext = strrchr (basename, '.');
+	if (ext == NULL)
+		return NULL;
+	if (g_ascii_strcasecmp (ext, ".png") == 0)
+		return "png";
+	if (g_ascii_strcasecmp (ext, ".jpg") == 0 ||
+	    g_ascii_strcasecmp (ext, ".jpeg") == 0)
+		return "jpeg";
+	if (g_ascii_strcasecmp (ext, ".tif") == 0 ||
+	    g_ascii_strcasecmp (ext, ".tiff") == 0)
+		return "tiff";
+	return NULL;
+}
+
+/* the extension written for each --format value */
+static const gchar *
+gcm_convert_get_format_ext (const gchar *format)
+{
+	if (g_strcmp0 (format, "png") == 0)
+		return ".png";
+	if (g_strcmp0 (format, "jpeg") == 0)
+		return ".jpg";
+	if (g_strcmp0 (format, "tiff") == 0)
+		return ".tif";
+	return NULL;
+}
+
+static gchar *
+gcm_convert_get_output_basename (GcmConvertPrivate *priv, GFile *file)
+{
+	gchar *ext;
+	g_autofree gchar *basename = g_file_get_basename (file);
+
+	if (priv->output_ext == NULL)
+		return g_steal_pointer (&basename);
+	ext = strrchr (basename, '.');
+	if (ext != NULL)
+		*ext = '\0';
+	return g_strconcat (basename, priv->output_ext, NULL);
+}
+
+/* images from different directories can have the same name */
+static gboolean
+gcm_convert_check_output_names (GcmConvertPrivate *priv, GError **error)
+{
+	g_autoptr(GHashTable) names = g_hash_table_new_full (g_str_hash, g_str_equal,
+							     g_free, NULL);
+
+	for (guint i = 0; i < priv->files->len; i++) {
+		GFile *file = g_ptr_array_index (priv->files, i);
+		GFile *file_old;
+		g_autofree gchar *basename = gcm_convert_get_output_basename (priv, file);
+
+		file_old = g_hash_table_lookup (names, basename);
+		if (file_old != NULL) {
+			g_autofree gchar *path = g_file_get_path (file);
+			g_autofree gchar *path_old = g_file_get_path (file_old);
+			g_set_error (error, 1, 0,
+				     "%s and %s would both be written to %s",
+				     path_old, path, basename);
+			return FALSE;
+		}
+		g_hash_table_insert (names, g_steal_pointer (&basename), file);
+	}
+	return TRUE;
+}
+
+static void
+gcm_convert_item_set_embedded (GcmConvertPrivate *priv,
+			       GcmConvertItem *item,
+			       const guint8 *data,
+			       gsize len)
+{
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* a profile that was specified takes precedence */
+	if (priv->input != NULL)
+		return;
+	if (!cd_icc_load_data (icc, data, len, CD_ICC_LOAD_FLAGS_NONE, &error)) {
+		g_debug ("ignoring embedded profile: %s", error->message);
+		return;
+	}
+	item->embedded = g_steal_pointer (&icc);
+}
+
+static gpointer
+gcm_convert_decode_thread_cb (gpointer user_data)
+{
+	GcmConvertPrivate *priv = (GcmConvertPrivate *) user_data;
+
+	for (;;) {
+		const gchar *icc_b64;
+		gint idx = g_atomic_int_add (&priv->file_next, 1);
+		g_autofree gchar *basename = NULL;
+		g_autofree gchar *path = NULL;
+		g_autoptr(GcmConvertItem) item = NULL;
+		g_autoptr(GError) error = NULL;
+
+		if (idx >= (gint) priv->files->len)
+			break;
+		item = g_new0 (GcmConvertItem, 1);
+		item->file_in = g_object_ref (g_ptr_array_index (priv->files, idx));
+		basename = gcm_convert_get_output_basename (priv, item->file_in);
+		item->file_out = g_file_get_child (priv->output_dir, basename);
+
+		/* never write over what we are reading */
+		if (g_file_equal (item->file_in, item->file_out)) {
+			g_set_error_literal (&error, 1, 0,
+					     "output would replace the input");
+			gcm_convert_item_failed (priv, item, error);
+			continue;
+		}
+		if (gcm_convert_get_pixbuf_type (item->file_out) == NULL) {
+			g_set_error_literal (&error, 1, 0,
+					     "output format not supported, use --format");
+			gcm_convert_item_failed (priv, item, error);
+			continue;
+		}
+
+		path = g_file_get_path (item->file_in);
+
+		/* streamed from TIFF to TIFF if it is stored uncompressed */
+		if (g_strcmp0 (gcm_convert_get_pixbuf_type (item->file_in), "tiff") == 0 &&
+		    g_strcmp0 (gcm_convert_get_pixbuf_type (item->file_out), "tiff") == 0) {
+			item->tiff = gcm_tiff_new_from_file (path, &error);
+			if (item->tiff != NULL) {
+				GBytes *icc = gcm_tiff_get_icc_data (item->tiff);
+				if (icc != NULL) {
+					gcm_convert_item_set_embedded (priv, item,
+								       g_bytes_get_data (icc, NULL),
+								       g_bytes_get_size (icc));
+				}
+				gcm_convert_queue_push (priv->decoded, g_steal_pointer (&item));
+				continue;
+			}
+			g_debug ("decoding %s: %s", path, error->message);
+			g_clear_error (&error);
+		}
+
+		item->pixbuf = gdk_pixbuf_new_from_file (path, &error);
+		if (item->pixbuf == NULL) {
+			gcm_convert_item_failed (priv, item, error);
+			continue;
+		}
+		icc_b64 = gdk_pixbuf_get_option (item->pixbuf, "icc-profile");
+		if (icc_b64 != NULL) {
+			gsize len = 0;
+			g_autofree guchar *data = g_base64_decode (icc_b64, &len);
+			gcm_convert_item_set_embedded (priv, item, data, len);
+		}
+		gcm_convert_queue_push (priv->decoded, g_steal_pointer (&item));
+	}
+	gcm_convert_queue_producer_done (priv->decoded);
+	return NULL;
+}
+
+static gboolean
+gcm_convert_item_process (GcmConvertPrivate *priv,
+			  GcmConvertItem *item,
+			  GError **error)
+{
+	CdIcc *input = item->embedded != NULL ? item->embedded : priv->input;
+	guint32 format;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+
+	/* converted as it is written */
+	if (item->tiff != NULL) {
+		format = gcm_utils_get_pixel_format_for_depth (gcm_tiff_get_bits_per_sample (item->tiff),
+							       FALSE,
+							       gcm_tiff_get_has_alpha (item->tiff));
+		item->transform = gcm_utils_transform_new (input,
+							   priv->abstract,
+							   priv->output,
+							   priv->intent,
+							   gcm_tiff_get_pixel_format (item->tiff),
+							   format,
+							   priv->bpc,
+							   error);
+		return item->transform != NULL;
+	}
+
+	/* the exact transform, as the result is kept */
+	format = gcm_utils_get_pixel_format_for_depth (gdk_pixbuf_get_bits_per_sample (item->pixbuf),
+						       FALSE,
+						       gdk_pixbuf_get_has_alpha (item->pixbuf));
+	if (format == 0) {
+		g_set_error_literal (error, 1, 0, "pixel format not supported");
+		return FALSE;
+	}
+	transform = gcm_utils_transform_new (input,
+					     priv->abstract,
+					     priv->output,
+					     priv->intent,
+					     format, format,
+					     priv->bpc,
+					     error);
+	if (transform == NULL)
+		return FALSE;
+	return gcm_utils_transform_process (transform,
+					    gdk_pixbuf_get_pixels (item->pixbuf),
+					    (guint) gdk_pixbuf_get_rowstride (item->pixbuf),
+					    gdk_pixbuf_get_pixels (item->pixbuf),
+					    (guint) gdk_pixbuf_get_rowstride (item->pixbuf),
+					    (guint) gdk_pixbuf_get_width (item->pixbuf),
+					    (guint) gdk_pixbuf_get_height (item->pixbuf),
+					    NULL, error);
+}
+
+static gpointer
+gcm_convert_convert_thread_cb (gpointer user_data)
+{
+	GcmConvertPrivate *priv = (GcmConvertPrivate *) user_data;
+	GcmConvertItem *item;
+
+	/* one image at a time, as creating the transform is cheap next to
+	 * decoding; each is run on all the pool threads */
+	while ((item = gcm_convert_queue_pop (priv->decoded)) != NULL) {
+		g_autoptr(GError) error = NULL;
+		if (!gcm_convert_item_process (priv, item, &error)) {
+			gcm_convert_item_failed (priv, item, error);
+			gcm_convert_item_free (item);
+			continue;
+		}
+		gcm_convert_queue_push (priv->converted, item);
+	}
+	gcm_convert_queue_producer_done (priv->converted);
+	return NULL;
+}
+
+static gpointer
+gcm_convert_encode_thread_cb (gpointer user_data)
+{
+	GcmConvertPrivate *priv = (GcmConvertPrivate *) user_data;
+	GcmConvertItem *item;
+
+	while ((item = gcm_convert_queue_pop (priv->converted)) != NULL) {
+		const gchar *type = gcm_convert_get_pixbuf_type (item->file_out);
+		gboolean ret;
+		g_autofree gchar *path = g_file_get_path (item->file_out);
+		g_autoptr(GError) error = NULL;
+
+		if (item->tiff != NULL) {
+			ret = gcm_tiff_convert_file (item->tiff, item->transform,
+						     item->file_out, priv->output_data,
+						     NULL, &error);
+		} else if (priv->output_b64 != NULL) {
+			ret = gdk_pixbuf_save (item->pixbuf, path, type, &error,
+					       "icc-profile", priv->output_b64,
+					       NULL);
+		} else {
+			ret = gdk_pixbuf_save (item->pixbuf, path, type, &error,
+					       NULL);
+		}
+		if (!ret)
+			gcm_convert_item_failed (priv, item, error);
+		else
+			g_debug ("wrote %s", path);
+		gcm_convert_item_free (item);
+	}
+	return NULL;
+}
+
+static CdIcc *
+gcm_convert_load_profile (CdClient **client, const gchar *id, GError **error)
+{
+	g_autoptr(CdIcc) icc = NULL;
+	g_autoptr(CdProfile) profile = NULL;
+
+	/* a filename */
+	if (g_file_test (id, G_FILE_TEST_EXISTS)) {
+		g_autoptr(GFile) file = g_file_new_for_commandline_arg (id);
+		icc = cd_icc_new ();
+		if (!cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE,
+				       NULL, error))
+			return NULL;
+		return g_steal_pointer (&icc);
+	}
+
+	/* a colord profile ID */
+	if (*client == NULL) {
+		*client = cd_client_new ();
+		if (!cd_client_connect_sync (*client, NULL, error))
+			return NULL;
+	}
+	profile = cd_client_find_profile_sync (*client, id, NULL, error);
+	if (profile == NULL)
+		return NULL;
+	if (!cd_profile_connect_sync (profile, NULL, error))
+		return NULL;
+	return cd_profile_load_icc (profile, CD_ICC_LOAD_FLAGS_NONE, NULL, error);
+}
+
+static gboolean
+gcm_convert_load_profiles (GcmConvertPrivate *priv,
+			   CdClient **client,
+			   const gchar *input,
+			   const gchar *abstract,
+			   const gchar *output,
+			   GError **error)
+{
+	if (input != NULL) {
+		priv->input = gcm_convert_load_profile (client, input, error);
+		if (priv->input == NULL)
+			return FALSE;
+	}
+	if (abstract != NULL) {
+		priv->abstract = gcm_convert_load_profile (client, abstract, error);
+		if (priv->abstract == NULL)
+			return FALSE;
+	}
+	if (output == NULL)
+		return TRUE;
+	priv->output = gcm_convert_load_profile (client, output, error);
+	if (priv->output == NULL)
+		return FALSE;
+
+	/* embedded in every image that is written */
+	priv->output_data = cd_icc_save_data (priv->output, CD_ICC_SAVE_FLAGS_NONE, error);
+	if (priv->output_data == NULL)
+		return FALSE;
+	priv->output_b64 = g_base64_encode (g_bytes_get_data (priv->output_data, NULL),
+					    g_bytes_get_size (priv->output_data));
+	return TRUE;
+}
+
+static gboolean
+gcm_convert_add_files (GPtrArray *files, const gchar *arg, GError **error)
+{
+	g_autoptr(GFile) file = g_file_new_for_commandline_arg (arg);
+	g_autoptr(GFileEnumerator) enumerator = NULL;
+
+	if (g_file_query_file_type (file, G_FILE_QUERY_INFO_NONE, NULL) != G_FILE_TYPE_DIRECTORY) {
+		g_ptr_array_add (files, g_steal_pointer (&file));
+		return TRUE;
+	}
+
+	/* only the images directly inside the directory */
+	enumerator = g_file_enumerate_children (file,
+						G_FILE_ATTRIBUTE_STANDARD_NAME ","
+						G_FILE_ATTRIBUTE_STANDARD_TYPE,
+						G_FILE_QUERY_INFO_NONE,
+						NULL, error);
+	if (enumerator == NULL)
+		return FALSE;
+	for (;;) {
+		GFileInfo *info = NULL;
+		if (!g_file_enumerator_iterate (enumerator, &info, NULL, NULL, error))
+			return FALSE;
+		if (info == NULL)
+			break;
+		if (g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR)
+			continue;
+		g_ptr_array_add (files, g_file_get_child (file, g_file_info_get_name (info)));
+	}
+	return TRUE;
+}
+
+static CdRenderingIntent
+gcm_convert_get_intent (const gchar *intent)
+{
+	if (intent == NULL || g_strcmp0 (intent, "perceptual") == 0)
+		return CD_RENDERING_INTENT_PERCEPTUAL;
+	if (g_strcmp0 (intent, "relative") == 0)
+		return CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC;
+	if (g_strcmp0 (intent, "saturation") == 0)
+		return CD_RENDERING_INTENT_SATURATION;
+	if (g_strcmp0 (intent, "absolute") == 0)
+		return CD_RENDERING_INTENT_ABSOLUTE_COLORIMETRIC;
+	return CD_RENDERING_INTENT_UNKNOWN;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	gboolean bpc = FALSE;
+	gint jobs = 0;
+	g_autofree gchar *abstract = NULL;
+	g_autofree gchar *format = NULL;
+	g_autofree gchar *input = NULL;
+	g_autofree gchar *intent = NULL;
+	g_autofree gchar *output = NULL;
+	g_autofree gchar *output_dir = NULL;
+	g_autoptr(CdClient) client = NULL;
+	g_autoptr(GcmConvertPrivate) priv = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) threads = g_ptr_array_new ();
+
+	const GOptionEntry options[] = {
+		{ "input", '\0', 0, G_OPTION_ARG_STRING, &input,
+			/* TRANSLATORS: command line option */
+			_("Input profile filename or ID, otherwise the embedded profile or sRGB"), NULL },
+		{ "abstract", '\0', 0, G_OPTION_ARG_STRING, &abstract,
+			/* TRANSLATORS: command line option */
+			_("Abstract profile filename or ID"), NULL },
+		{ "output", '\0', 0, G_OPTION_ARG_STRING, &output,
+			/* TRANSLATORS: command line option */
+			_("Output profile filename or ID, otherwise sRGB"), NULL },
+		{ "intent", '\0', 0, G_OPTION_ARG_STRING, &intent,
+			/* TRANSLATORS: command line option, do not translate the values */
+			_("Rendering intent, one of perceptual, relative, saturation or absolute"), NULL },
+		{ "format", '\0', 0, G_OPTION_ARG_STRING, &format,
+			/* TRANSLATORS: command line option, do not translate the values */
+			_("Output format, one of png, jpeg or tiff, otherwise the same as each image"), NULL },
+		{ "bpc", '\0', 0, G_OPTION_ARG_NONE, &bpc,
+			/* TRANSLATORS: command line option */
+			_("Use black point compensation"), NULL },
+		{ "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+			/* TRANSLATORS: command line option */
+			_("Number of images to decode and encode at once"), NULL },
+		{ "output-dir", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+			/* TRANSLATORS: command line option */
+			_("Directory to write the converted images to"), NULL },
+		{ NULL}
+	};
+
+	setlocale (LC_ALL, "");
+
+	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+	textdomain (GETTEXT_PACKAGE);
+
+	/* TRANSLATORS: the arguments for the image converter */
+	context = g_option_context_new (_("IMAGE|DIRECTORY..."));
+	/* TRANSLATORS: converts images between profiles */
+	g_option_context_set_summary (context, _("Image color conversion program"));
+	g_option_context_add_main_entries (context, options, NULL);
+	g_option_context_add_group (context, gcm_debug_get_option_group ());
+	g_option_context_parse (context, &argc, &argv, NULL);
+	g_option_context_free (context);
+
+	if (argc < 2 || output_dir == NULL) {
+		/* TRANSLATORS: the user did not specify the files */
+		g_print ("%s\n", _("An output directory and at least one image are required"));
+		return EXIT_FAILURE;
+	}
+
+	priv = g_new0 (GcmConvertPrivate, 1);
+	priv->files = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->output_dir = g_file_new_for_commandline_arg (output_dir);
+	priv->bpc = bpc;
+	priv->intent = gcm_convert_get_intent (intent);
+	if (priv->intent == CD_RENDERING_INTENT_UNKNOWN) {
+		/* TRANSLATORS: the --intent value was not recognized */
+		g_print ("%s %s\n", _("Rendering intent not known:"), intent);
+		return EXIT_FAILURE;
+	}
+	if (format != NULL) {
+		priv->output_ext = gcm_convert_get_format_ext (format);
+		if (priv->output_ext == NULL) {
+			/* TRANSLATORS: the --format value was not recognized */
+			g_print ("%s %s\n", _("Output format not known:"), format);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* load the profiles once, they are shared by every image */
+	if (!gcm_convert_load_profiles (priv, &client, input, abstract, output, &error)) {
+		/* TRANSLATORS: the profile could not be loaded */
+		g_print ("%s %s\n", _("Failed to load profile:"), error->message);
+		return EXIT_FAILURE;
+	}
+
+	for (gint i = 1; i < argc; i++) {
+		if (!gcm_convert_add_files (priv->files, argv[i], &error)) {
+			/* TRANSLATORS: a directory could not be read */
+			g_print ("%s %s\n", _("Failed to read directory:"), error->message);
+			return EXIT_FAILURE;
+		}
+	}
+	if (!gcm_convert_check_output_names (priv, &error)) {
+		/* TRANSLATORS: two images would be written to the same file */
+		g_print ("%s %s\n", _("Output filenames are not unique:"), error->message);
+		return EXIT_FAILURE;
+	}
+	if (!g_file_make_directory_with_parents (priv->output_dir, NULL, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
+			/* TRANSLATORS: the output directory could not be created */
+			g_print ("%s %s\n", _("Failed to create directory:"), error->message);
+			return EXIT_FAILURE;
+		}
+		g_clear_error (&error);
+	}
+
+	/* decoding and encoding are the slow parts, the conversion itself
+	 * is split across the worker pool */
+	if (jobs <= 0)
+		jobs = (gint) MIN (g_get_num_processors (), 8);
+	priv->decoded = gcm_convert_queue_new (GCM_CONVERT_QUEUE_SIZE, (guint) jobs);
+	priv->converted = gcm_convert_queue_new (GCM_CONVERT_QUEUE_SIZE, 1);
+	for (gint i = 0; i < jobs; i++) {
+		g_ptr_array_add (threads, g_thread_new ("gcm-decode",
+							gcm_convert_decode_thread_cb,
+							priv));
+	}
+	g_ptr_array_add (threads, g_thread_new ("gcm-convert",
+						gcm_convert_convert_thread_cb,
+						priv));
+	for (gint i = 0; i < jobs; i++) {
+		g_ptr_array_add (threads, g_thread_new ("gcm-encode",
+							gcm_convert_encode_thread_cb,
+							priv));
+	}
+	for (guint i = 0; i < threads->len; i++)
+		g_thread_join (g_ptr_array_index (threads, i));
+	gcm_convert_queue_free (priv->decoded);
+	gcm_convert_queue_free (priv->converted);
+
+	if (priv->n_failed > 0) {
+		/* TRANSLATORS: some of the images could not be converted */
+		g_print ("%s %i/%u\n", _("Images not converted:"),
+			 priv->n_failed, priv->files->len);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <colord.h>
+
+#include "gcm-debug.h"
+#include "gcm-palette.h"
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	const gchar *title;
+	g_autofree gchar *title_tmp = NULL;
+	g_autoptr(CdIcc) icc = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file_in = NULL;
+	g_autoptr(GFile) file_out = NULL;
+	g_autoptr(GPtrArray) colors = NULL;
+
+	const GOptionEntry options[] = {
+		{ "title", '\0', 0, G_OPTION_ARG_STRING, &title_tmp,
+			/* TRANSLATORS: command line option */
+			_("Set the palette name"), NULL },
+		{ NULL}
+	};
+
+	setlocale (LC_ALL, "");
+
+	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+	textdomain (GETTEXT_PACKAGE);
+
+	/* TRANSLATORS: the arguments for the palette exporter */
+	context = g_option_context_new (_("PROFILE.icc PALETTE.[gpl|ase|cxf]"));
+	/* TRANSLATORS: exports named colors from a profile */
+	g_option_context_set_summary (context, _("Named color palette export program"));
+	g_option_context_add_main_entries (context, options, NULL);
+	g_option_context_add_group (context, gcm_debug_get_option_group ());
+	g_option_context_parse (context, &argc, &argv, NULL);
+	g_option_context_free (context);
+
+	if (argc != 3) {
+		/* TRANSLATORS: the user did not specify the files */
+		g_print ("%s\n", _("A profile and palette filename are required"));
+		return EXIT_FAILURE;
+	}
+
+	/* only load what we need */
+	icc = cd_icc_new ();
+	file_in = g_file_new_for_commandline_arg (argv[1]);
+	if (!cd_icc_load_file (icc, file_in,
+			       CD_ICC_LOAD_FLAGS_NAMED_COLORS |
+			       CD_ICC_LOAD_FLAGS_TRANSLATIONS,
+			       NULL, &error)) {
+		/* TRANSLATORS: the profile could not be loaded */
+		g_print ("%s %s\n", _("Failed to load profile:"), error->message);
+		return EXIT_FAILURE;
+	}
+	colors = cd_icc_get_named_colors (icc);
+	if (colors->len == 0) {
+		/* TRANSLATORS: the profile is not a named color profile */
+		g_print ("%s\n", _("The profile has no named colors"));
+		return EXIT_FAILURE;
+	}
+
+	/* stream the swatches to the palette */
+	title = title_tmp;
+	if (title == NULL)
+		title = cd_icc_get_description (icc, NULL, NULL);
+	file_out = g_file_new_for_commandline_arg (argv[2]);
+	if (!gcm_palette_export_file (colors, title, file_out, NULL, &error)) {
+		/* TRANSLATORS: the palette could not be written */
+		g_print ("%s %s\n", _("Failed to export palette:"), error->message);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
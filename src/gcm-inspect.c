@@ -296,6 +296,56 @@ gcm_inspect_show_profile_for_window (guint xid)
 	return TRUE;
 }
 
+static gboolean
+gcm_inspect_check_banding (const gchar *filename)
+{
+	gboolean ret;
+	gboolean found = FALSE;
+	const gchar *channels[] = {
+		/* TRANSLATORS: a color channel */
+		_("Red"),
+		/* TRANSLATORS: a color channel */
+		_("Green"),
+		/* TRANSLATORS: a color channel */
+		_("Blue") };
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GcmUtilsBanding) banding = gcm_utils_banding_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path (filename);
+
+	ret = cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE, NULL, &error);
+	if (!ret) {
+		/* TRANSLATORS: the profile could not be loaded */
+		g_print ("%s %s\n", _("Failed to load profile:"), error->message);
+		return FALSE;
+	}
+	ret = gcm_utils_pixbuf_ramps (NULL, icc, banding, NULL, &error);
+	if (!ret) {
+		/* TRANSLATORS: the gradients could not be converted with the profile */
+		g_print ("%s %s\n", _("Failed to convert gradients:"), error->message);
+		return FALSE;
+	}
+
+	/* TRANSLATORS: this is the banding in gradients shown with a display profile */
+	g_print ("%s %s\n", _("Banding for:"), filename);
+	for (guint c = 0; c < 3; c++) {
+		guint levels = 0;
+		guint steps = 0;
+		guint reversals = 0;
+		gcm_utils_banding_get_stats (banding, c, &levels, &steps, &reversals);
+		g_print (" - ");
+		/* TRANSLATORS: the first is a color channel, then the number of
+		 * distinct output levels, quantization steps and places the
+		 * output falls in the gradients */
+		g_print (_("%s: %u levels, %u steps, %u reversals"),
+			 channels[c], levels, steps, reversals);
+		g_print ("\n");
+		if (steps > 0 || reversals > 0)
+			found = TRUE;
+	}
+	return !found;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -304,6 +354,7 @@ main (int argc, char **argv)
 	guint xid = 0;
 	guint retval = 0;
 	GOptionContext *context;
+	g_autofree gchar *banding = NULL;
 	g_autofree gchar *filename = NULL;
 
 	const GOptionEntry options[] = {
@@ -319,6 +370,10 @@ main (int argc, char **argv)
 		{ "dump", 'd', 0, G_OPTION_ARG_NONE, &dump,
 			/* TRANSLATORS: command line option */
 			_("Dump all details about this system"), NULL },
+		{ "banding", '\0', 0, G_OPTION_ARG_FILENAME, &banding,
+			/* TRANSLATORS: command line option, which fails if the
+			 * display profile would show steps in gradients */
+			_("Check a display profile for banding"), NULL },
 		{ NULL}
 	};
 
@@ -344,6 +399,8 @@ main (int argc, char **argv)
 		gcm_inspect_show_profiles_for_file (filename);
 	if (xid != 0)
 		gcm_inspect_show_profile_for_window (xid);
+	if (banding != NULL && !gcm_inspect_check_banding (banding))
+		retval = 1;
 
 	return retval;
 }
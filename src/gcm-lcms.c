@@ -0,0 +1,267 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+#include <lcms2.h>
+#ifdef HAVE_LCMS2_FAST_FLOAT
+#include <lcms2_fast_float.h>
+#endif
+
+#include "gcm-lcms.h"
+
+/*
+ * Each thread gets its own LCMS context, so transforms can be created on
+ * any thread without sharing plugin or error state, and without locks.
+ * When a thread exits its context goes back to a pool rather than being
+ * deleted, as transforms created in it may still be used elsewhere.
+ */
+
+/* more than a picker or swatch uses at the same time */
+#define GCM_LCMS_TRANSFORMS_MAX		32
+
+typedef struct {
+	cmsContext	 context;
+	GHashTable	*transforms;	/* key to GcmLcmsTransform */
+	guint64		 clock;
+} GcmLcmsContext;
+
+typedef struct {
+	cmsHTRANSFORM	 handle;
+	guint64		 used;
+} GcmLcmsTransform;
+
+static void gcm_lcms_context_release (GcmLcmsContext *ctx);
+
+static GMutex	 gcm_lcms_pool_mutex;
+static GSList	*gcm_lcms_pool = NULL;		/* of GcmLcmsContext, unused */
+static GPrivate	 gcm_lcms_current = G_PRIVATE_INIT ((GDestroyNotify) gcm_lcms_context_release);
+static GPrivate	 gcm_lcms_error = G_PRIVATE_INIT (g_free);
+
+static void
+gcm_lcms_transform_free (GcmLcmsTransform *transform)
+{
+	cmsDeleteTransform (transform->handle);
+	g_free (transform);
+}
+
+/* only ever called on the thread that made the failing call */
+static void
+gcm_lcms_error_cb (cmsContext context_id, cmsUInt32Number error_code, const char *text)
+{
+	g_debug ("LCMS error %u: %s", error_code, text);
+	g_private_replace (&gcm_lcms_error, g_strdup (text));
+}
+
+static void
+gcm_lcms_context_release (GcmLcmsContext *ctx)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&gcm_lcms_pool_mutex);
+	gcm_lcms_pool = g_slist_prepend (gcm_lcms_pool, ctx);
+}
+
+static GcmLcmsContext *
+gcm_lcms_context_acquire (void)
+{
+	GcmLcmsContext *ctx = g_private_get (&gcm_lcms_current);
+
+	/* reuse a context from a thread that has exited */
+	if (ctx != NULL)
+		return ctx;
+	g_mutex_lock (&gcm_lcms_pool_mutex);
+	if (gcm_lcms_pool != NULL) {
+		ctx = gcm_lcms_pool->data;
+		gcm_lcms_pool = g_slist_delete_link (gcm_lcms_pool, gcm_lcms_pool);
+	}
+	g_mutex_unlock (&gcm_lcms_pool_mutex);
+
+	if (ctx == NULL) {
+		ctx = g_new0 (GcmLcmsContext, 1);
+#ifdef HAVE_LCMS2_FAST_FLOAT
+		ctx->context = cmsCreateContext (cmsFastFloatExtensions (), ctx);
+#else
+		ctx->context = cmsCreateContext (NULL, ctx);
+#endif
+		cmsSetLogErrorHandlerTHR (ctx->context, gcm_lcms_error_cb);
+		ctx->transforms = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							 (GDestroyNotify) gcm_lcms_transform_free);
+	}
+	g_private_set (&gcm_lcms_current, ctx);
+	return ctx;
+}
+
+/**
+ * gcm_lcms_get_context:
+ *
+ * Gets the LCMS context for the calling thread. When built with the fast
+ * float plugin the 8 bit and float matrix-shaper transforms use its
+ * optimized paths.
+ *
+ * Transforms created in the context can be used from any thread, and stay
+ * valid after the calling thread exits.
+ *
+ * Any LCMS error already logged on the calling thread is forgotten, so get
+ * the context just before the calls that gcm_lcms_set_error() reports on.
+ *
+ * Returns: a context, which must not be deleted
+ **/
+cmsContext
+gcm_lcms_get_context (void)
+{
+	GcmLcmsContext *ctx = gcm_lcms_context_acquire ();
+	g_private_replace (&gcm_lcms_error, NULL);
+	return ctx->context;
+}
+
+/**
+ * gcm_lcms_set_error:
+ * @error: a #GError, or %NULL
+ * @message: what failed
+ *
+ * Sets @error with the last LCMS error logged on the calling thread, which
+ * is then forgotten.
+ **/
+void
+gcm_lcms_set_error (GError **error, const gchar *message)
+{
+	const gchar *text = g_private_get (&gcm_lcms_error);
+
+	if (text == NULL) {
+		g_set_error_literal (error, 1, 0, message);
+		return;
+	}
+	g_set_error (error, 1, 0, "%s: %s", message, text);
+	g_private_replace (&gcm_lcms_error, NULL);
+}
+
+static gchar *
+gcm_lcms_get_profile_key (const gchar *profile)
+{
+	GStatBuf st;
+
+	/* a file can be replaced at any time */
+	if (profile[0] == '*')
+		return g_strdup (profile);
+	if (g_stat (profile, &st) != 0)
+		return NULL;
+	return g_strdup_printf ("%s:%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+				profile, (gint64) st.st_mtime, (gint64) st.st_size);
+}
+
+static cmsHPROFILE
+gcm_lcms_open_profile (cmsContext context, const gchar *profile)
+{
+	if (g_strcmp0 (profile, GCM_LCMS_PROFILE_SRGB) == 0)
+		return cmsCreate_sRGBProfileTHR (context);
+	if (g_strcmp0 (profile, GCM_LCMS_PROFILE_LAB2) == 0)
+		return cmsCreateLab2ProfileTHR (context, NULL);
+	if (g_strcmp0 (profile, GCM_LCMS_PROFILE_LAB4) == 0)
+		return cmsCreateLab4ProfileTHR (context, NULL);
+	if (g_strcmp0 (profile, GCM_LCMS_PROFILE_XYZ) == 0)
+		return cmsCreateXYZProfileTHR (context);
+	return cmsOpenProfileFromFileTHR (context, profile, "r");
+}
+
+/* called on the owning thread */
+static void
+gcm_lcms_context_evict (GcmLcmsContext *ctx)
+{
+	GHashTableIter iter;
+	GcmLcmsTransform *transform;
+	gpointer key;
+	gpointer key_oldest = NULL;
+	guint64 used_oldest = G_MAXUINT64;
+
+	if (g_hash_table_size (ctx->transforms) < GCM_LCMS_TRANSFORMS_MAX)
+		return;
+	g_hash_table_iter_init (&iter, ctx->transforms);
+	while (g_hash_table_iter_next (&iter, &key, (gpointer *) &transform)) {
+		if (transform->used >= used_oldest)
+			continue;
+		used_oldest = transform->used;
+		key_oldest = key;
+	}
+	g_hash_table_remove (ctx->transforms, key_oldest);
+}
+
+/**
+ * gcm_lcms_get_transform:
+ * @profile_in: a filename or one of the built in profiles like
+ *	%GCM_LCMS_PROFILE_SRGB
+ * @format_in: the LCMS pixel format of the source
+ * @profile_out: a filename or one of the built in profiles
+ * @format_out: the LCMS pixel format of the destination
+ * @intent: the LCMS rendering intent
+ * @error: a #GError, or %NULL
+ *
+ * Gets a transform created in the context of the calling thread, which is
+ * cached so showing a color does not open and parse profiles every time.
+ *
+ * Returns: (transfer none): a transform, which stays valid while it is
+ *	one of the most recently used on this thread
+ **/
+cmsHTRANSFORM
+gcm_lcms_get_transform (const gchar *profile_in,
+			cmsUInt32Number format_in,
+			const gchar *profile_out,
+			cmsUInt32Number format_out,
+			cmsUInt32Number intent,
+			GError **error)
+{
+	GcmLcmsContext *ctx = gcm_lcms_context_acquire ();
+	GcmLcmsTransform *transform;
+	cmsHPROFILE profile_in_handle;
+	cmsHPROFILE profile_out_handle;
+	cmsHTRANSFORM handle = NULL;
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *key_in = NULL;
+	g_autofree gchar *key_out = NULL;
+
+	/* already created on this thread */
+	key_in = gcm_lcms_get_profile_key (profile_in);
+	key_out = gcm_lcms_get_profile_key (profile_out);
+	if (key_in == NULL || key_out == NULL) {
+		g_set_error (error, 1, 0, "failed to open %s",
+			     key_in == NULL ? profile_in : profile_out);
+		return NULL;
+	}
+	key = g_strdup_printf ("%s|%u|%s|%u|%u",
+			       key_in, format_in, key_out, format_out, intent);
+	transform = g_hash_table_lookup (ctx->transforms, key);
+	if (transform != NULL) {
+		transform->used = ++ctx->clock;
+		return transform->handle;
+	}
+
+	/* only report what goes wrong from here */
+	g_private_replace (&gcm_lcms_error, NULL);
+	profile_in_handle = gcm_lcms_open_profile (ctx->context, profile_in);
+	profile_out_handle = gcm_lcms_open_profile (ctx->context, profile_out);
+	if (profile_in_handle != NULL && profile_out_handle != NULL) {
+		handle = cmsCreateTransformTHR (ctx->context,
+						profile_in_handle, format_in,
+						profile_out_handle, format_out,
+						intent, 0);
+	}
+	if (profile_in_handle != NULL)
+		cmsCloseProfile (profile_in_handle);
+	if (profile_out_handle != NULL)
+		cmsCloseProfile (profile_out_handle);
+	if (handle == NULL) {
+		gcm_lcms_set_error (error, "failed to create transform");
+		return NULL;
+	}
+
+	/* keep the most recently used */
+	gcm_lcms_context_evict (ctx);
+	transform = g_new0 (GcmLcmsTransform, 1);
+	transform->handle = handle;
+	transform->used = ++ctx->clock;
+	g_hash_table_insert (ctx->transforms, g_steal_pointer (&key), transform);
+	return handle;
+}
@@ -0,0 +1,27 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <lcms2.h>
+
+/* built in profiles, anything else is a filename */
+#define GCM_LCMS_PROFILE_SRGB		"*sRGB"
+#define GCM_LCMS_PROFILE_LAB2		"*Lab2"		/* D50 */
+#define GCM_LCMS_PROFILE_LAB4		"*Lab4"		/* D50 */
+#define GCM_LCMS_PROFILE_XYZ		"*XYZ"
+
+cmsContext	 gcm_lcms_get_context		(void);
+cmsHTRANSFORM	 gcm_lcms_get_transform		(const gchar		*profile_in,
+						 cmsUInt32Number	 format_in,
+						 const gchar		*profile_out,
+						 cmsUInt32Number	 format_out,
+						 cmsUInt32Number	 intent,
+						 GError			**error);
+void		 gcm_lcms_set_error		(GError			**error,
+						 const gchar		*message);
@@ -0,0 +1,340 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <lcms2.h>
+
+#include "gcm-lut.h"
+#include "gcm-utils.h"
+
+/*
+ * The whole transform is sampled once on a regular grid at 16 bits per
+ * channel, and 8 bit pixels are then interpolated between the four nodes
+ * of the tetrahedron that contains them. Each node is padded to four
+ * channels so that all the channels of a node can be loaded and weighted
+ * at once; with GCC or Clang this uses the SSE2 or NEON registers that
+ * are always present on x86_64 and aarch64, and otherwise a plain loop.
+ */
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+#define GCM_LUT_HAVE_VECTOR	1
+typedef guint16 GcmLutNode __attribute__ ((vector_size (8)));
+typedef gint32 GcmLutAcc __attribute__ ((vector_size (16)));
+#endif
+
+#define GCM_LUT_MAGIC		"GCMLUT\0\1"
+#define GCM_LUT_BYTE_ORDER	0x01020304
+
+typedef struct {
+	gchar		 magic[8];
+	guint32		 byte_order;
+	guint32		 grid;
+} GcmLutHeader;
+
+struct _GcmLut {
+	guint		 grid;
+	guint16		*table;		/* grid^3 nodes of RGBX, blue fastest */
+	guint32		 offset_r[256];	/* of the lower node, in samples */
+	guint32		 offset_g[256];
+	guint32		 offset_b[256];
+	guint16		 frac[256];	/* 0..256 towards the upper node */
+};
+
+static gsize
+gcm_lut_get_table_size (guint grid)
+{
+	return (gsize) grid * grid * grid * 4 * sizeof (guint16);
+}
+
+static GcmLut *
+gcm_lut_new_for_grid (guint grid)
+{
+	GcmLut *lut = g_new0 (GcmLut, 1);
+	guint32 stride_b = 4;
+	guint32 stride_g = grid * stride_b;
+	guint32 stride_r = grid * stride_g;
+
+	lut->grid = grid;
+	lut->table = g_malloc0 (gcm_lut_get_table_size (grid));
+
+	/* an 8 bit value v lies at v * (grid - 1) / 255 */
+	for (guint v = 0; v < 256; v++) {
+		guint pos = v * (grid - 1);
+		guint idx = pos / 255;
+		guint frac = ((pos % 255) * 256 + 127) / 255;
+
+		/* the last node has nothing above it */
+		if (idx == grid - 1) {
+			idx--;
+			frac = 256;
+		}
+		lut->offset_r[v] = idx * stride_r;
+		lut->offset_g[v] = idx * stride_g;
+		lut->offset_b[v] = idx * stride_b;
+		lut->frac[v] = (guint16) frac;
+	}
+	return lut;
+}
+
+/**
+ * gcm_lut_new:
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @abstract: (nullable): an abstract profile, or %NULL
+ * @output: (nullable): the output profile, or %NULL for sRGB
+ * @grid: the number of nodes on each axis, e.g. %GCM_LUT_GRID_DEFAULT
+ *
+ * Bakes the transform into a 3D lookup table.
+ **/
+GcmLut *
+gcm_lut_new (CdIcc *input,
+	     CdIcc *abstract,
+	     CdIcc *output,
+	     CdRenderingIntent intent,
+	     gboolean bpc,
+	     guint grid,
+	     GError **error)
+{
+	guint n_nodes = grid * grid * grid;
+	g_autoptr(GcmLut) lut = NULL;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autofree guint16 *samples = NULL;
+
+	if (grid < 2 || grid > 256) {
+		g_set_error (error, 1, 0, "invalid grid size %u", grid);
+		return NULL;
+	}
+
+	/* the nodes are in the same order as the table */
+	samples = g_new (guint16, (gsize) n_nodes * 3);
+	for (guint r = 0; r < grid; r++) {
+		for (guint g = 0; g < grid; g++) {
+			for (guint b = 0; b < grid; b++) {
+				guint16 *tmp = samples + ((r * grid + g) * grid + b) * 3;
+				tmp[0] = (guint16) ((r * 65535 + (grid - 1) / 2) / (grid - 1));
+				tmp[1] = (guint16) ((g * 65535 + (grid - 1) / 2) / (grid - 1));
+				tmp[2] = (guint16) ((b * 65535 + (grid - 1) / 2) / (grid - 1));
+			}
+		}
+	}
+
+	/* the padding channel is skipped, so convert straight into the table */
+	transform = gcm_utils_transform_new (input, abstract, output, intent,
+					     TYPE_RGB_16, TYPE_RGBA_16, bpc, error);
+	if (transform == NULL)
+		return NULL;
+	lut = gcm_lut_new_for_grid (grid);
+	if (!gcm_utils_transform_process (transform,
+					  (const guint8 *) samples, grid * 3 * sizeof (guint16),
+					  (guint8 *) lut->table, grid * 4 * sizeof (guint16),
+					  grid, grid * grid, NULL, error))
+		return NULL;
+	return g_steal_pointer (&lut);
+}
+
+/**
+ * gcm_lut_new_from_file:
+ * @filename: a file written by gcm_lut_save()
+ *
+ * Loads a baked lookup table.
+ **/
+GcmLut *
+gcm_lut_new_from_file (const gchar *filename, GError **error)
+{
+	GcmLutHeader hdr;
+	gsize len = 0;
+	g_autofree gchar *data = NULL;
+	g_autoptr(GcmLut) lut = NULL;
+
+	if (!g_file_get_contents (filename, &data, &len, error))
+		return NULL;
+	if (len < sizeof (hdr)) {
+		g_set_error_literal (error, 1, 0, "lookup table truncated");
+		return NULL;
+	}
+	memcpy (&hdr, data, sizeof (hdr));
+	if (memcmp (hdr.magic, GCM_LUT_MAGIC, sizeof (hdr.magic)) != 0 ||
+	    hdr.byte_order != GCM_LUT_BYTE_ORDER) {
+		g_set_error_literal (error, 1, 0, "not a lookup table for this machine");
+		return NULL;
+	}
+	if (hdr.grid < 2 || hdr.grid > 256 ||
+	    len != sizeof (hdr) + gcm_lut_get_table_size (hdr.grid)) {
+		g_set_error_literal (error, 1, 0, "lookup table size invalid");
+		return NULL;
+	}
+	lut = gcm_lut_new_for_grid (hdr.grid);
+	memcpy (lut->table, data + sizeof (hdr), gcm_lut_get_table_size (hdr.grid));
+	return g_steal_pointer (&lut);
+}
+
+/**
+ * gcm_lut_save:
+ * @lut: a #GcmLut
+ * @filename: the file to write, which is replaced atomically
+ *
+ * Saves the lookup table so that it does not have to be baked again. The
+ * file is only meant to be read on the same machine.
+ **/
+gboolean
+gcm_lut_save (GcmLut *lut, const gchar *filename, GError **error)
+{
+	GcmLutHeader hdr;
+	gsize len = gcm_lut_get_table_size (lut->grid);
+	g_autofree gchar *data = g_malloc (sizeof (hdr) + len);
+
+	memset (&hdr, 0, sizeof (hdr));
+	memcpy (hdr.magic, GCM_LUT_MAGIC, sizeof (hdr.magic));
+	hdr.byte_order = GCM_LUT_BYTE_ORDER;
+	hdr.grid = lut->grid;
+	memcpy (data, &hdr, sizeof (hdr));
+	memcpy (data + sizeof (hdr), lut->table, len);
+	return g_file_set_contents (filename, data, (gssize) (sizeof (hdr) + len), error);
+}
+
+void
+gcm_lut_free (GcmLut *lut)
+{
+	if (lut == NULL)
+		return;
+	g_free (lut->table);
+	g_free (lut);
+}
+
+guint
+gcm_lut_get_grid (GcmLut *lut)
+{
+	return lut->grid;
+}
+
+/* 16 bit to 8 bit, rounded */
+static inline guint8
+gcm_lut_to_8 (gint32 value)
+{
+	return (guint8) ((value * 255 + 32895) >> 16);
+}
+
+/**
+ * gcm_lut_process:
+ * @lut: a #GcmLut
+ * @src: a row of 8 bit RGB or RGBA pixels
+ * @src_bpp: 3 or 4
+ * @dst: a row of 8 bit RGB or RGBA pixels, which may be @src
+ * @dst_bpp: 3 or 4
+ * @width: the number of pixels
+ *
+ * Converts a row using tetrahedral interpolation. Any alpha channel is
+ * copied unchanged, or set to opaque if @src has none.
+ **/
+void
+gcm_lut_process (GcmLut *lut,
+		 const guint8 *src,
+		 guint src_bpp,
+		 guint8 *dst,
+		 guint dst_bpp,
+		 guint width)
+{
+	const guint32 stride_b = 4;
+	const guint32 stride_g = lut->grid * stride_b;
+	const guint32 stride_r = lut->grid * stride_g;
+
+	for (guint x = 0; x < width; x++) {
+		const guint16 *n0;
+		const guint16 *n1;
+		const guint16 *n2;
+		const guint16 *n3;
+		guint8 alpha = src_bpp == 4 ? src[3] : 0xff;
+		gint32 fr = lut->frac[src[0]];
+		gint32 fg = lut->frac[src[1]];
+		gint32 fb = lut->frac[src[2]];
+		gint32 w0;
+		gint32 w1;
+		gint32 w2;
+		gint32 w3;
+		guint32 s1;
+		guint32 s2;
+
+		/* walk from the lower node along the axis with the largest
+		 * fraction first, ending at the upper node */
+		n0 = lut->table + lut->offset_r[src[0]] +
+				  lut->offset_g[src[1]] +
+				  lut->offset_b[src[2]];
+		if (fr >= fg && fg >= fb) {
+			s1 = stride_r;
+			s2 = stride_g;
+			w1 = fr - fg;
+			w2 = fg - fb;
+			w3 = fb;
+		} else if (fr >= fb && fb >= fg) {
+			s1 = stride_r;
+			s2 = stride_b;
+			w1 = fr - fb;
+			w2 = fb - fg;
+			w3 = fg;
+		} else if (fg >= fr && fr >= fb) {
+			s1 = stride_g;
+			s2 = stride_r;
+			w1 = fg - fr;
+			w2 = fr - fb;
+			w3 = fb;
+		} else if (fg >= fb && fb >= fr) {
+			s1 = stride_g;
+			s2 = stride_b;
+			w1 = fg - fb;
+			w2 = fb - fr;
+			w3 = fr;
+		} else if (fb >= fr && fr >= fg) {
+			s1 = stride_b;
+			s2 = stride_r;
+			w1 = fb - fr;
+			w2 = fr - fg;
+			w3 = fg;
+		} else {
+			s1 = stride_b;
+			s2 = stride_g;
+			w1 = fb - fg;
+			w2 = fg - fr;
+			w3 = fr;
+		}
+		w0 = 256 - w1 - w2 - w3;
+		n1 = n0 + s1;
+		n2 = n1 + s2;
+		n3 = n0 + stride_r + stride_g + stride_b;
+
+#ifdef GCM_LUT_HAVE_VECTOR
+		{
+			GcmLutNode v0;
+			GcmLutNode v1;
+			GcmLutNode v2;
+			GcmLutNode v3;
+			GcmLutAcc acc;
+			memcpy (&v0, n0, sizeof (v0));
+			memcpy (&v1, n1, sizeof (v1));
+			memcpy (&v2, n2, sizeof (v2));
+			memcpy (&v3, n3, sizeof (v3));
+			acc = __builtin_convertvector (v0, GcmLutAcc) * w0 +
+			      __builtin_convertvector (v1, GcmLutAcc) * w1 +
+			      __builtin_convertvector (v2, GcmLutAcc) * w2 +
+			      __builtin_convertvector (v3, GcmLutAcc) * w3;
+			acc = (acc + 128) >> 8;
+			dst[0] = gcm_lut_to_8 (acc[0]);
+			dst[1] = gcm_lut_to_8 (acc[1]);
+			dst[2] = gcm_lut_to_8 (acc[2]);
+		}
+#else
+		for (guint c = 0; c < 3; c++) {
+			gint32 acc = n0[c] * w0 + n1[c] * w1 + n2[c] * w2 + n3[c] * w3;
+			dst[c] = gcm_lut_to_8 ((acc + 128) >> 8);
+		}
+#endif
+		if (dst_bpp == 4)
+			dst[3] = alpha;
+		src += src_bpp;
+		dst += dst_bpp;
+	}
+}
@@ -0,0 +1,39 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <colord.h>
+
+#define GCM_LUT_GRID_DEFAULT		33
+#define GCM_LUT_GRID_FINE		65
+
+typedef struct _GcmLut			GcmLut;
+
+GcmLut		*gcm_lut_new			(CdIcc			*input,
+						 CdIcc			*abstract,
+						 CdIcc			*output,
+						 CdRenderingIntent	 intent,
+						 gboolean		 bpc,
+						 guint			 grid,
+						 GError			**error);
+GcmLut		*gcm_lut_new_from_file		(const gchar		*filename,
+						 GError			**error);
+gboolean	 gcm_lut_save			(GcmLut			*lut,
+						 const gchar		*filename,
+						 GError			**error);
+void		 gcm_lut_free			(GcmLut			*lut);
+guint		 gcm_lut_get_grid		(GcmLut			*lut);
+void		 gcm_lut_process		(GcmLut			*lut,
+						 const guint8		*src,
+						 guint			 src_bpp,
+						 guint8			*dst,
+						 guint			 dst_bpp,
+						 guint			 width);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmLut, gcm_lut_free)
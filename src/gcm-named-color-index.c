@@ -0,0 +1,200 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gcm-named-color-index.h"
+
+/*
+ * The swatch names are case folded once into a single buffer and every
+ * three byte sequence is added to a table of posting lists. A query of
+ * three or more bytes only has to verify the entries of its rarest
+ * trigram, and when the user is typing the previous results are refined
+ * rather than searching the whole library again.
+ */
+
+struct _GcmNamedColorIndex {
+	GString		*names;		/* case folded, NUL separated */
+	GArray		*offsets;	/* of guint32, into @names */
+	GHashTable	*trigrams;	/* guint32 trigram -> GArray of guint32 */
+	gchar		*last_query;
+	GArray		*last_results;
+};
+
+static guint32
+gcm_named_color_index_trigram (const gchar *str)
+{
+	return ((guint32) (guchar) str[0] << 16) |
+	       ((guint32) (guchar) str[1] << 8) |
+	       (guint32) (guchar) str[2];
+}
+
+static void
+gcm_named_color_index_add_trigrams (GcmNamedColorIndex *idx,
+				    const gchar *name,
+				    guint32 value)
+{
+	gsize len = strlen (name);
+
+	for (gsize i = 0; i + 3 <= len; i++) {
+		GArray *posting;
+		guint32 key = gcm_named_color_index_trigram (name + i);
+
+		posting = g_hash_table_lookup (idx->trigrams, GUINT_TO_POINTER (key));
+		if (posting == NULL) {
+			posting = g_array_new (FALSE, FALSE, sizeof (guint32));
+			g_hash_table_insert (idx->trigrams, GUINT_TO_POINTER (key), posting);
+		}
+
+		/* names are added in order, so duplicates are always last */
+		if (posting->len > 0 &&
+		    g_array_index (posting, guint32, posting->len - 1) == value)
+			continue;
+		g_array_append_val (posting, value);
+	}
+}
+
+/**
+ * gcm_named_color_index_new:
+ * @colors: an array of #CdColorSwatch, as from cd_icc_get_named_colors()
+ *
+ * Builds a substring index over the swatch names.
+ **/
+GcmNamedColorIndex *
+gcm_named_color_index_new (GPtrArray *colors)
+{
+	GcmNamedColorIndex *idx;
+
+	idx = g_new0 (GcmNamedColorIndex, 1);
+	idx->names = g_string_new (NULL);
+	idx->offsets = g_array_sized_new (FALSE, FALSE, sizeof (guint32), colors->len);
+	idx->trigrams = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					       NULL, (GDestroyNotify) g_array_unref);
+	for (guint i = 0; i < colors->len; i++) {
+		CdColorSwatch *nc = g_ptr_array_index (colors, i);
+		const gchar *name = cd_color_swatch_get_name (nc);
+		guint32 offset = idx->names->len;
+		g_autofree gchar *folded = NULL;
+
+		folded = g_utf8_casefold (name != NULL ? name : "", -1);
+		g_string_append_len (idx->names, folded, strlen (folded) + 1);
+		g_array_append_val (idx->offsets, offset);
+		gcm_named_color_index_add_trigrams (idx, folded, i);
+	}
+	return idx;
+}
+
+void
+gcm_named_color_index_free (GcmNamedColorIndex *idx)
+{
+	if (idx == NULL)
+		return;
+	g_string_free (idx->names, TRUE);
+	g_array_unref (idx->offsets);
+	g_hash_table_unref (idx->trigrams);
+	if (idx->last_results != NULL)
+		g_array_unref (idx->last_results);
+	g_free (idx->last_query);
+	g_free (idx);
+}
+
+static gboolean
+gcm_named_color_index_match (GcmNamedColorIndex *idx, guint32 value, const gchar *query)
+{
+	guint32 offset = g_array_index (idx->offsets, guint32, value);
+	return strstr (idx->names->str + offset, query) != NULL;
+}
+
+/* returns the smallest posting list for the query, or %NULL if one of the
+ * trigrams does not exist at all, in which case nothing can match */
+static GArray *
+gcm_named_color_index_get_candidates (GcmNamedColorIndex *idx,
+				      const gchar *query,
+				      gboolean *no_match)
+{
+	GArray *best = NULL;
+	gsize len = strlen (query);
+
+	for (gsize i = 0; i + 3 <= len; i++) {
+		GArray *posting;
+		guint32 key = gcm_named_color_index_trigram (query + i);
+		posting = g_hash_table_lookup (idx->trigrams, GUINT_TO_POINTER (key));
+		if (posting == NULL) {
+			*no_match = TRUE;
+			return NULL;
+		}
+		if (best == NULL || posting->len < best->len)
+			best = posting;
+	}
+	return best;
+}
+
+/**
+ * gcm_named_color_index_search:
+ * @idx: a #GcmNamedColorIndex
+ * @query: a substring to match, case insensitively
+ *
+ * Finds all the swatches whose name contains @query.
+ *
+ * Returns: (transfer full): an array of guint32 swatch indexes in
+ * ascending order, or %NULL if the query is empty and everything matches
+ **/
+GArray *
+gcm_named_color_index_search (GcmNamedColorIndex *idx, const gchar *query)
+{
+	GArray *candidates = NULL;
+	GArray *results;
+	gboolean no_match = FALSE;
+	g_autofree gchar *folded = NULL;
+
+	g_return_val_if_fail (idx != NULL, NULL);
+
+	/* nothing to filter */
+	if (query == NULL || query[0] == '\0') {
+		g_clear_pointer (&idx->last_query, g_free);
+		g_clear_pointer (&idx->last_results, g_array_unref);
+		return NULL;
+	}
+
+	/* use the smallest set that is guaranteed to contain every match */
+	folded = g_utf8_casefold (query, -1);
+	if (g_strcmp0 (folded, idx->last_query) == 0 && idx->last_results != NULL)
+		return g_array_ref (idx->last_results);
+	candidates = gcm_named_color_index_get_candidates (idx, folded, &no_match);
+	if (idx->last_query != NULL && idx->last_results != NULL &&
+	    strstr (folded, idx->last_query) != NULL) {
+		if (candidates == NULL || idx->last_results->len < candidates->len)
+			candidates = idx->last_results;
+	}
+
+	results = g_array_new (FALSE, FALSE, sizeof (guint32));
+	if (no_match) {
+		/* a trigram is missing from every name */
+	} else if (candidates != NULL) {
+		for (guint i = 0; i < candidates->len; i++) {
+			guint32 value = g_array_index (candidates, guint32, i);
+			if (gcm_named_color_index_match (idx, value, folded))
+				g_array_append_val (results, value);
+		}
+	} else {
+		/* too short for the trigrams, but the names are contiguous */
+		for (guint32 i = 0; i < idx->offsets->len; i++) {
+			if (gcm_named_color_index_match (idx, i, folded))
+				g_array_append_val (results, i);
+		}
+	}
+
+	/* save for the next keystroke */
+	g_free (idx->last_query);
+	idx->last_query = g_steal_pointer (&folded);
+	if (idx->last_results != NULL)
+		g_array_unref (idx->last_results);
+	idx->last_results = g_array_ref (results);
+	return results;
+}
@@ -0,0 +1,20 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <colord.h>
+
+typedef struct _GcmNamedColorIndex	GcmNamedColorIndex;
+
+GcmNamedColorIndex *gcm_named_color_index_new		(GPtrArray		*colors);
+void		 gcm_named_color_index_free		(GcmNamedColorIndex	*idx);
+GArray		*gcm_named_color_index_search		(GcmNamedColorIndex	*idx,
+							 const gchar		*query);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmNamedColorIndex, gcm_named_color_index_free)
@@ -0,0 +1,315 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "gcm-named-color-model.h"
+
+/*
+ * This is a flat GtkTreeModel that wraps the array returned from
+ * cd_icc_get_named_colors() directly. Nothing is copied when the array is
+ * set; the row index is stored in the iter and the title and color values
+ * are only looked up when the view asks for a visible row. An optional
+ * filter maps each row to the index of a swatch in the array.
+ */
+
+static void gcm_named_color_model_tree_model_init (GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GcmNamedColorModel, gcm_named_color_model, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						gcm_named_color_model_tree_model_init))
+
+static gpointer parent_class = NULL;
+
+static guint
+gcm_named_color_model_get_n_rows (GcmNamedColorModel *model)
+{
+	if (model->colors == NULL)
+		return 0;
+	if (model->filter != NULL)
+		return model->filter->len;
+	return model->colors->len;
+}
+
+static CdColorSwatch *
+gcm_named_color_model_get_row (GcmNamedColorModel *model, guint idx)
+{
+	if (model->filter != NULL)
+		idx = g_array_index (model->filter, guint32, idx);
+	return g_ptr_array_index (model->colors, idx);
+}
+
+static gboolean
+gcm_named_color_model_iter_is_valid (GcmNamedColorModel *model, GtkTreeIter *iter)
+{
+	if (iter == NULL || iter->stamp != model->stamp)
+		return FALSE;
+	return GPOINTER_TO_UINT (iter->user_data) < gcm_named_color_model_get_n_rows (model);
+}
+
+static gboolean
+gcm_named_color_model_iter_set (GcmNamedColorModel *model, GtkTreeIter *iter, guint idx)
+{
+	if (idx >= gcm_named_color_model_get_n_rows (model)) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	iter->stamp = model->stamp;
+	iter->user_data = GUINT_TO_POINTER (idx);
+	iter->user_data2 = NULL;
+	iter->user_data3 = NULL;
+	return TRUE;
+}
+
+static GtkTreeModelFlags
+gcm_named_color_model_get_flags (GtkTreeModel *tree_model)
+{
+	return GTK_TREE_MODEL_ITERS_PERSIST | GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint
+gcm_named_color_model_get_n_columns (GtkTreeModel *tree_model)
+{
+	return GCM_NAMED_COLOR_MODEL_COLUMN_LAST;
+}
+
+static GType
+gcm_named_color_model_get_column_type (GtkTreeModel *tree_model, gint idx)
+{
+	if (idx == GCM_NAMED_COLOR_MODEL_COLUMN_TITLE)
+		return G_TYPE_STRING;
+	if (idx == GCM_NAMED_COLOR_MODEL_COLUMN_COLOR)
+		return CD_TYPE_COLOR_XYZ;
+	return G_TYPE_INVALID;
+}
+
+static gboolean
+gcm_named_color_model_get_iter (GtkTreeModel *tree_model,
+				GtkTreeIter *iter,
+				GtkTreePath *path)
+{
+	GcmNamedColorModel *model = GCM_NAMED_COLOR_MODEL (tree_model);
+	if (gtk_tree_path_get_depth (path) != 1)
+		return FALSE;
+	return gcm_named_color_model_iter_set (model, iter,
+					       gtk_tree_path_get_indices (path)[0]);
+}
+
+static GtkTreePath *
+gcm_named_color_model_get_path (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GcmNamedColorModel *model = GCM_NAMED_COLOR_MODEL (tree_model);
+	g_return_val_if_fail (gcm_named_color_model_iter_is_valid (model, iter), NULL);
+	return gtk_tree_path_new_from_indices (GPOINTER_TO_UINT (iter->user_data), -1);
+}
+
+static void
+gcm_named_color_model_get_value (GtkTreeModel *tree_model,
+				 GtkTreeIter *iter,
+				 gint column,
+				 GValue *value)
+{
+	CdColorSwatch *nc;
+	GcmNamedColorModel *model = GCM_NAMED_COLOR_MODEL (tree_model);
+
+	g_return_if_fail (gcm_named_color_model_iter_is_valid (model, iter));
+
+	/* the swatch is owned by the array, so no need to copy anything */
+	nc = gcm_named_color_model_get_row (model, GPOINTER_TO_UINT (iter->user_data));
+	switch (column) {
+	case GCM_NAMED_COLOR_MODEL_COLUMN_TITLE:
+		g_value_init (value, G_TYPE_STRING);
+		g_value_set_static_string (value, cd_color_swatch_get_name (nc));
+		break;
+	case GCM_NAMED_COLOR_MODEL_COLUMN_COLOR:
+		g_value_init (value, CD_TYPE_COLOR_XYZ);
+		g_value_set_static_boxed (value, cd_color_swatch_get_value (nc));
+		break;
+	default:
+		g_warning ("invalid column %i", column);
+		break;
+	}
+}
+
+static gboolean
+gcm_named_color_model_iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GcmNamedColorModel *model = GCM_NAMED_COLOR_MODEL (tree_model);
+	if (!gcm_named_color_model_iter_is_valid (model, iter))
+		return FALSE;
+	return gcm_named_color_model_iter_set (model, iter,
+					       GPOINTER_TO_UINT (iter->user_data) + 1);
+}
+
+static gboolean
+gcm_named_color_model_iter_previous (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GcmNamedColorModel *model = GCM_NAMED_COLOR_MODEL (tree_model);
+	guint idx;
+
+	if (!gcm_named_color_model_iter_is_valid (model, iter))
+		return FALSE;
+	idx = GPOINTER_TO_UINT (iter->user_data);
+	if (idx == 0) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	return gcm_named_color_model_iter_set (model, iter, idx - 1);
+}
+
+static gboolean
+gcm_named_color_model_iter_nth_child (GtkTreeModel *tree_model,
+				      GtkTreeIter *iter,
+				      GtkTreeIter *parent,
+				      gint n)
+{
+	GcmNamedColorModel *model = GCM_NAMED_COLOR_MODEL (tree_model);
+
+	/* this is a list, nodes have no children */
+	if (parent != NULL || n < 0) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	return gcm_named_color_model_iter_set (model, iter, (guint) n);
+}
+
+static gboolean
+gcm_named_color_model_iter_children (GtkTreeModel *tree_model,
+				     GtkTreeIter *iter,
+				     GtkTreeIter *parent)
+{
+	return gcm_named_color_model_iter_nth_child (tree_model, iter, parent, 0);
+}
+
+static gboolean
+gcm_named_color_model_iter_has_child (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	return FALSE;
+}
+
+static gint
+gcm_named_color_model_iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GcmNamedColorModel *model = GCM_NAMED_COLOR_MODEL (tree_model);
+	if (iter != NULL)
+		return 0;
+	return (gint) gcm_named_color_model_get_n_rows (model);
+}
+
+static gboolean
+gcm_named_color_model_iter_parent (GtkTreeModel *tree_model,
+				   GtkTreeIter *iter,
+				   GtkTreeIter *child)
+{
+	iter->stamp = 0;
+	return FALSE;
+}
+
+/**
+ * gcm_named_color_model_set_colors:
+ *
+ * Replaces the array backing the model. No rows signals are emitted, so
+ * callers should detach the model from any view before calling this and
+ * re-attach it afterwards; this is much faster than one signal per row.
+ **/
+void
+gcm_named_color_model_set_colors (GcmNamedColorModel *model, GPtrArray *colors)
+{
+	g_return_if_fail (GCM_IS_NAMED_COLOR_MODEL (model));
+
+	if (model->colors != NULL)
+		g_ptr_array_unref (model->colors);
+	model->colors = colors != NULL ? g_ptr_array_ref (colors) : NULL;
+
+	/* the old filter indexes refer to the old array */
+	gcm_named_color_model_set_filter (model, NULL);
+}
+
+/**
+ * gcm_named_color_model_set_filter:
+ * @filter: (nullable): an array of guint32 indexes into the colors, or %NULL
+ *
+ * Only shows the swatches listed in @filter, in that order. Like
+ * gcm_named_color_model_set_colors() no row signals are emitted.
+ **/
+void
+gcm_named_color_model_set_filter (GcmNamedColorModel *model, GArray *filter)
+{
+	g_return_if_fail (GCM_IS_NAMED_COLOR_MODEL (model));
+
+	if (model->filter != NULL)
+		g_array_unref (model->filter);
+	model->filter = filter != NULL ? g_array_ref (filter) : NULL;
+
+	/* invalidate any outstanding iters */
+	do {
+		model->stamp = g_random_int ();
+	} while (model->stamp == 0);
+}
+
+CdColorSwatch *
+gcm_named_color_model_get_swatch (GcmNamedColorModel *model, GtkTreeIter *iter)
+{
+	g_return_val_if_fail (GCM_IS_NAMED_COLOR_MODEL (model), NULL);
+	if (!gcm_named_color_model_iter_is_valid (model, iter))
+		return NULL;
+	return gcm_named_color_model_get_row (model, GPOINTER_TO_UINT (iter->user_data));
+}
+
+static void
+gcm_named_color_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags = gcm_named_color_model_get_flags;
+	iface->get_n_columns = gcm_named_color_model_get_n_columns;
+	iface->get_column_type = gcm_named_color_model_get_column_type;
+	iface->get_iter = gcm_named_color_model_get_iter;
+	iface->get_path = gcm_named_color_model_get_path;
+	iface->get_value = gcm_named_color_model_get_value;
+	iface->iter_next = gcm_named_color_model_iter_next;
+	iface->iter_previous = gcm_named_color_model_iter_previous;
+	iface->iter_children = gcm_named_color_model_iter_children;
+	iface->iter_has_child = gcm_named_color_model_iter_has_child;
+	iface->iter_n_children = gcm_named_color_model_iter_n_children;
+	iface->iter_nth_child = gcm_named_color_model_iter_nth_child;
+	iface->iter_parent = gcm_named_color_model_iter_parent;
+}
+
+static void
+gcm_named_color_model_finalize (GObject *object)
+{
+	GcmNamedColorModel *model = GCM_NAMED_COLOR_MODEL (object);
+	if (model->colors != NULL)
+		g_ptr_array_unref (model->colors);
+	if (model->filter != NULL)
+		g_array_unref (model->filter);
+	G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gcm_named_color_model_class_init (GcmNamedColorModelClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = gcm_named_color_model_finalize;
+	parent_class = g_type_class_peek_parent (class);
+}
+
+static void
+gcm_named_color_model_init (GcmNamedColorModel *model)
+{
+	model->colors = NULL;
+	model->filter = NULL;
+	model->stamp = 1;
+}
+
+GcmNamedColorModel *
+gcm_named_color_model_new (void)
+{
+	return g_object_new (GCM_TYPE_NAMED_COLOR_MODEL, NULL);
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <gtk/gtk.h>
+#include <colord.h>
+
+#define GCM_TYPE_NAMED_COLOR_MODEL		(gcm_named_color_model_get_type())
+#define GCM_NAMED_COLOR_MODEL(obj)		(G_TYPE_CHECK_INSTANCE_CAST((obj), GCM_TYPE_NAMED_COLOR_MODEL, GcmNamedColorModel))
+#define GCM_NAMED_COLOR_MODEL_CLASS(cls)	(G_TYPE_CHECK_CLASS_CAST((cls), GCM_TYPE_NAMED_COLOR_MODEL, GcmNamedColorModelClass))
+#define GCM_IS_NAMED_COLOR_MODEL(obj)		(G_TYPE_CHECK_INSTANCE_TYPE((obj), GCM_TYPE_NAMED_COLOR_MODEL))
+#define GCM_IS_NAMED_COLOR_MODEL_CLASS(cls)	(G_TYPE_CHECK_CLASS_TYPE((cls), GCM_TYPE_NAMED_COLOR_MODEL))
+#define GCM_NAMED_COLOR_MODEL_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS((obj), GCM_TYPE_NAMED_COLOR_MODEL, GcmNamedColorModelClass))
+
+typedef struct _GcmNamedColorModel		GcmNamedColorModel;
+typedef struct _GcmNamedColorModelClass		GcmNamedColorModelClass;
+
+struct _GcmNamedColorModel
+{
+	GObject			 parent;
+	GPtrArray		*colors;	/* of CdColorSwatch */
+	GArray			*filter;	/* of guint32, or NULL */
+	gint			 stamp;
+};
+
+struct _GcmNamedColorModelClass
+{
+	GObjectClass		 parent_class;
+};
+
+enum {
+	GCM_NAMED_COLOR_MODEL_COLUMN_TITLE,
+	GCM_NAMED_COLOR_MODEL_COLUMN_COLOR,
+	GCM_NAMED_COLOR_MODEL_COLUMN_LAST
+};
+
+GType		 gcm_named_color_model_get_type		(void);
+GcmNamedColorModel *gcm_named_color_model_new		(void);
+void		 gcm_named_color_model_set_colors	(GcmNamedColorModel	*model,
+							 GPtrArray		*colors);
+void		 gcm_named_color_model_set_filter	(GcmNamedColorModel	*model,
+							 GArray			*filter);
+CdColorSwatch	*gcm_named_color_model_get_swatch	(GcmNamedColorModel	*model,
+							 GtkTreeIter		*iter);
@@ -0,0 +1,245 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include "gcm-color-math.h"
+#include "gcm-named-color-search.h"
+
+/*
+ * CIEDE2000 is not a metric, and the chroma and hue terms can be much smaller
+ * than the euclidean distance at high chroma, so a k-d tree over L*, a* and
+ * b* cannot prune on it. The lightness term is the one that can be bounded:
+ * L' is L*, the chroma and hue terms together are never negative and S_L is
+ * largest furthest from L*=50, so every swatch is at least |ΔL*| / S_L(max)
+ * away. The swatches are therefore sorted by L* and searched outwards from
+ * the query, a batch at a time, until the next lightness difference alone is
+ * worse than the k-th best match found so far, which gives the same result
+ * as comparing against every swatch.
+ */
+
+#define GCM_NAMED_COLOR_SEARCH_BATCH		32
+
+typedef struct {
+	gdouble		 lab[3];
+	guint32		 idx;
+} GcmNamedColorSearchNode;
+
+struct _GcmNamedColorSearch {
+	GPtrArray		*colors;
+	GcmNamedColorSearchNode	*nodes;		/* ascending by L* */
+	guint			 nodes_len;
+};
+
+typedef struct {
+	gdouble		 dist;		/* CIEDE2000 */
+	guint32		 node;
+} GcmNamedColorSearchCandidate;
+
+typedef struct {
+	GcmNamedColorSearchCandidate	*cands;	/* ascending by dist */
+	guint				 cands_len;
+	guint				 cands_max;
+} GcmNamedColorSearchState;
+
+static gint
+gcm_named_color_search_node_sort_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const GcmNamedColorSearchNode *node1 = a;
+	const GcmNamedColorSearchNode *node2 = b;
+
+	if (node1->lab[0] < node2->lab[0])
+		return -1;
+	if (node1->lab[0] > node2->lab[0])
+		return 1;
+	return (gint) node1->idx - (gint) node2->idx;
+}
+
+/**
+ * gcm_named_color_search_new:
+ * @colors: an array of #CdColorSwatch, as from cd_icc_get_named_colors()
+ *
+ * Builds an index for finding the closest swatches to a Lab value.
+ **/
+GcmNamedColorSearch *
+gcm_named_color_search_new (GPtrArray *colors)
+{
+	GcmNamedColorSearch *search;
+
+	search = g_new0 (GcmNamedColorSearch, 1);
+	search->colors = g_ptr_array_ref (colors);
+	search->nodes = g_new (GcmNamedColorSearchNode, colors->len);
+	for (guint i = 0; i < colors->len; i++) {
+		CdColorSwatch *nc = g_ptr_array_index (colors, i);
+		const CdColorLab *lab = cd_color_swatch_get_value (nc);
+		GcmNamedColorSearchNode *node;
+
+		if (lab == NULL)
+			continue;
+		node = &search->nodes[search->nodes_len++];
+		node->lab[0] = lab->L;
+		node->lab[1] = lab->a;
+		node->lab[2] = lab->b;
+		node->idx = i;
+	}
+	g_qsort_with_data (search->nodes, search->nodes_len,
+			   sizeof (GcmNamedColorSearchNode),
+			   gcm_named_color_search_node_sort_cb, NULL);
+	return search;
+}
+
+void
+gcm_named_color_search_free (GcmNamedColorSearch *search)
+{
+	if (search == NULL)
+		return;
+	g_ptr_array_unref (search->colors);
+	g_free (search->nodes);
+	g_free (search);
+}
+
+static void
+gcm_named_color_search_add_candidate (GcmNamedColorSearchState *state, guint node, gdouble dist)
+{
+	guint i;
+
+	/* worse than everything we already have */
+	if (state->cands_len == state->cands_max &&
+	    dist >= state->cands[state->cands_len - 1].dist)
+		return;
+
+	/* insertion sort, dropping the worst when full */
+	if (state->cands_len < state->cands_max)
+		state->cands_len++;
+	for (i = state->cands_len - 1; i > 0 && state->cands[i - 1].dist > dist; i--)
+		state->cands[i] = state->cands[i - 1];
+	state->cands[i].dist = dist;
+	state->cands[i].node = node;
+}
+
+/* the largest S_L for any pair of swatches, or a swatch and the query */
+static gdouble
+gcm_named_color_search_get_sl_max (GcmNamedColorSearch *search, gdouble l)
+{
+	gdouble tmp = fabs (l - 50.f);
+	if (search->nodes_len > 0) {
+		tmp = MAX (tmp, fabs (search->nodes[0].lab[0] - 50.f));
+		tmp = MAX (tmp, fabs (search->nodes[search->nodes_len - 1].lab[0] - 50.f));
+	}
+	return 1.f + (0.015f * tmp * tmp) / sqrt (20.f + tmp * tmp);
+}
+
+static gint
+gcm_named_color_search_match_sort_cb (gconstpointer a, gconstpointer b)
+{
+	const GcmNamedColorMatch *match1 = a;
+	const GcmNamedColorMatch *match2 = b;
+	if (match1->delta_e < match2->delta_e)
+		return -1;
+	if (match1->delta_e > match2->delta_e)
+		return 1;
+	return (gint) match1->idx - (gint) match2->idx;
+}
+
+/**
+ * gcm_named_color_search_find:
+ * @search: a #GcmNamedColorSearch
+ * @lab: the color to match
+ * @k: the maximum number of results
+ *
+ * Finds the swatches closest to @lab.
+ *
+ * Returns: (transfer full): an array of #GcmNamedColorMatch, closest first
+ **/
+GArray *
+gcm_named_color_search_find (GcmNamedColorSearch *search, const CdColorLab *lab, guint k)
+{
+	GArray *results;
+	GcmNamedColorSearchState state = { 0 };
+	gdouble sl_max;
+	gfloat delta_e[GCM_NAMED_COLOR_SEARCH_BATCH];
+	gfloat lab_cands[GCM_NAMED_COLOR_SEARCH_BATCH * 3];
+	gfloat lab_query[GCM_NAMED_COLOR_SEARCH_BATCH * 3];
+	guint batch[GCM_NAMED_COLOR_SEARCH_BATCH];
+	guint hi = 0;
+	guint lo;
+	g_autofree GcmNamedColorSearchCandidate *cands = NULL;
+
+	g_return_val_if_fail (search != NULL, NULL);
+	g_return_val_if_fail (lab != NULL, NULL);
+
+	state.cands_max = MIN (k, search->nodes_len);
+	cands = g_new (GcmNamedColorSearchCandidate, MAX (state.cands_max, 1));
+	state.cands = cands;
+	sl_max = gcm_named_color_search_get_sl_max (search, lab->L);
+
+	/* the first swatch that is not darker than the query */
+	lo = search->nodes_len;
+	while (hi < lo) {
+		guint mid = hi + (lo - hi) / 2;
+		if (search->nodes[mid].lab[0] < lab->L)
+			hi = mid + 1;
+		else
+			lo = mid;
+	}
+	lo = hi;
+
+	/* walk outwards in L*, ranking a batch at a time by CIEDE2000 */
+	while (state.cands_max > 0 && (lo > 0 || hi < search->nodes_len)) {
+		gdouble dl;
+		guint n = 0;
+
+		while (n < GCM_NAMED_COLOR_SEARCH_BATCH &&
+		       (lo > 0 || hi < search->nodes_len)) {
+			if (hi >= search->nodes_len ||
+			    (lo > 0 && lab->L - search->nodes[lo - 1].lab[0] <
+				       search->nodes[hi].lab[0] - lab->L)) {
+				batch[n++] = --lo;
+			} else {
+				batch[n++] = hi++;
+			}
+		}
+		for (guint i = 0; i < n; i++) {
+			GcmNamedColorSearchNode *node = &search->nodes[batch[i]];
+			lab_query[n * 0 + i] = lab->L;
+			lab_query[n * 1 + i] = lab->a;
+			lab_query[n * 2 + i] = lab->b;
+			for (guint c = 0; c < 3; c++)
+				lab_cands[n * c + i] = node->lab[c];
+		}
+		gcm_color_math_delta_e2000_array (lab_query, lab_cands, delta_e, n);
+		for (guint i = 0; i < n; i++)
+			gcm_named_color_search_add_candidate (&state, batch[i], delta_e[i]);
+
+		/* nothing left can be closer than the worst we are keeping */
+		if (state.cands_len < state.cands_max)
+			continue;
+		dl = G_MAXDOUBLE;
+		if (lo > 0)
+			dl = lab->L - search->nodes[lo - 1].lab[0];
+		if (hi < search->nodes_len)
+			dl = MIN (dl, search->nodes[hi].lab[0] - lab->L);
+		if (dl / sl_max > state.cands[state.cands_len - 1].dist)
+			break;
+	}
+
+	results = g_array_sized_new (FALSE, FALSE, sizeof (GcmNamedColorMatch),
+				     state.cands_len);
+	for (guint i = 0; i < state.cands_len; i++) {
+		GcmNamedColorSearchNode *node = &search->nodes[cands[i].node];
+		GcmNamedColorMatch match;
+
+		match.idx = node->idx;
+		match.swatch = g_ptr_array_index (search->colors, node->idx);
+		match.delta_e = cands[i].dist;
+		g_array_append_val (results, match);
+	}
+	g_array_sort (results, gcm_named_color_search_match_sort_cb);
+	return results;
+}
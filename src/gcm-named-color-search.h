@@ -0,0 +1,27 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <colord.h>
+
+typedef struct _GcmNamedColorSearch	GcmNamedColorSearch;
+
+typedef struct {
+	const CdColorSwatch	*swatch;
+	guint32			 idx;		/* into the colors array */
+	gdouble			 delta_e;	/* CIEDE2000 */
+} GcmNamedColorMatch;
+
+GcmNamedColorSearch *gcm_named_color_search_new	(GPtrArray		*colors);
+void		 gcm_named_color_search_free		(GcmNamedColorSearch	*search);
+GArray		*gcm_named_color_search_find		(GcmNamedColorSearch	*search,
+							 const CdColorLab	*lab,
+							 guint			 k);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmNamedColorSearch, gcm_named_color_search_free)
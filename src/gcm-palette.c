@@ -0,0 +1,364 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <lcms2.h>
+
+#include "gcm-color-math.h"
+#include "gcm-lcms.h"
+#include "gcm-palette.h"
+
+/*
+ * The swatches are written in batches: each batch is converted to sRGB
+ * with a single transform call, and to XYZ in one go for CxF, then
+ * formatted into a reused buffer which is then written to the stream, so
+ * the memory used does not depend on the size of the library.
+ */
+
+#define GCM_PALETTE_BATCH_SIZE		256
+
+typedef struct {
+	GcmPaletteFormat	 format;
+	GOutputStream		*stream;
+	GCancellable		*cancellable;
+	GString			*buf;
+	cmsHTRANSFORM		 transform;
+} GcmPaletteHelper;
+
+GcmPaletteFormat
+gcm_palette_format_from_filename (const gchar *filename)
+{
+	g_autofree gchar *tmp = g_ascii_strdown (filename, -1);
+	if (g_str_has_suffix (tmp, ".gpl"))
+		return GCM_PALETTE_FORMAT_GPL;
+	if (g_str_has_suffix (tmp, ".ase"))
+		return GCM_PALETTE_FORMAT_ASE;
+	if (g_str_has_suffix (tmp, ".cxf"))
+		return GCM_PALETTE_FORMAT_CXF;
+	return GCM_PALETTE_FORMAT_UNKNOWN;
+}
+
+static gboolean
+gcm_palette_flush (GcmPaletteHelper *helper, GError **error)
+{
+	if (!g_output_stream_write_all (helper->stream,
+					helper->buf->str,
+					helper->buf->len,
+					NULL,
+					helper->cancellable,
+					error))
+		return FALSE;
+	g_string_truncate (helper->buf, 0);
+	return TRUE;
+}
+
+static void
+gcm_palette_append_uint16 (GString *buf, guint16 value)
+{
+	guint16 tmp = GUINT16_TO_BE (value);
+	g_string_append_len (buf, (const gchar *) &tmp, sizeof (tmp));
+}
+
+static void
+gcm_palette_append_uint32 (GString *buf, guint32 value)
+{
+	guint32 tmp = GUINT32_TO_BE (value);
+	g_string_append_len (buf, (const gchar *) &tmp, sizeof (tmp));
+}
+
+static void
+gcm_palette_append_float (GString *buf, gfloat value)
+{
+	guint32 tmp;
+	memcpy (&tmp, &value, sizeof (tmp));
+	gcm_palette_append_uint32 (buf, tmp);
+}
+
+static void
+gcm_palette_append_double (GString *buf, gdouble value)
+{
+	gchar str[G_ASCII_DTOSTR_BUF_SIZE];
+	g_string_append (buf, g_ascii_formatd (str, sizeof (str), "%.4f", value));
+}
+
+static void
+gcm_palette_write_header (GcmPaletteHelper *helper, const gchar *title, guint len)
+{
+	g_autofree gchar *title_safe = NULL;
+
+	switch (helper->format) {
+	case GCM_PALETTE_FORMAT_GPL:
+		g_string_append_printf (helper->buf,
+					"GIMP Palette\nName: %s\nColumns: 0\n#\n",
+					title);
+		break;
+	case GCM_PALETTE_FORMAT_ASE:
+		g_string_append (helper->buf, "ASEF");
+		gcm_palette_append_uint16 (helper->buf, 1);
+		gcm_palette_append_uint16 (helper->buf, 0);
+		gcm_palette_append_uint32 (helper->buf, len);
+		break;
+	case GCM_PALETTE_FORMAT_CXF:
+		title_safe = g_markup_escape_text (title, -1);
+		g_string_append_printf (helper->buf,
+					"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					"<cc:CxF xmlns:cc=\"http://colorexchangeformat.com/CxF3-core\">\n"
+					" <cc:FileInformation>\n"
+					"  <cc:Description>%s</cc:Description>\n"
+					" </cc:FileInformation>\n"
+					" <cc:Resources>\n"
+					"  <cc:ObjectCollection>\n",
+					title_safe);
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+}
+
+static void
+gcm_palette_write_footer (GcmPaletteHelper *helper)
+{
+	if (helper->format != GCM_PALETTE_FORMAT_CXF)
+		return;
+	g_string_append (helper->buf,
+			 "  </cc:ObjectCollection>\n"
+			 "  <cc:ColorSpecificationCollection>\n"
+			 "   <cc:ColorSpecification Id=\"CIE-D50\">\n"
+			 "    <cc:TristimulusSpec>\n"
+			 "     <cc:Illuminant>D50</cc:Illuminant>\n"
+			 "     <cc:Observer>2_Degree</cc:Observer>\n"
+			 "     <cc:Method>COLORIMETRIC</cc:Method>\n"
+			 "    </cc:TristimulusSpec>\n"
+			 "   </cc:ColorSpecification>\n"
+			 "   <cc:ColorSpecification Id=\"sRGB\">\n"
+			 "    <cc:TristimulusSpec>\n"
+			 "     <cc:Illuminant>D65</cc:Illuminant>\n"
+			 "     <cc:Observer>2_Degree</cc:Observer>\n"
+			 "     <cc:Method>COLORIMETRIC</cc:Method>\n"
+			 "    </cc:TristimulusSpec>\n"
+			 "   </cc:ColorSpecification>\n"
+			 "  </cc:ColorSpecificationCollection>\n"
+			 " </cc:Resources>\n"
+			 "</cc:CxF>\n");
+}
+
+/* @xyz is planar, with @stride between the channels */
+static void
+gcm_palette_write_swatch (GcmPaletteHelper *helper,
+			  guint idx,
+			  const gchar *name,
+			  const CdColorLab *lab,
+			  const gfloat *xyz,
+			  guint stride,
+			  const CdColorRGB8 *rgb)
+{
+	glong name_len = 0;
+	g_autofree gchar *name_safe = NULL;
+	g_autofree gunichar2 *name_utf16 = NULL;
+
+	switch (helper->format) {
+	case GCM_PALETTE_FORMAT_GPL:
+		g_string_append_printf (helper->buf, "%3u %3u %3u\t%s\n",
+					rgb->R, rgb->G, rgb->B, name);
+		break;
+	case GCM_PALETTE_FORMAT_ASE:
+		/* the name is NUL terminated UTF-16BE */
+		name_utf16 = g_utf8_to_utf16 (name, -1, NULL, &name_len, NULL);
+		if (name_utf16 == NULL)
+			name_len = 0;
+		gcm_palette_append_uint16 (helper->buf, 0x0001);
+		gcm_palette_append_uint32 (helper->buf,
+					   2 + (name_len + 1) * 2 + 4 + 3 * 4 + 2);
+		gcm_palette_append_uint16 (helper->buf, name_len + 1);
+		for (glong i = 0; i < name_len; i++)
+			gcm_palette_append_uint16 (helper->buf, name_utf16[i]);
+		gcm_palette_append_uint16 (helper->buf, 0);
+		g_string_append (helper->buf, "LAB ");
+		gcm_palette_append_float (helper->buf, lab->L / 100.f);
+		gcm_palette_append_float (helper->buf, lab->a);
+		gcm_palette_append_float (helper->buf, lab->b);
+		gcm_palette_append_uint16 (helper->buf, 2); /* normal */
+		break;
+	case GCM_PALETTE_FORMAT_CXF:
+		name_safe = g_markup_escape_text (name, -1);
+		g_string_append_printf (helper->buf,
+					"   <cc:Object ObjectType=\"Standard\" Name=\"%s\" Id=\"c%u\">\n"
+					"    <cc:ColorValues>\n"
+					"     <cc:ColorCIELab ColorSpecification=\"CIE-D50\">\n"
+					"      <cc:L>", name_safe, idx);
+		gcm_palette_append_double (helper->buf, lab->L);
+		g_string_append (helper->buf, "</cc:L>\n      <cc:A>");
+		gcm_palette_append_double (helper->buf, lab->a);
+		g_string_append (helper->buf, "</cc:A>\n      <cc:B>");
+		gcm_palette_append_double (helper->buf, lab->b);
+		g_string_append (helper->buf,
+				 "</cc:B>\n"
+				 "     </cc:ColorCIELab>\n"
+				 "     <cc:ColorCIEXYZ ColorSpecification=\"CIE-D50\">\n"
+				 "      <cc:X>");
+		gcm_palette_append_double (helper->buf, xyz[0] * 100.f);
+		g_string_append (helper->buf, "</cc:X>\n      <cc:Y>");
+		gcm_palette_append_double (helper->buf, xyz[stride] * 100.f);
+		g_string_append (helper->buf, "</cc:Y>\n      <cc:Z>");
+		gcm_palette_append_double (helper->buf, xyz[stride * 2] * 100.f);
+		g_string_append_printf (helper->buf,
+					"</cc:Z>\n"
+					"     </cc:ColorCIEXYZ>\n"
+					"     <cc:ColorSRGB ColorSpecification=\"sRGB\" MaxValue=\"255\">\n"
+					"      <cc:R>%u</cc:R>\n"
+					"      <cc:G>%u</cc:G>\n"
+					"      <cc:B>%u</cc:B>\n"
+					"     </cc:ColorSRGB>\n"
+					"    </cc:ColorValues>\n"
+					"   </cc:Object>\n",
+					rgb->R, rgb->G, rgb->B);
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+}
+
+/**
+ * gcm_palette_export:
+ * @colors: an array of #CdColorSwatch, as from cd_icc_get_named_colors()
+ * @title: the palette title
+ * @format: a #GcmPaletteFormat
+ * @stream: a #GOutputStream
+ *
+ * Writes the swatches to @stream in the chosen palette format.
+ **/
+gboolean
+gcm_palette_export (GPtrArray *colors,
+		    const gchar *title,
+		    GcmPaletteFormat format,
+		    GOutputStream *stream,
+		    GCancellable *cancellable,
+		    GError **error)
+{
+	gboolean ret = FALSE;
+	guint idx = 0;
+	guint len = 0;
+	CdColorLab lab[GCM_PALETTE_BATCH_SIZE];
+	CdColorRGB8 rgb[GCM_PALETTE_BATCH_SIZE];
+	gfloat lab_planar[GCM_PALETTE_BATCH_SIZE * 3];
+	gfloat xyz[GCM_PALETTE_BATCH_SIZE * 3];
+	const gchar *names[GCM_PALETTE_BATCH_SIZE];
+	GcmPaletteHelper helper = { 0 };
+
+	g_return_val_if_fail (colors != NULL, FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+
+	if (format <= GCM_PALETTE_FORMAT_UNKNOWN || format >= GCM_PALETTE_FORMAT_LAST) {
+		g_set_error_literal (error, 1, 0, "palette format not supported");
+		return FALSE;
+	}
+
+	/* same conversion as the swatches in the viewer */
+	helper.transform = gcm_lcms_get_transform (GCM_LCMS_PROFILE_LAB2, TYPE_Lab_DBL,
+						    GCM_LCMS_PROFILE_SRGB, TYPE_RGB_8,
+						    INTENT_ABSOLUTE_COLORIMETRIC,
+						    error);
+	if (helper.transform == NULL)
+		return FALSE;
+	helper.format = format;
+	helper.stream = stream;
+	helper.cancellable = cancellable;
+	helper.buf = g_string_sized_new (64 * 1024);
+
+	/* swatches without a value cannot be written */
+	for (guint i = 0; i < colors->len; i++) {
+		CdColorSwatch *nc = g_ptr_array_index (colors, i);
+		if (cd_color_swatch_get_value (nc) != NULL)
+			len++;
+	}
+
+	gcm_palette_write_header (&helper, title != NULL ? title : "", len);
+	for (guint i = 0; i < colors->len;) {
+		guint batch = 0;
+
+		for (; i < colors->len && batch < GCM_PALETTE_BATCH_SIZE; i++) {
+			CdColorSwatch *nc = g_ptr_array_index (colors, i);
+			const CdColorLab *value = cd_color_swatch_get_value (nc);
+			if (value == NULL)
+				continue;
+			cd_color_lab_copy (value, &lab[batch]);
+			names[batch++] = cd_color_swatch_get_name (nc);
+		}
+		if (batch == 0)
+			break;
+		cmsDoTransform (helper.transform, lab, rgb, batch);
+		if (format == GCM_PALETTE_FORMAT_CXF) {
+			for (guint j = 0; j < batch; j++) {
+				lab_planar[j] = lab[j].L;
+				lab_planar[batch + j] = lab[j].a;
+				lab_planar[batch * 2 + j] = lab[j].b;
+			}
+			gcm_color_math_lab_to_xyz_array (lab_planar, NULL, xyz, batch);
+		}
+		for (guint j = 0; j < batch; j++) {
+			gcm_palette_write_swatch (&helper, idx++,
+						  names[j] != NULL ? names[j] : "",
+						  &lab[j], xyz + j, batch, &rgb[j]);
+		}
+		if (!gcm_palette_flush (&helper, error))
+			goto out;
+	}
+	gcm_palette_write_footer (&helper);
+	if (!gcm_palette_flush (&helper, error))
+		goto out;
+
+	/* success */
+	ret = TRUE;
+out:
+	g_string_free (helper.buf, TRUE);
+	return ret;
+}
+
+/**
+ * gcm_palette_export_file:
+ *
+ * Writes the swatches to @file, using the format from the file extension.
+ **/
+gboolean
+gcm_palette_export_file (GPtrArray *colors,
+			 const gchar *title,
+			 GFile *file,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	GcmPaletteFormat format;
+	g_autofree gchar *basename = NULL;
+	g_autoptr(GFileOutputStream) stream = NULL;
+
+	basename = g_file_get_basename (file);
+	format = gcm_palette_format_from_filename (basename);
+	if (format == GCM_PALETTE_FORMAT_UNKNOWN) {
+		g_set_error (error, 1, 0,
+			     "palette format not known for %s, expected .gpl, .ase or .cxf",
+			     basename);
+		return FALSE;
+	}
+	stream = g_file_replace (file, NULL, FALSE,
+				 G_FILE_CREATE_REPLACE_DESTINATION,
+				 cancellable, error);
+	if (stream == NULL)
+		return FALSE;
+	if (!gcm_palette_export (colors, title, format,
+				 G_OUTPUT_STREAM (stream),
+				 cancellable, error)) {
+		g_autoptr(GCancellable) cancellable_close = g_cancellable_new ();
+
+		/* closing when cancelled discards the partial file rather
+		 * than replacing the destination with it */
+		g_cancellable_cancel (cancellable_close);
+		g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable_close, NULL);
+		return FALSE;
+	}
+	return g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable, error);
+}
@@ -0,0 +1,32 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <colord.h>
+
+typedef enum {
+	GCM_PALETTE_FORMAT_UNKNOWN,
+	GCM_PALETTE_FORMAT_GPL,
+	GCM_PALETTE_FORMAT_ASE,
+	GCM_PALETTE_FORMAT_CXF,
+	GCM_PALETTE_FORMAT_LAST
+} GcmPaletteFormat;
+
+GcmPaletteFormat gcm_palette_format_from_filename	(const gchar		*filename);
+gboolean	 gcm_palette_export			(GPtrArray		*colors,
+							 const gchar		*title,
+							 GcmPaletteFormat	 format,
+							 GOutputStream		*stream,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_palette_export_file		(GPtrArray		*colors,
+							 const gchar		*title,
+							 GFile			*file,
+							 GCancellable		*cancellable,
+							 GError			**error);
@@ -18,6 +18,9 @@
 #include <lcms2.h>
 #include <colord.h>
 
+#include "gcm-color-math.h"
+#include "gcm-lcms.h"
+#include "gcm-named-color-search.h"
 #include "gcm-utils.h"
 #include "gcm-debug.h"
 
@@ -33,6 +36,8 @@ typedef struct {
 	GtkWidget	*info_bar_hardware;
 	guint		 xid;
 	guint		 unlock_timer;
+	GHashTable	*named_color_searches;	/* profile ID -> GcmNamedColorSearch */
+	GcmNamedColorSearch *named_color_search;	/* not owned */
 } GcmPickerPrivate;
 
 enum {
@@ -41,6 +46,8 @@ enum {
 	GCM_PREFS_COMBO_COLUMN_LAST
 };
 
+#define GCM_PICKER_NAMED_COLORS_MAX		3
+
 static void
 gcm_picker_set_pixbuf_color (GdkPixbuf *pixbuf, gchar red, gchar green, gchar blue)
 {
@@ -65,25 +72,51 @@ gcm_picker_set_pixbuf_color (GdkPixbuf *pixbuf, gchar red, gchar green, gchar bl
 	}
 }
 
+static void
+gcm_picker_refresh_named_colors (GcmPickerPrivate *priv, const CdColorLab *color_lab)
+{
+	GtkLabel *label;
+	g_autoptr(GArray) matches = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	label = GTK_LABEL (gtk_builder_get_object (priv->builder, "label_named_colors"));
+	if (priv->named_color_search == NULL) {
+		/* TRANSLATORS: this is when there is no named color match */
+		gtk_label_set_label (label, _("Unknown"));
+		return;
+	}
+	matches = gcm_named_color_search_find (priv->named_color_search,
+					       color_lab,
+					       GCM_PICKER_NAMED_COLORS_MAX);
+	for (guint i = 0; i < matches->len; i++) {
+		GcmNamedColorMatch *match = &g_array_index (matches, GcmNamedColorMatch, i);
+		if (str->len > 0)
+			g_string_append (str, "\n");
+		/* TRANSLATORS: the name of a named color and the CIEDE2000
+		 * color difference to the measured color */
+		g_string_append_printf (str, _("%s (ΔE %.2f)"),
+					cd_color_swatch_get_name (match->swatch),
+					match->delta_e);
+	}
+	gtk_label_set_label (label, str->str);
+}
+
 static void
 gcm_picker_refresh_results (GcmPickerPrivate *priv)
 {
-	cmsCIExyY xyY;
-	cmsHPROFILE profile_lab;
-	cmsHPROFILE profile_rgb;
-	cmsHPROFILE profile_xyz;
 	cmsHTRANSFORM transform_error;
-	cmsHTRANSFORM transform_lab;
 	cmsHTRANSFORM transform_rgb;
 	gboolean ret;
 	CdColorLab color_lab;
 	CdColorRGB8 color_rgb;
 	CdColorXYZ color_error;
 	CdColorXYZ color_xyz;
+	CdColorYxy color_yxy;
 	gdouble temperature = 0.0f;
 	GtkImage *image;
 	GtkLabel *label;
 	g_autoptr(GdkPixbuf) pixbuf = NULL;
+	g_autoptr(GError) error = NULL;
 	g_autofree gchar *text_ambient = NULL;
 	g_autofree gchar *text_error = NULL;
 	g_autofree gchar *text_lab = NULL;
@@ -110,39 +143,25 @@ gcm_picker_refresh_results (GcmPickerPrivate *priv)
 	color_xyz.Y /= 100.0f;
 	color_xyz.Z /= 100.0f;
 
-	/* get profiles */
-	profile_xyz = cmsCreateXYZProfile ();
-	profile_rgb = cmsOpenProfileFromFile (priv->profile_filename, "r");
-	profile_lab = cmsCreateLab4Profile (cmsD50_xyY ());
-
-	/* create transforms */
-	transform_rgb = cmsCreateTransform (profile_xyz, TYPE_XYZ_DBL,
-					    profile_rgb, TYPE_RGB_8,
-					    INTENT_PERCEPTUAL, 0);
-	if (transform_rgb == NULL)
-		return;
-	transform_lab = cmsCreateTransform (profile_xyz, TYPE_XYZ_DBL,
-					    profile_lab, TYPE_Lab_DBL,
-					    INTENT_PERCEPTUAL, 0);
-	if (transform_lab == NULL)
+	/* get transforms, only created for the first sample */
+	transform_rgb = gcm_lcms_get_transform (GCM_LCMS_PROFILE_XYZ, TYPE_XYZ_DBL,
+						priv->profile_filename, TYPE_RGB_8,
+						INTENT_PERCEPTUAL, &error);
+	if (transform_rgb == NULL) {
+		g_warning ("%s", error->message);
 		return;
-	transform_error = cmsCreateTransform (profile_rgb, TYPE_RGB_8,
-					      profile_xyz, TYPE_XYZ_DBL,
-					      INTENT_PERCEPTUAL, 0);
-	if (transform_error == NULL)
+	}
+	transform_error = gcm_lcms_get_transform (priv->profile_filename, TYPE_RGB_8,
+						  GCM_LCMS_PROFILE_XYZ, TYPE_XYZ_DBL,
+						  INTENT_PERCEPTUAL, &error);
+	if (transform_error == NULL) {
+		g_warning ("%s", error->message);
 		return;
+	}
 
 	cmsDoTransform (transform_rgb, &color_xyz, &color_rgb, 1);
-	cmsDoTransform (transform_lab, &color_xyz, &color_lab, 1);
 	cmsDoTransform (transform_error, &color_rgb, &color_error, 1);
-
-	/* destroy lcms state */
-	cmsDeleteTransform (transform_rgb);
-	cmsDeleteTransform (transform_lab);
-	cmsDeleteTransform (transform_error);
-	cmsCloseProfile (profile_xyz);
-	cmsCloseProfile (profile_rgb);
-	cmsCloseProfile (profile_lab);
+	gcm_color_math_xyz_to_lab (&color_xyz, NULL, &color_lab);
 
 	/* set XYZ */
 	label = GTK_LABEL (gtk_builder_get_object (priv->builder, "label_xyz"));
@@ -160,15 +179,18 @@ gcm_picker_refresh_results (GcmPickerPrivate *priv)
 				    color_lab.b);
 	gtk_label_set_label (label, text_lab);
 
+	/* set closest named colors */
+	gcm_picker_refresh_named_colors (priv, &color_lab);
+
 	/* set whitepoint */
-	cmsXYZ2xyY (&xyY, (cmsCIEXYZ *)&priv->last_sample);
+	cd_color_xyz_to_yxy (&priv->last_sample, &color_yxy);
 	label = GTK_LABEL (gtk_builder_get_object (priv->builder, "label_whitepoint"));
 	text_whitepoint = g_strdup_printf ("%.3f,%.3f [%.3f]",
-					   xyY.x, xyY.y, xyY.Y);
+					   color_yxy.x, color_yxy.y, color_yxy.Y);
 	gtk_label_set_label (label, text_whitepoint);
 
 	/* set temperature */
-	ret = cmsTempFromWhitePoint (&temperature, &xyY);
+	ret = gcm_color_math_get_cct (&color_yxy, &temperature);
 	if (ret) {
 		/* round to nearest 10K */
 		temperature = (((guint) temperature) / 10) * 10;
@@ -382,17 +404,42 @@ gcm_window_set_parent_xid (GtkWindow *window, guint32 _xid)
 }
 
 static void
-gcm_picker_error_cb (cmsContext ContextID, cmsUInt32Number errorcode, const char *text)
+gcm_prefs_space_combo_changed_cb (GtkWidget *widget, GcmPickerPrivate *priv)
 {
-	g_warning ("LCMS error %u: %s", errorcode, text);
+	GtkTreeIter iter;
+	GtkTreeModel *model;
+	g_autoptr(CdProfile) profile = NULL;
+
+	/* no selection */
+	if (!gtk_combo_box_get_active_iter (GTK_COMBO_BOX(widget), &iter))
+		return;
+
+	/* get profile */
+	model = gtk_combo_box_get_model (GTK_COMBO_BOX(widget));
+	gtk_tree_model_get (model, &iter,
+			    GCM_PREFS_COMBO_COLUMN_PROFILE, &profile,
+			    -1);
+	if (profile == NULL)
+		return;
+
+	priv->profile_filename = cd_profile_get_filename (profile);
+	g_debug ("changed picker space %s", priv->profile_filename);
+
+	gcm_picker_refresh_results (priv);
 }
 
 static void
-gcm_prefs_space_combo_changed_cb (GtkWidget *widget, GcmPickerPrivate *priv)
+gcm_picker_named_colors_combo_changed_cb (GtkWidget *widget, GcmPickerPrivate *priv)
 {
+	GcmNamedColorSearch *search;
 	GtkTreeIter iter;
 	GtkTreeModel *model;
+	const gchar *profile_id;
+	g_autoptr(CdIcc) icc = NULL;
 	g_autoptr(CdProfile) profile = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GPtrArray) colors = NULL;
 
 	/* no selection */
 	if (!gtk_combo_box_get_active_iter (GTK_COMBO_BOX(widget), &iter))
@@ -406,8 +453,25 @@ gcm_prefs_space_combo_changed_cb (GtkWidget *widget, GcmPickerPrivate *priv)
 	if (profile == NULL)
 		return;
 
-	priv->profile_filename = cd_profile_get_filename (profile);
-	g_debug ("changed picker space %s", priv->profile_filename);
+	/* the search index is only built once for each profile */
+	profile_id = cd_profile_get_id (profile);
+	search = g_hash_table_lookup (priv->named_color_searches, profile_id);
+	if (search == NULL) {
+		icc = cd_icc_new ();
+		file = g_file_new_for_path (cd_profile_get_filename (profile));
+		if (!cd_icc_load_file (icc, file,
+				       CD_ICC_LOAD_FLAGS_NAMED_COLORS,
+				       NULL, &error)) {
+			g_warning ("failed to load named colors: %s", error->message);
+			return;
+		}
+		colors = cd_icc_get_named_colors (icc);
+		search = gcm_named_color_search_new (colors);
+		g_hash_table_insert (priv->named_color_searches,
+				     g_strdup (profile_id), search);
+	}
+	priv->named_color_search = search;
+	g_debug ("changed named color profile %s", profile_id);
 
 	gcm_picker_refresh_results (priv);
 }
@@ -572,6 +636,57 @@ gcm_prefs_setup_space_combobox (GcmPickerPrivate *priv, GtkWidget *widget)
 	}
 }
 
+static void
+gcm_picker_setup_named_colors_combobox (GcmPickerPrivate *priv, GtkWidget *widget)
+{
+	CdProfile *profile;
+	gboolean has_profile = FALSE;
+	GtkTreeIter iter;
+	GtkTreeModel *model;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) profile_array = NULL;
+
+	/* get new list */
+	profile_array = cd_client_get_profiles_sync (priv->client,
+						     NULL,
+						     &error);
+	if (profile_array == NULL) {
+		g_warning ("failed to get profiles: %s",
+			   error->message);
+		return;
+	}
+
+	/* add each named color profile */
+	for (guint i = 0; i < profile_array->len; i++) {
+		g_autoptr(GError) error_local = NULL;
+		profile = g_ptr_array_index (profile_array, i);
+		if (!cd_profile_connect_sync (profile, NULL, &error_local)) {
+			g_warning ("failed to connect to profile: %s",
+				   error_local->message);
+			continue;
+		}
+		if (!cd_profile_has_access (profile))
+			continue;
+		if (cd_profile_get_filename (profile) == NULL)
+			continue;
+		if (cd_profile_get_kind (profile) != CD_PROFILE_KIND_NAMED_COLOR)
+			continue;
+		gcm_prefs_combobox_add_profile (widget, profile, NULL);
+		has_profile = TRUE;
+	}
+
+	if (!has_profile) {
+		model = gtk_combo_box_get_model (GTK_COMBO_BOX (widget));
+		gtk_list_store_append (GTK_LIST_STORE(model), &iter);
+		gtk_list_store_set (GTK_LIST_STORE(model), &iter,
+				    /* TRANSLATORS: this is when there are no named color profiles */
+				    GCM_PREFS_COMBO_COLUMN_TEXT, _("No named color profiles available"),
+				    -1);
+		gtk_combo_box_set_active (GTK_COMBO_BOX (widget), 0);
+		gtk_widget_set_sensitive (widget, FALSE);
+	}
+}
+
 static void
 gcm_picker_activate_cb (GApplication *application, GcmPickerPrivate *priv)
 {
@@ -658,6 +773,13 @@ gcm_picker_startup_cb (GApplication *application, GcmPickerPrivate *priv)
 	g_signal_connect (G_OBJECT (widget), "changed",
 			  G_CALLBACK (gcm_prefs_space_combo_changed_cb), priv);
 
+	/* setup named color combobox */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "combobox_named_colors"));
+	gcm_prefs_set_combo_simple_text (widget);
+	gcm_picker_setup_named_colors_combobox (priv, widget);
+	g_signal_connect (G_OBJECT (widget), "changed",
+			  G_CALLBACK (gcm_picker_named_colors_combo_changed_cb), priv);
+
 	/* setup initial preview window */
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "image_preview"));
 	gtk_image_set_from_file (GTK_IMAGE (widget), DATADIR "/icons/hicolor/64x64/apps/gnome-color-manager.png");
@@ -688,9 +810,6 @@ main (int argc, char *argv[])
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
 	textdomain (GETTEXT_PACKAGE);
 
-	/* setup LCMS */
-	cmsSetLogErrorHandler (gcm_picker_error_cb);
-
 	context = g_option_context_new (NULL);
 	/* TRANSLATORS: tool that is used to pick colors */
 	g_option_context_set_summary (context, _("GNOME Color Manager Color Picker"));
@@ -704,6 +823,8 @@ main (int argc, char *argv[])
 	priv = g_new0 (GcmPickerPrivate, 1);
 	priv->last_ambient = -1.0f;
 	priv->xid = xid;
+	priv->named_color_searches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							     (GDestroyNotify) gcm_named_color_search_free);
 
 	/* ensure single instance */
 	application = gtk_application_new ("org.gnome.ColorManager.Picker", 0);
@@ -719,6 +840,7 @@ main (int argc, char *argv[])
 		g_object_unref (priv->client);
 	if (priv->builder != NULL)
 		g_object_unref (priv->builder);
+	g_hash_table_unref (priv->named_color_searches);
 	g_free (priv);
 	return status;
 }
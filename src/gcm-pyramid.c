@@ -0,0 +1,395 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include "gcm-pyramid.h"
+
+/*
+ * A pyramid keeps an image at every power of two smaller, so a view at any
+ * zoom reads about as many pixels as it shows. Pixels are only converted a
+ * tile at a time when the tile is first shown, and converted tiles are kept
+ * until the transform changes or they are the least recently shown.
+ */
+
+#define GCM_PYRAMID_TILES_MAX		256	/* about 64MB of RGBA */
+
+typedef struct {
+	GdkPixbuf	*pixbuf;
+	guint64		 used;		/* when last shown */
+} GcmPyramidTile;
+
+struct _GcmPyramid {
+	GPtrArray		*levels;	/* of GdkPixbuf, 0 is the source */
+	GMutex			 mutex;
+	GHashTable		*tiles;		/* of guint64 key to GcmPyramidTile */
+	GcmUtilsTransform	*transform;	/* used for all the tiles */
+	guint64			 clock;
+	gint			 refcount;	/* atomic */
+};
+
+static void
+gcm_pyramid_tile_free (GcmPyramidTile *tile)
+{
+	g_object_unref (tile->pixbuf);
+	g_free (tile);
+}
+
+static gint64 *
+gcm_pyramid_tile_key (guint level, guint tile_x, guint tile_y)
+{
+	gint64 *key = g_new (gint64, 1);
+	*key = ((gint64) level << 48) | ((gint64) tile_y << 24) | (gint64) tile_x;
+	return key;
+}
+
+/**
+ * gcm_pyramid_new:
+ * @source: a decoded #GdkPixbuf, which is not modified
+ *
+ * Creates a pyramid by box filtering @source in halves until it fits in
+ * one tile.
+ *
+ * Returns: a #GcmPyramid, free with gcm_pyramid_unref()
+ **/
+GcmPyramid *
+gcm_pyramid_new (GdkPixbuf *source)
+{
+	GcmPyramid *pyramid = g_new0 (GcmPyramid, 1);
+	GdkPixbuf *level = source;
+
+	pyramid->refcount = 1;
+	g_mutex_init (&pyramid->mutex);
+	pyramid->tiles = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free,
+						(GDestroyNotify) gcm_pyramid_tile_free);
+	pyramid->levels = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_ptr_array_add (pyramid->levels, g_object_ref (source));
+	while (gdk_pixbuf_get_width (level) > GCM_PYRAMID_TILE_SIZE ||
+	       gdk_pixbuf_get_height (level) > GCM_PYRAMID_TILE_SIZE) {
+		level = gdk_pixbuf_scale_simple (level,
+						 MAX (gdk_pixbuf_get_width (level) / 2, 1),
+						 MAX (gdk_pixbuf_get_height (level) / 2, 1),
+						 GDK_INTERP_TILES);
+		g_ptr_array_add (pyramid->levels, level);
+	}
+	return pyramid;
+}
+
+GcmPyramid *
+gcm_pyramid_ref (GcmPyramid *pyramid)
+{
+	g_atomic_int_inc (&pyramid->refcount);
+	return pyramid;
+}
+
+void
+gcm_pyramid_unref (GcmPyramid *pyramid)
+{
+	if (!g_atomic_int_dec_and_test (&pyramid->refcount))
+		return;
+	g_hash_table_unref (pyramid->tiles);
+	g_ptr_array_unref (pyramid->levels);
+	if (pyramid->transform != NULL)
+		gcm_utils_transform_unref (pyramid->transform);
+	g_mutex_clear (&pyramid->mutex);
+	g_free (pyramid);
+}
+
+guint
+gcm_pyramid_get_n_levels (GcmPyramid *pyramid)
+{
+	return pyramid->levels->len;
+}
+
+/**
+ * gcm_pyramid_get_level:
+ * @pyramid: a #GcmPyramid
+ * @level: the level, where 0 is the source
+ *
+ * Gets the unconverted pixels of a level.
+ *
+ * Returns: (transfer none): a #GdkPixbuf that must not be modified
+ **/
+GdkPixbuf *
+gcm_pyramid_get_level (GcmPyramid *pyramid, guint level)
+{
+	g_return_val_if_fail (level < pyramid->levels->len, NULL);
+	return g_ptr_array_index (pyramid->levels, level);
+}
+
+/**
+ * gcm_pyramid_get_level_for_scale:
+ * @pyramid: a #GcmPyramid
+ * @scale: displayed pixels for each source pixel
+ *
+ * Gets the smallest level that still has a pixel for each one displayed.
+ **/
+guint
+gcm_pyramid_get_level_for_scale (GcmPyramid *pyramid, gdouble scale)
+{
+	GdkPixbuf *source = g_ptr_array_index (pyramid->levels, 0);
+	gdouble width = gdk_pixbuf_get_width (source) * scale;
+	guint level = 0;
+
+	while (level + 1 < pyramid->levels->len &&
+	       gdk_pixbuf_get_width (g_ptr_array_index (pyramid->levels, level + 1)) >= width)
+		level++;
+	return level;
+}
+
+/**
+ * gcm_pyramid_get_level_for_width:
+ * @pyramid: a #GcmPyramid
+ * @width: the largest width that will be displayed
+ *
+ * Gets the smallest level at least @width wide, or the source if it is
+ * narrower.
+ **/
+guint
+gcm_pyramid_get_level_for_width (GcmPyramid *pyramid, gint width)
+{
+	GdkPixbuf *source = g_ptr_array_index (pyramid->levels, 0);
+	return gcm_pyramid_get_level_for_scale (pyramid,
+						(gdouble) width / gdk_pixbuf_get_width (source));
+}
+
+/**
+ * gcm_pyramid_set_transform:
+ * @pyramid: a #GcmPyramid
+ * @transform: (nullable): a transform from the pixel format of @pyramid
+ *	to 8 bit RGB with the same alpha
+ *
+ * Sets the transform for the tiles, dropping any converted with another.
+ **/
+void
+gcm_pyramid_set_transform (GcmPyramid *pyramid, GcmUtilsTransform *transform)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&pyramid->mutex);
+
+	if (pyramid->transform == transform)
+		return;
+	if (pyramid->transform != NULL)
+		gcm_utils_transform_unref (pyramid->transform);
+	pyramid->transform = transform != NULL ? gcm_utils_transform_ref (transform) : NULL;
+	g_hash_table_remove_all (pyramid->tiles);
+}
+
+/**
+ * gcm_pyramid_get_tile:
+ * @pyramid: a #GcmPyramid
+ * @level: the level
+ * @tile_x: the column, in units of %GCM_PYRAMID_TILE_SIZE
+ * @tile_y: the row, in units of %GCM_PYRAMID_TILE_SIZE
+ *
+ * Gets a converted tile, which is smaller at the right and bottom edges.
+ *
+ * Returns: (transfer full) (nullable): a #GdkPixbuf, or %NULL if the tile
+ *	has not been converted
+ **/
+GdkPixbuf *
+gcm_pyramid_get_tile (GcmPyramid *pyramid, guint level, guint tile_x, guint tile_y)
+{
+	GcmPyramidTile *tile;
+	g_autofree gint64 *key = gcm_pyramid_tile_key (level, tile_x, tile_y);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&pyramid->mutex);
+
+	tile = g_hash_table_lookup (pyramid->tiles, key);
+	if (tile == NULL)
+		return NULL;
+	tile->used = ++pyramid->clock;
+	return g_object_ref (tile->pixbuf);
+}
+
+/* called with the mutex held */
+static void
+gcm_pyramid_evict_tiles (GcmPyramid *pyramid)
+{
+	while (g_hash_table_size (pyramid->tiles) > GCM_PYRAMID_TILES_MAX) {
+		GHashTableIter iter;
+		GcmPyramidTile *tile;
+		gpointer key;
+		gpointer key_oldest = NULL;
+		guint64 used_oldest = G_MAXUINT64;
+
+		g_hash_table_iter_init (&iter, pyramid->tiles);
+		while (g_hash_table_iter_next (&iter, &key, (gpointer *) &tile)) {
+			if (tile->used >= used_oldest)
+				continue;
+			used_oldest = tile->used;
+			key_oldest = key;
+		}
+		g_hash_table_remove (pyramid->tiles, key_oldest);
+	}
+}
+
+/**
+ * gcm_pyramid_convert:
+ * @pyramid: a #GcmPyramid
+ * @level: the level
+ * @area: the visible part of @level, in its pixels
+ * @cancellable: (nullable): a #GCancellable
+ *
+ * Converts the tiles of @level that overlap @area and have not been
+ * converted yet, in parallel on all the CPU cores. No other tiles are read.
+ **/
+gboolean
+gcm_pyramid_convert (GcmPyramid *pyramid,
+		     guint level,
+		     const GdkRectangle *area,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	GdkPixbuf *pixbuf;
+	GdkRectangle rect;
+	guint tile_x_end;
+	guint tile_y_end;
+	guint bpp;
+	g_autoptr(GArray) regions = g_array_new (FALSE, FALSE, sizeof (GcmUtilsRegion));
+	g_autoptr(GPtrArray) dests = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GArray) keys = g_array_new (FALSE, FALSE, sizeof (gint64));
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+
+	g_return_val_if_fail (level < pyramid->levels->len, FALSE);
+
+	/* only what is inside the level */
+	pixbuf = g_ptr_array_index (pyramid->levels, level);
+	rect.x = 0;
+	rect.y = 0;
+	rect.width = gdk_pixbuf_get_width (pixbuf);
+	rect.height = gdk_pixbuf_get_height (pixbuf);
+	if (!gdk_rectangle_intersect (area, &rect, &rect))
+		return TRUE;
+	bpp = (guint) gdk_pixbuf_get_n_channels (pixbuf);
+	tile_x_end = (guint) (rect.x + rect.width + GCM_PYRAMID_TILE_SIZE - 1) / GCM_PYRAMID_TILE_SIZE;
+	tile_y_end = (guint) (rect.y + rect.height + GCM_PYRAMID_TILE_SIZE - 1) / GCM_PYRAMID_TILE_SIZE;
+
+	/* find the tiles still to do */
+	g_mutex_lock (&pyramid->mutex);
+	if (pyramid->transform != NULL)
+		transform = gcm_utils_transform_ref (pyramid->transform);
+	for (guint ty = (guint) rect.y / GCM_PYRAMID_TILE_SIZE; ty < tile_y_end; ty++) {
+		for (guint tx = (guint) rect.x / GCM_PYRAMID_TILE_SIZE; tx < tile_x_end; tx++) {
+			g_autofree gint64 *key = gcm_pyramid_tile_key (level, tx, ty);
+			if (g_hash_table_contains (pyramid->tiles, key))
+				continue;
+			g_array_append_val (keys, *key);
+		}
+	}
+	g_mutex_unlock (&pyramid->mutex);
+	if (transform == NULL) {
+		g_set_error_literal (error, 1, 0, "no transform set");
+		return FALSE;
+	}
+
+	/* the source is shared, only the tiles are allocated */
+	for (guint i = 0; i < keys->len; i++) {
+		gint64 key = g_array_index (keys, gint64, i);
+		guint tx = (guint) (key & 0xffffff);
+		guint ty = (guint) ((key >> 24) & 0xffffff);
+		gint x = (gint) tx * GCM_PYRAMID_TILE_SIZE;
+		gint y = (gint) ty * GCM_PYRAMID_TILE_SIZE;
+		GcmUtilsRegion region;
+		GdkPixbuf *dest;
+
+		dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
+				       gdk_pixbuf_get_has_alpha (pixbuf), 8,
+				       MIN (GCM_PYRAMID_TILE_SIZE, gdk_pixbuf_get_width (pixbuf) - x),
+				       MIN (GCM_PYRAMID_TILE_SIZE, gdk_pixbuf_get_height (pixbuf) - y));
+		g_ptr_array_add (dests, dest);
+		region.src = gdk_pixbuf_read_pixels (pixbuf) +
+			     (gsize) y * gdk_pixbuf_get_rowstride (pixbuf) + (gsize) x * bpp;
+		region.src_stride = gdk_pixbuf_get_rowstride (pixbuf);
+		region.dst = gdk_pixbuf_get_pixels (dest);
+		region.dst_stride = gdk_pixbuf_get_rowstride (dest);
+		region.width = gdk_pixbuf_get_width (dest);
+		region.height = gdk_pixbuf_get_height (dest);
+		g_array_append_val (regions, region);
+	}
+	if (!gcm_utils_transform_process_regions (transform,
+						  (const GcmUtilsRegion *) regions->data,
+						  regions->len,
+						  cancellable, error))
+		return FALSE;
+
+	/* the transform may have changed while converting */
+	g_mutex_lock (&pyramid->mutex);
+	if (pyramid->transform == transform) {
+		for (guint i = 0; i < keys->len; i++) {
+			GcmPyramidTile *tile = g_new0 (GcmPyramidTile, 1);
+			gint64 *key = g_new (gint64, 1);
+			*key = g_array_index (keys, gint64, i);
+			tile->pixbuf = g_object_ref (g_ptr_array_index (dests, i));
+			tile->used = ++pyramid->clock;
+			g_hash_table_replace (pyramid->tiles, key, tile);
+		}
+		gcm_pyramid_evict_tiles (pyramid);
+	}
+	g_mutex_unlock (&pyramid->mutex);
+	return TRUE;
+}
+
+typedef struct {
+	GcmPyramid	*pyramid;
+	guint		 level;
+	GdkRectangle	 area;
+} GcmPyramidHelper;
+
+static void
+gcm_pyramid_helper_free (GcmPyramidHelper *helper)
+{
+	gcm_pyramid_unref (helper->pyramid);
+	g_free (helper);
+}
+
+static void
+gcm_pyramid_convert_thread_cb (GTask *task,
+			       gpointer source_object,
+			       gpointer task_data,
+			       GCancellable *cancellable)
+{
+	GcmPyramidHelper *helper = (GcmPyramidHelper *) task_data;
+	GError *error = NULL;
+
+	if (!gcm_pyramid_convert (helper->pyramid, helper->level, &helper->area,
+				  cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gcm_pyramid_convert_async:
+ *
+ * Converts the visible tiles in a thread; see gcm_pyramid_convert().
+ **/
+void
+gcm_pyramid_convert_async (GcmPyramid *pyramid,
+			   guint level,
+			   const GdkRectangle *area,
+			   GCancellable *cancellable,
+			   GAsyncReadyCallback callback,
+			   gpointer user_data)
+{
+	GcmPyramidHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	helper = g_new0 (GcmPyramidHelper, 1);
+	helper->pyramid = gcm_pyramid_ref (pyramid);
+	helper->level = level;
+	helper->area = *area;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gcm_pyramid_helper_free);
+	g_task_run_in_thread (task, gcm_pyramid_convert_thread_cb);
+}
+
+gboolean
+gcm_pyramid_convert_finish (GAsyncResult *res, GError **error)
+{
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
@@ -0,0 +1,49 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "gcm-utils.h"
+
+#define GCM_PYRAMID_TILE_SIZE		256	/* px */
+
+typedef struct _GcmPyramid		GcmPyramid;
+
+GcmPyramid	*gcm_pyramid_new		(GdkPixbuf		*source);
+GcmPyramid	*gcm_pyramid_ref		(GcmPyramid		*pyramid);
+void		 gcm_pyramid_unref		(GcmPyramid		*pyramid);
+guint		 gcm_pyramid_get_n_levels	(GcmPyramid		*pyramid);
+GdkPixbuf	*gcm_pyramid_get_level		(GcmPyramid		*pyramid,
+						 guint			 level);
+guint		 gcm_pyramid_get_level_for_scale (GcmPyramid		*pyramid,
+						 gdouble		 scale);
+guint		 gcm_pyramid_get_level_for_width (GcmPyramid		*pyramid,
+						 gint			 width);
+void		 gcm_pyramid_set_transform	(GcmPyramid		*pyramid,
+						 GcmUtilsTransform	*transform);
+GdkPixbuf	*gcm_pyramid_get_tile		(GcmPyramid		*pyramid,
+						 guint			 level,
+						 guint			 tile_x,
+						 guint			 tile_y);
+gboolean	 gcm_pyramid_convert		(GcmPyramid		*pyramid,
+						 guint			 level,
+						 const GdkRectangle	*area,
+						 GCancellable		*cancellable,
+						 GError			**error);
+void		 gcm_pyramid_convert_async	(GcmPyramid		*pyramid,
+						 guint			 level,
+						 const GdkRectangle	*area,
+						 GCancellable		*cancellable,
+						 GAsyncReadyCallback	 callback,
+						 gpointer		 user_data);
+gboolean	 gcm_pyramid_convert_finish	(GAsyncResult		*res,
+						 GError			**error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmPyramid, gcm_pyramid_unref)
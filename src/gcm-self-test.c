@@ -11,10 +11,20 @@
 #include <math.h>
 #include <glib/gstdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "gcm-cie-widget.h"
+#include "gcm-color-math.h"
 #include "gcm-debug.h"
 #include "gcm-gamma-widget.h"
+#include "gcm-lcms.h"
+#include "gcm-lut.h"
+#include "gcm-named-color-index.h"
+#include "gcm-named-color-search.h"
+#include "gcm-palette.h"
+#include "gcm-pyramid.h"
+#include "gcm-shaper.h"
+#include "gcm-tiff.h"
 #include "gcm-trc-widget.h"
 #include "gcm-utils.h"
 
@@ -163,6 +173,1244 @@ gcm_test_trc_widget_func (void)
 	gtk_widget_destroy (dialog);
 }
 
+static void
+gcm_test_delta_e_func (void)
+{
+	CdColorLab lab1;
+	CdColorLab lab2;
+
+	/* from Sharma, Wu and Dalal */
+	cd_color_lab_set (&lab1, 50.0, 2.6772, -79.7751);
+	cd_color_lab_set (&lab2, 50.0, 0.0, -82.7485);
+	g_assert_cmpfloat (fabs (gcm_color_math_delta_e2000 (&lab1, &lab2) - 2.0425), <, 0.0001);
+	cd_color_lab_set (&lab1, 50.0, 2.5, 0.0);
+	cd_color_lab_set (&lab2, 73.0, 25.0, -18.0);
+	g_assert_cmpfloat (fabs (gcm_color_math_delta_e2000 (&lab1, &lab2) - 27.1492), <, 0.0001);
+	cd_color_lab_set (&lab1, 50.0, 2.49, -0.001);
+	cd_color_lab_set (&lab2, 50.0, -2.49, 0.0011);
+	g_assert_cmpfloat (fabs (gcm_color_math_delta_e2000 (&lab1, &lab2) - 7.2195), <, 0.0001);
+	g_assert_cmpfloat (gcm_color_math_delta_e2000 (&lab1, &lab1), ==, 0.0);
+}
+
+/* the arrays are checked against the scalar versions, and those against LCMS,
+ * or against known values and their own scalar remainder */
+static void
+gcm_test_color_math_func (void)
+{
+	const guint n = 1003; /* not a multiple of the vector size */
+	const gdouble whitepoints[][2] = { { 0.3127, 0.3290 },	/* D65 */
+					   { 0.3457, 0.3585 },	/* D50 */
+					   { 0.3805, 0.3768 },	/* 4000K */
+					   { 0.2800, 0.2900 } };
+	cmsCIELab lab_lcms;
+	cmsCIEXYZ xyz_lcms;
+	cmsCIExyY xyy_lcms;
+	gdouble temperature;
+	gdouble temperature_lcms;
+	CdColorLab lab;
+	CdColorLab lab_sample;
+	CdColorXYZ xyz_sample;
+	CdColorYxy yxy_sample;
+	gfloat lab_ref[3] = { 50.f, 2.5f, 0.f };
+	gfloat lab_pair[3] = { 73.f, 25.f, -18.f };
+	gfloat value;
+	g_autofree gfloat *cct = NULL;
+	g_autofree gfloat *lab1 = NULL;
+	g_autofree gfloat *lab2 = NULL;
+	g_autofree gfloat *out94 = NULL;
+	g_autofree gfloat *out2000 = NULL;
+	g_autofree gfloat *xyz = NULL;
+	g_autofree gfloat *yxy = NULL;
+
+	/* ΔE94 is not symmetric, so the first is the reference */
+	gcm_color_math_delta_e94_array (lab_ref, lab_pair, &value, 1);
+	g_assert_cmpfloat (fabs (value - 34.6892), <, 0.001);
+
+	/* whitepoint temperatures */
+	for (guint i = 0; i < G_N_ELEMENTS (whitepoints); i++) {
+		yxy_sample.Y = 1.0;
+		yxy_sample.x = whitepoints[i][0];
+		yxy_sample.y = whitepoints[i][1];
+		xyy_lcms.Y = 1.0;
+		xyy_lcms.x = whitepoints[i][0];
+		xyy_lcms.y = whitepoints[i][1];
+		g_assert_true (gcm_color_math_get_cct (&yxy_sample, &temperature));
+		g_assert_true (cmsTempFromWhitePoint (&temperature_lcms, &xyy_lcms));
+		g_assert_cmpfloat (fabs (temperature - temperature_lcms), <, 0.01);
+	}
+	cd_color_yxy_set (&yxy_sample, 1.0, 0.6, 0.3);
+	g_assert_false (gcm_color_math_get_cct (&yxy_sample, &temperature));
+
+	/* random colors, including black and some out of gamut */
+	xyz = g_new (gfloat, n * 3);
+	yxy = g_new (gfloat, n * 3);
+	lab1 = g_new (gfloat, n * 3);
+	lab2 = g_new (gfloat, n * 3);
+	out94 = g_new (gfloat, n);
+	out2000 = g_new (gfloat, n);
+	cct = g_new (gfloat, n);
+	for (guint i = 0; i < n; i++) {
+		xyz[i] = g_random_double_range (0.001, 1.0);
+		xyz[n + i] = g_random_double_range (0.001, 1.0);
+		xyz[n * 2 + i] = g_random_double_range (0.001, 1.0);
+		lab2[i] = g_random_double_range (0.0, 100.0);
+		lab2[n + i] = g_random_double_range (-100.0, 100.0);
+		lab2[n * 2 + i] = g_random_double_range (-100.0, 100.0);
+	}
+	xyz[0] = 0.f;
+	xyz[n] = 0.f;
+	xyz[n * 2] = 0.f;
+	gcm_color_math_xyz_to_lab_array (xyz, NULL, lab1, n);
+	gcm_color_math_delta_e94_array (lab1, lab2, out94, n);
+	gcm_color_math_delta_e2000_array (lab1, lab2, out2000, n);
+	for (guint i = 0; i < n; i++) {
+		xyz_sample.X = xyz[i];
+		xyz_sample.Y = xyz[n + i];
+		xyz_sample.Z = xyz[n * 2 + i];
+		xyz_lcms.X = xyz[i];
+		xyz_lcms.Y = xyz[n + i];
+		xyz_lcms.Z = xyz[n * 2 + i];
+		gcm_color_math_xyz_to_lab (&xyz_sample, NULL, &lab);
+		cmsXYZ2Lab (NULL, &lab_lcms, &xyz_lcms);
+		g_assert_cmpfloat (fabs (lab.L - lab_lcms.L), <, 0.0001);
+		g_assert_cmpfloat (fabs (lab.a - lab_lcms.a), <, 0.0001);
+		g_assert_cmpfloat (fabs (lab.b - lab_lcms.b), <, 0.0001);
+		g_assert_cmpfloat (fabs (lab.L - lab1[i]), <, 0.001);
+		g_assert_cmpfloat (fabs (lab.a - lab1[n + i]), <, 0.001);
+		g_assert_cmpfloat (fabs (lab.b - lab1[n * 2 + i]), <, 0.001);
+
+		/* differences */
+		cd_color_lab_set (&lab, lab1[i], lab1[n + i], lab1[n * 2 + i]);
+		cd_color_lab_set (&lab_sample, lab2[i], lab2[n + i], lab2[n * 2 + i]);
+		g_assert_cmpfloat (fabs (gcm_color_math_delta_e2000 (&lab, &lab_sample) - out2000[i]), <, 0.001);
+	}
+
+	/* one color at a time only uses the scalar remainder */
+	for (guint i = 0; i < n; i++) {
+		for (guint c = 0; c < 3; c++) {
+			lab_ref[c] = lab1[n * c + i];
+			lab_pair[c] = lab2[n * c + i];
+		}
+		gcm_color_math_delta_e94_array (lab_ref, lab_pair, &value, 1);
+		g_assert_cmpfloat (fabs (value - out94[i]), <, 0.001);
+	}
+
+	/* round trips */
+	gcm_color_math_lab_to_xyz_array (lab1, NULL, lab2, n);
+	for (guint i = 0; i < n * 3; i++)
+		g_assert_cmpfloat (fabs (xyz[i] - lab2[i]), <, 0.0001);
+
+	/* chromaticity, where black has none */
+	gcm_color_math_xyz_to_yxy_array (xyz, yxy, n);
+	g_assert_cmpfloat (yxy[n], ==, 0.f);
+	g_assert_cmpfloat (yxy[n * 2], ==, 0.f);
+	for (guint i = 1; i < n; i++) {
+		xyz_sample.X = xyz[i];
+		xyz_sample.Y = xyz[n + i];
+		xyz_sample.Z = xyz[n * 2 + i];
+		cd_color_xyz_to_yxy (&xyz_sample, &yxy_sample);
+		g_assert_cmpfloat (fabs (yxy_sample.Y - yxy[i]), <, 0.0001);
+		g_assert_cmpfloat (fabs (yxy_sample.x - yxy[n + i]), <, 0.0001);
+		g_assert_cmpfloat (fabs (yxy_sample.y - yxy[n * 2 + i]), <, 0.0001);
+	}
+
+	/* temperatures, where some colors are too far from white */
+	gcm_color_math_cct_array (yxy, cct, n);
+	for (guint i = 0; i < n; i++) {
+		yxy_sample.Y = yxy[i];
+		yxy_sample.x = yxy[n + i];
+		yxy_sample.y = yxy[n * 2 + i];
+		if (!gcm_color_math_get_cct (&yxy_sample, &temperature))
+			temperature = 0.0;
+		g_assert_cmpfloat (fabs (temperature - cct[i]), <=, temperature * 0.0001);
+	}
+}
+
+/* the optimized paths may round differently, but not visibly */
+static void
+gcm_test_lcms_context_func (void)
+{
+	const guint n_pixels = 32 * 32 * 32;
+	cmsContext context = gcm_lcms_get_context ();
+	cmsHPROFILE profiles[2][2];
+	cmsHTRANSFORM transforms[2][2];
+	gdouble max_flt = 0.f;
+	gfloat *dst_flt[2];
+	gint max_8 = 0;
+	guint8 *dst_8[2];
+	g_autofree gfloat *src_flt = g_new (gfloat, n_pixels * 3);
+	g_autofree guint8 *src_8 = g_new (guint8, n_pixels * 3);
+
+	/* 32 steps of each channel */
+	for (guint i = 0; i < n_pixels; i++) {
+		src_8[i * 3 + 0] = (i >> 10) * 255 / 31;
+		src_8[i * 3 + 1] = ((i >> 5) & 31) * 255 / 31;
+		src_8[i * 3 + 2] = (i & 31) * 255 / 31;
+		for (guint c = 0; c < 3; c++)
+			src_flt[i * 3 + c] = src_8[i * 3 + c] / 255.f;
+	}
+
+	/* the stock pipeline first, then the thread context */
+	for (guint j = 0; j < 2; j++) {
+		cmsContext ctx = j == 0 ? NULL : context;
+		profiles[j][0] = cmsCreate_sRGBProfileTHR (ctx);
+		profiles[j][1] = cmsOpenProfileFromFileTHR (ctx, TESTDATADIR "/ibm-t61.icc", "r");
+		g_assert (profiles[j][1] != NULL);
+		g_assert (cmsIsMatrixShaper (profiles[j][1]));
+		transforms[j][0] = cmsCreateTransformTHR (ctx,
+							  profiles[j][0], TYPE_RGB_8,
+							  profiles[j][1], TYPE_RGB_8,
+							  INTENT_PERCEPTUAL, 0);
+		transforms[j][1] = cmsCreateTransformTHR (ctx,
+							  profiles[j][0], TYPE_RGB_FLT,
+							  profiles[j][1], TYPE_RGB_FLT,
+							  INTENT_PERCEPTUAL, 0);
+		g_assert (transforms[j][0] != NULL);
+		g_assert (transforms[j][1] != NULL);
+		dst_8[j] = g_new (guint8, n_pixels * 3);
+		dst_flt[j] = g_new (gfloat, n_pixels * 3);
+		cmsDoTransform (transforms[j][0], src_8, dst_8[j], n_pixels);
+		cmsDoTransform (transforms[j][1], src_flt, dst_flt[j], n_pixels);
+	}
+	for (guint i = 0; i < n_pixels * 3; i++) {
+		max_8 = MAX (max_8, ABS ((gint) dst_8[0][i] - (gint) dst_8[1][i]));
+		max_flt = MAX (max_flt, fabs (dst_flt[0][i] - dst_flt[1][i]));
+	}
+	g_debug ("fast float plugin differs by %i/255 and %f", max_8, max_flt);
+	g_assert_cmpint (max_8, <=, 2);
+	g_assert_cmpfloat (max_flt, <, 0.005);
+#ifndef HAVE_LCMS2_FAST_FLOAT
+	/* nothing is registered */
+	g_assert_cmpint (max_8, ==, 0);
+#endif
+
+	for (guint j = 0; j < 2; j++) {
+		cmsDeleteTransform (transforms[j][0]);
+		cmsDeleteTransform (transforms[j][1]);
+		cmsCloseProfile (profiles[j][0]);
+		cmsCloseProfile (profiles[j][1]);
+		g_free (dst_8[j]);
+		g_free (dst_flt[j]);
+	}
+}
+
+static gpointer
+gcm_test_lcms_thread_cb (gpointer user_data)
+{
+	gint *running = (gint *) user_data;
+	cmsHTRANSFORM transform;
+	CdColorLab lab = { 50.f, 0.f, 0.f };
+	CdColorRGB8 rgb = { 0, 0, 0 };
+	g_autoptr(GError) error = NULL;
+
+	/* created once for each thread */
+	transform = gcm_lcms_get_transform (GCM_LCMS_PROFILE_LAB2, TYPE_Lab_DBL,
+					    GCM_LCMS_PROFILE_SRGB, TYPE_RGB_8,
+					    INTENT_RELATIVE_COLORIMETRIC, &error);
+	g_assert_no_error (error);
+	g_assert (transform != NULL);
+	g_assert (gcm_lcms_get_transform (GCM_LCMS_PROFILE_LAB2, TYPE_Lab_DBL,
+					  GCM_LCMS_PROFILE_SRGB, TYPE_RGB_8,
+					  INTENT_RELATIVE_COLORIMETRIC, &error) == transform);
+	for (guint i = 0; i < 1000; i++)
+		cmsDoTransform (transform, &lab, &rgb, 1);
+
+	/* neutral grey */
+	g_assert_cmpint (ABS ((gint) rgb.R - 119), <=, 1);
+	g_assert_cmpint (rgb.R, ==, rgb.G);
+	g_assert_cmpint (rgb.G, ==, rgb.B);
+
+	/* keep the context until all the threads have one */
+	g_atomic_int_dec_and_test (running);
+	while (g_atomic_int_get (running) > 0)
+		g_usleep (1000);
+	return gcm_lcms_get_context ();
+}
+
+static void
+gcm_test_lcms_threads_func (void)
+{
+	cmsHPROFILE profile;
+	cmsHTRANSFORM transform;
+	gpointer context;
+	gpointer context_main;
+	gint running = 4;
+	gpointer contexts[4];
+	GThread *threads[4];
+	g_autoptr(GError) error = NULL;
+
+	/* each thread running at the same time has its own context, and
+	 * this one has to have its own before others exit into the pool */
+	context_main = gcm_lcms_get_context ();
+	for (guint i = 0; i < G_N_ELEMENTS (threads); i++)
+		threads[i] = g_thread_new ("lcms", gcm_test_lcms_thread_cb, &running);
+	for (guint i = 0; i < G_N_ELEMENTS (threads); i++)
+		contexts[i] = g_thread_join (threads[i]);
+	for (guint i = 0; i < G_N_ELEMENTS (threads); i++) {
+		g_assert (contexts[i] != NULL);
+		g_assert (contexts[i] != context_main);
+		for (guint j = 0; j < i; j++)
+			g_assert (contexts[i] != contexts[j]);
+	}
+
+	/* contexts of threads that have exited are reused */
+	running = 1;
+	threads[0] = g_thread_new ("lcms", gcm_test_lcms_thread_cb, &running);
+	context = g_thread_join (threads[0]);
+	g_assert (context == contexts[0] || context == contexts[1] ||
+		  context == contexts[2] || context == contexts[3]);
+
+	/* the LCMS message is included */
+	transform = gcm_lcms_get_transform (TESTDATADIR "/test.png", TYPE_RGB_8,
+					    GCM_LCMS_PROFILE_SRGB, TYPE_RGB_8,
+					    INTENT_PERCEPTUAL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (transform == NULL);
+	g_assert (g_str_has_prefix (error->message, "failed to create transform: "));
+	g_clear_error (&error);
+	transform = gcm_lcms_get_transform (TESTDATADIR "/missing.icc", TYPE_RGB_8,
+					    GCM_LCMS_PROFILE_SRGB, TYPE_RGB_8,
+					    INTENT_PERCEPTUAL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (transform == NULL);
+	g_clear_error (&error);
+
+	/* an error nobody asked for is not attached to a later failure */
+	profile = cmsOpenProfileFromFileTHR (gcm_lcms_get_context (),
+					     TESTDATADIR "/missing.icc", "r");
+	g_assert (profile == NULL);
+	context = gcm_lcms_get_context ();
+	g_assert (context == context_main);
+	gcm_lcms_set_error (&error, "failed");
+	g_assert_error (error, 1, 0);
+	g_assert_cmpstr (error->message, ==, "failed");
+}
+
+static void
+gcm_test_transform_cache_func (void)
+{
+	GcmUtilsTransform *transform1;
+	GcmUtilsTransform *transform2;
+	GcmUtilsTransform *transform3;
+	g_autoptr(GError) error = NULL;
+
+	/* same key is the same transform */
+	transform1 = gcm_utils_transform_new (NULL, NULL, NULL,
+					      CD_RENDERING_INTENT_PERCEPTUAL,
+					      TYPE_RGB_8, TYPE_RGB_8, FALSE, &error);
+	g_assert_no_error (error);
+	g_assert (transform1 != NULL);
+	transform2 = gcm_utils_transform_new (NULL, NULL, NULL,
+					      CD_RENDERING_INTENT_PERCEPTUAL,
+					      TYPE_RGB_8, TYPE_RGB_8, FALSE, &error);
+	g_assert_no_error (error);
+	g_assert (transform1 == transform2);
+
+	/* different intent */
+	transform3 = gcm_utils_transform_new (NULL, NULL, NULL,
+					      CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+					      TYPE_RGB_8, TYPE_RGB_8, TRUE, &error);
+	g_assert_no_error (error);
+	g_assert (transform1 != transform3);
+
+	gcm_utils_transform_unref (transform1);
+	gcm_utils_transform_unref (transform2);
+	gcm_utils_transform_unref (transform3);
+}
+
+static void
+gcm_test_transform_process_func (void)
+{
+	const guint width = 1000;
+	const guint height = 700;
+	const guint stride = width * 3;
+	gboolean ret;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree guint8 *src = g_malloc (stride * height);
+	g_autofree guint8 *dst = g_malloc (stride * height);
+	g_autofree guint8 *ref = g_malloc (stride * height);
+
+	for (guint i = 0; i < stride * height; i++)
+		src[i] = g_random_int_range (0, 256);
+	transform = gcm_utils_transform_new (NULL, NULL, NULL,
+					     CD_RENDERING_INTENT_SATURATION,
+					     TYPE_RGB_8, TYPE_RGB_8, TRUE, &error);
+	g_assert_no_error (error);
+	for (guint y = 0; y < height; y++) {
+		cmsDoTransform (gcm_utils_transform_get_handle (transform),
+				src + y * stride, ref + y * stride, width);
+	}
+
+	/* tiled on the pool */
+	ret = gcm_utils_transform_process (transform, src, stride, dst, stride,
+					   width, height, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (memcmp (dst, ref, stride * height) == 0);
+
+	/* in place */
+	ret = gcm_utils_transform_process (transform, src, stride, src, stride,
+					   width, height, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (memcmp (src, ref, stride * height) == 0);
+}
+
+static void
+gcm_test_pixbuf_convert_func (void)
+{
+	gboolean ret;
+	guint8 *pixels;
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autoptr(GdkPixbuf) src = NULL;
+	g_autoptr(GdkPixbuf) dest = NULL;
+	g_autoptr(GdkPixbuf) ref = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+
+	/* only the displayed pixels are converted */
+	src = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 400, 200);
+	gdk_pixbuf_fill (src, 0x336699ff);
+	dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 100, 50);
+	ret = gcm_utils_pixbuf_convert (src, dest, NULL, NULL, NULL,
+					CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+					NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	pixels = gdk_pixbuf_get_pixels (dest);
+	g_assert_cmpint (ABS ((gint) pixels[0] - 0x33), <=, 1);
+	g_assert_cmpint (ABS ((gint) pixels[1] - 0x66), <=, 1);
+	g_assert_cmpint (ABS ((gint) pixels[2] - 0x99), <=, 1);
+
+	/* never scaled up */
+	ret = gcm_utils_pixbuf_convert (dest, src, NULL, NULL, NULL,
+					CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+					NULL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (!ret);
+	g_clear_error (&error);
+
+	/* the exact conversion is the same as LCMS, even where the
+	 * preview can use a lookup table */
+	file = g_file_new_for_path (TESTDATADIR "/ibm-t61.icc");
+	ret = cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_clear_object (&src);
+	g_clear_object (&dest);
+	src = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 64, 64);
+	dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 64, 64);
+	ref = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 64, 64);
+	for (gint y = 0; y < 64; y++) {
+		guint8 *row = gdk_pixbuf_get_pixels (src) + y * gdk_pixbuf_get_rowstride (src);
+		for (guint i = 0; i < 64 * 3; i++)
+			row[i] = g_random_int_range (0, 256);
+	}
+	ret = gcm_utils_pixbuf_convert (src, dest, NULL, NULL, icc,
+					CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+					NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	transform = gcm_utils_transform_new (NULL, NULL, icc,
+					     CD_RENDERING_INTENT_PERCEPTUAL,
+					     TYPE_RGB_8, TYPE_RGB_8, FALSE, &error);
+	g_assert_no_error (error);
+	for (gint y = 0; y < 64; y++) {
+		cmsDoTransform (gcm_utils_transform_get_handle (transform),
+				gdk_pixbuf_get_pixels (src) + y * gdk_pixbuf_get_rowstride (src),
+				gdk_pixbuf_get_pixels (ref) + y * gdk_pixbuf_get_rowstride (ref),
+				64);
+		g_assert (memcmp (gdk_pixbuf_get_pixels (dest) + y * gdk_pixbuf_get_rowstride (dest),
+				  gdk_pixbuf_get_pixels (ref) + y * gdk_pixbuf_get_rowstride (ref),
+				  64 * 3) == 0);
+	}
+}
+
+static void
+gcm_test_pixbuf_proof_func (void)
+{
+	const CdColorRGB8 warning = { 0xff, 0x00, 0xff };
+	gboolean ret;
+	guint8 *pixels;
+	guint8 *pixels_ref;
+	gint stride;
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GdkPixbuf) src = NULL;
+	g_autoptr(GdkPixbuf) dest = NULL;
+	g_autoptr(GdkPixbuf) ref = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+
+	/* an odd width so some pixels miss the vector path */
+	file = g_file_new_for_path (TESTDATADIR "/ibm-t61.icc");
+	ret = cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	src = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 301, 20);
+	gdk_pixbuf_fill (src, 0x808080ff);
+	ref = gdk_pixbuf_new_subpixbuf (src, 0, 0, 301, 10);
+	gdk_pixbuf_fill (ref, 0x0000ffff);
+	g_clear_object (&ref);
+	stride = gdk_pixbuf_get_rowstride (src);
+
+	/* without a warning */
+	ref = gdk_pixbuf_copy (src);
+	ret = gcm_utils_pixbuf_proof (src, ref, icc,
+				      CD_RENDERING_INTENT_PERCEPTUAL,
+				      0.f, &warning, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* saturated blue is outside the laptop panel gamut, gray is not */
+	dest = gdk_pixbuf_copy (src);
+	ret = gcm_utils_pixbuf_proof (src, dest, icc,
+				      CD_RENDERING_INTENT_PERCEPTUAL,
+				      5.f, &warning, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	pixels = gdk_pixbuf_get_pixels (dest);
+	pixels_ref = gdk_pixbuf_get_pixels (ref);
+	for (guint x = 0; x < 301; x++) {
+		guint8 *blue = pixels + x * 3;
+		guint8 *gray = pixels + 15 * stride + x * 3;
+		g_assert_cmpint (blue[0], ==, 0xff);
+		g_assert_cmpint (blue[1], ==, 0x00);
+		g_assert_cmpint (blue[2], ==, 0xff);
+		g_assert (memcmp (gray, pixels_ref + 15 * stride + x * 3, 3) == 0);
+	}
+
+	/* in place */
+	ret = gcm_utils_pixbuf_proof (src, src, icc,
+				      CD_RENDERING_INTENT_PERCEPTUAL,
+				      5.f, &warning, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (gint y = 0; y < 20; y++)
+		g_assert (memcmp (gdk_pixbuf_get_pixels (src) + y * stride,
+				  pixels + y * stride, 301 * 3) == 0);
+}
+
+static void
+gcm_test_pixbuf_delta_e_func (void)
+{
+	gboolean ret;
+	gdouble mean;
+	gdouble p95;
+	gdouble max;
+	guint8 *pixels;
+	gint stride;
+	g_autoptr(GcmUtilsDeltaE) delta_e = gcm_utils_delta_e_new ();
+	g_autoptr(GdkPixbuf) src = NULL;
+	g_autoptr(GdkPixbuf) src_large = NULL;
+	g_autoptr(GdkPixbuf) dest = NULL;
+	g_autoptr(GdkPixbuf) heatmap = NULL;
+	g_autoptr(GdkPixbuf) sub = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* nothing compared yet */
+	g_assert (!gcm_utils_delta_e_get_stats (delta_e, &mean, &p95, &max));
+
+	/* half of the image is a little bluer */
+	src = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 301, 20);
+	gdk_pixbuf_fill (src, 0x808080ff);
+	dest = gdk_pixbuf_copy (src);
+	sub = gdk_pixbuf_new_subpixbuf (dest, 0, 0, 301, 10);
+	gdk_pixbuf_fill (sub, 0x8080a0ff);
+	heatmap = gdk_pixbuf_copy (src);
+	ret = gcm_utils_pixbuf_delta_e (src, dest, heatmap, delta_e, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (gcm_utils_delta_e_get_stats (delta_e, &mean, &p95, &max));
+	g_assert_cmpfloat (max, >, 5.0);
+	g_assert_cmpfloat (fabs (mean - max / 2), <, 0.001);
+	g_assert_cmpfloat (fabs (p95 - max), <, 0.1);
+	pixels = gdk_pixbuf_get_pixels (heatmap);
+	stride = gdk_pixbuf_get_rowstride (heatmap);
+	g_assert_cmpint (pixels[0], >, 0);
+	g_assert_cmpint (pixels[15 * stride + 0], ==, 0);
+	g_assert_cmpint (pixels[15 * stride + 1], ==, 0);
+	g_assert_cmpint (pixels[15 * stride + 2], ==, 0);
+
+	/* the source is scaled to the converted size */
+	gcm_utils_delta_e_free (g_steal_pointer (&delta_e));
+	delta_e = gcm_utils_delta_e_new ();
+	src_large = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 602, 40);
+	gdk_pixbuf_fill (src_large, 0x808080ff);
+	ret = gcm_utils_pixbuf_delta_e (src_large, src, NULL, delta_e, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (gcm_utils_delta_e_get_stats (delta_e, &mean, &p95, &max));
+	g_assert_cmpfloat (max, <, 0.001);
+
+	/* different formats */
+	g_clear_object (&src_large);
+	src_large = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 301, 20);
+	ret = gcm_utils_pixbuf_delta_e (src_large, src, NULL, delta_e, NULL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (!ret);
+}
+
+static void
+gcm_test_pixbuf_convert_grid_func (void)
+{
+	gboolean ret;
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GdkPixbuf) src = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GPtrArray) dests = NULL;
+
+	file = g_file_new_for_path (TESTDATADIR "/ibm-t61.icc");
+	ret = cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	src = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 200, 100);
+	for (gint y = 0; y < 100; y++) {
+		guint8 *row = gdk_pixbuf_get_pixels (src) + y * gdk_pixbuf_get_rowstride (src);
+		for (guint i = 0; i < 200 * 3; i++)
+			row[i] = g_random_int_range (0, 256);
+	}
+
+	/* wrong number of cells */
+	dests = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	ret = gcm_utils_pixbuf_convert_grid (src, dests, NULL, icc, NULL, NULL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (!ret);
+	g_clear_error (&error);
+
+	/* each cell is the same as converting with that intent on its own */
+	for (guint i = 0; i < GCM_UTILS_INTENT_GRID_SIZE; i++)
+		g_ptr_array_add (dests, gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 100, 50));
+	ret = gcm_utils_pixbuf_convert_grid (src, dests, NULL, icc, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (guint i = 0; i < GCM_UTILS_INTENT_GRID_SIZE; i++) {
+		CdRenderingIntent intent;
+		gboolean bpc;
+		GdkPixbuf *dest = g_ptr_array_index (dests, i);
+		g_autoptr(GdkPixbuf) ref = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 100, 50);
+
+		gcm_utils_intent_grid_get_cell (i, &intent, &bpc);
+		ret = gcm_utils_pixbuf_convert_preview (src, ref, NULL, icc, NULL,
+							intent, bpc, NULL, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		for (gint y = 0; y < 50; y++) {
+			g_assert (memcmp (gdk_pixbuf_get_pixels (dest) + y * gdk_pixbuf_get_rowstride (dest),
+					  gdk_pixbuf_get_pixels (ref) + y * gdk_pixbuf_get_rowstride (ref),
+					  100 * 3) == 0);
+		}
+	}
+}
+
+static void
+gcm_test_pixbuf_ramps_func (void)
+{
+	cmsCIExyY white = { 0.3127, 0.3290, 1.0 };
+	cmsCIExyYTRIPLE primaries = { { 0.64, 0.33, 1.0 },
+				      { 0.30, 0.60, 1.0 },
+				      { 0.15, 0.06, 1.0 } };
+	cmsHPROFILE profile;
+	cmsToneCurve *curves[3];
+	cmsUInt16Number falling[] = { 65535, 0 };
+	cmsUInt16Number stairs[4096];
+	gboolean found = FALSE;
+	gboolean ret;
+	guint levels;
+	guint reversals;
+	guint steps;
+	guint8 *row;
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GcmUtilsBanding) banding = gcm_utils_banding_new ();
+	g_autoptr(GdkPixbuf) dest = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* a gamma 2.2 display calibrated to 16 levels of red, with green
+	 * backwards and blue left alone */
+	curves[0] = cmsBuildGamma (NULL, 2.2);
+	curves[1] = curves[0];
+	curves[2] = curves[0];
+	profile = cmsCreateRGBProfile (&white, &primaries, curves);
+	cmsFreeToneCurve (curves[0]);
+	for (guint i = 0; i < G_N_ELEMENTS (stairs); i++)
+		stairs[i] = (cmsUInt16Number) ((i * 16 / G_N_ELEMENTS (stairs)) * 65535 / 15);
+	curves[0] = cmsBuildTabulatedToneCurve16 (NULL, G_N_ELEMENTS (stairs), stairs);
+	curves[1] = cmsBuildTabulatedToneCurve16 (NULL, G_N_ELEMENTS (falling), falling);
+	curves[2] = cmsBuildGamma (NULL, 1.0);
+	cmsWriteTag (profile, cmsSigVcgtTag, curves);
+	for (guint i = 0; i < 3; i++)
+		cmsFreeToneCurve (curves[i]);
+	ret = cd_icc_load_handle (icc, profile, CD_ICC_LOAD_FLAGS_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* nothing yet */
+	g_assert (!gcm_utils_banding_get_stats (banding, 0, NULL, NULL, NULL));
+
+	dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 300, 100);
+	ret = gcm_utils_pixbuf_ramps (dest, icc, banding, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* red is quantized */
+	g_assert (gcm_utils_banding_get_stats (banding, 0, &levels, &steps, &reversals));
+	g_assert_cmpint (levels, <, 100);
+	g_assert_cmpint (steps, >, 0);
+	g_assert_cmpint (reversals, ==, 0);
+
+	/* green goes backwards */
+	g_assert (gcm_utils_banding_get_stats (banding, 1, NULL, NULL, &reversals));
+	g_assert_cmpint (reversals, >, 0);
+
+	/* blue is smooth */
+	g_assert (gcm_utils_banding_get_stats (banding, 2, &levels, &steps, &reversals));
+	g_assert_cmpint (levels, >=, 1000);
+	g_assert_cmpint (steps, ==, 0);
+	g_assert_cmpint (reversals, ==, 0);
+
+	/* the steps in the red ramp are marked underneath it */
+	row = gdk_pixbuf_get_pixels (dest) + 24 * gdk_pixbuf_get_rowstride (dest);
+	for (guint x = 0; x < 300; x++) {
+		if (row[x * 3 + 0] == 255 && row[x * 3 + 1] == 255 && row[x * 3 + 2] == 0)
+			found = TRUE;
+	}
+	g_assert (found);
+}
+
+static void
+gcm_test_pyramid_func (void)
+{
+	gboolean ret;
+	guint32 format = gcm_utils_get_pixel_format_for_depth (8, FALSE, FALSE);
+	GdkPixbuf *level;
+	GdkRectangle area = { 300, 10, 10, 10 };
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GcmPyramid) pyramid = NULL;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autoptr(GdkPixbuf) ref = NULL;
+	g_autoptr(GdkPixbuf) src = NULL;
+	g_autoptr(GdkPixbuf) tile = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+
+	/* halved until it fits in one tile */
+	src = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 600, 300);
+	for (gint y = 0; y < 300; y++) {
+		guint8 *row = gdk_pixbuf_get_pixels (src) + y * gdk_pixbuf_get_rowstride (src);
+		for (guint i = 0; i < 600 * 3; i++)
+			row[i] = g_random_int_range (0, 256);
+	}
+	pyramid = gcm_pyramid_new (src);
+	g_assert_cmpint (gcm_pyramid_get_n_levels (pyramid), ==, 3);
+	g_assert (gcm_pyramid_get_level (pyramid, 0) == src);
+	level = gcm_pyramid_get_level (pyramid, 2);
+	g_assert_cmpint (gdk_pixbuf_get_width (level), ==, 150);
+	g_assert_cmpint (gdk_pixbuf_get_height (level), ==, 75);
+	g_assert_cmpint (gcm_pyramid_get_level_for_scale (pyramid, 1.0), ==, 0);
+	g_assert_cmpint (gcm_pyramid_get_level_for_scale (pyramid, 0.3), ==, 1);
+	g_assert_cmpint (gcm_pyramid_get_level_for_scale (pyramid, 0.01), ==, 2);
+	g_assert_cmpint (gcm_pyramid_get_level_for_width (pyramid, 2048), ==, 0);
+
+	/* nothing is converted without a transform */
+	ret = gcm_pyramid_convert (pyramid, 0, &area, NULL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (!ret);
+	g_clear_error (&error);
+
+	file = g_file_new_for_path (TESTDATADIR "/ibm-t61.icc");
+	ret = cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	transform = gcm_utils_transform_new (icc, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL,
+					     format, format, FALSE, &error);
+	g_assert_no_error (error);
+	g_assert (transform != NULL);
+	gcm_pyramid_set_transform (pyramid, transform);
+
+	/* only the tile that is shown is converted */
+	g_assert (gcm_pyramid_get_tile (pyramid, 0, 1, 0) == NULL);
+	ret = gcm_pyramid_convert (pyramid, 0, &area, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (gcm_pyramid_get_tile (pyramid, 0, 0, 0) == NULL);
+	g_assert (gcm_pyramid_get_tile (pyramid, 0, 2, 0) == NULL);
+	g_assert (gcm_pyramid_get_tile (pyramid, 1, 0, 0) == NULL);
+	tile = gcm_pyramid_get_tile (pyramid, 0, 1, 0);
+	g_assert (tile != NULL);
+	g_assert_cmpint (gdk_pixbuf_get_width (tile), ==, GCM_PYRAMID_TILE_SIZE);
+	g_assert_cmpint (gdk_pixbuf_get_height (tile), ==, GCM_PYRAMID_TILE_SIZE);
+
+	/* the same as converting the region directly */
+	ref = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+			      GCM_PYRAMID_TILE_SIZE, GCM_PYRAMID_TILE_SIZE);
+	ret = gcm_utils_transform_process (transform,
+					   gdk_pixbuf_get_pixels (src) + GCM_PYRAMID_TILE_SIZE * 3,
+					   gdk_pixbuf_get_rowstride (src),
+					   gdk_pixbuf_get_pixels (ref),
+					   gdk_pixbuf_get_rowstride (ref),
+					   GCM_PYRAMID_TILE_SIZE,
+					   GCM_PYRAMID_TILE_SIZE,
+					   NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (gint y = 0; y < GCM_PYRAMID_TILE_SIZE; y++) {
+		g_assert (memcmp (gdk_pixbuf_get_pixels (tile) + y * gdk_pixbuf_get_rowstride (tile),
+				  gdk_pixbuf_get_pixels (ref) + y * gdk_pixbuf_get_rowstride (ref),
+				  GCM_PYRAMID_TILE_SIZE * 3) == 0);
+	}
+
+	/* edge tiles are cropped to the level */
+	area.x = 0;
+	area.y = 0;
+	area.width = 150;
+	area.height = 75;
+	ret = gcm_pyramid_convert (pyramid, 2, &area, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_clear_object (&tile);
+	tile = gcm_pyramid_get_tile (pyramid, 2, 0, 0);
+	g_assert (tile != NULL);
+	g_assert_cmpint (gdk_pixbuf_get_width (tile), ==, 150);
+	g_assert_cmpint (gdk_pixbuf_get_height (tile), ==, 75);
+
+	/* a new transform drops the converted tiles */
+	gcm_pyramid_set_transform (pyramid, NULL);
+	g_assert (gcm_pyramid_get_tile (pyramid, 0, 1, 0) == NULL);
+	g_assert (gcm_pyramid_get_tile (pyramid, 2, 0, 0) == NULL);
+}
+
+static void
+gcm_test_transform_dither_func (void)
+{
+	const guint width = 64;
+	const guint height = 64;
+	gboolean ret;
+	guint n_floor = 0;
+	guint n_ceil = 0;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree guint16 *src = g_new (guint16, width * height * 3);
+	g_autofree guint8 *dst = g_malloc (width * height * 3);
+	g_autofree gfloat *src_flt = g_new (gfloat, width * height * 3);
+
+	g_assert_cmpint (gcm_utils_get_pixel_format_for_depth (8, FALSE, FALSE), ==, TYPE_RGB_8);
+	g_assert_cmpint (gcm_utils_get_pixel_format_for_depth (16, FALSE, TRUE), ==, TYPE_RGBA_16);
+	g_assert_cmpint (gcm_utils_get_pixel_format_for_depth (32, TRUE, FALSE), ==, TYPE_RGB_FLT);
+	g_assert_cmpint (gcm_utils_get_pixel_format_for_depth (16, TRUE, FALSE), ==, 0);
+	g_assert_cmpint (gcm_utils_get_pixel_format_for_depth (4, FALSE, FALSE), ==, 0);
+
+	/* an 8 bit output cannot be dithered */
+	transform = gcm_utils_transform_new (NULL, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL,
+					     TYPE_RGB_16, TYPE_RGB_8, FALSE, &error);
+	g_assert_no_error (error);
+	ret = gcm_utils_transform_process_dither (transform, (const guint8 *) src, width * 6,
+						  dst, width * 3, width, height, NULL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (!ret);
+	g_clear_error (&error);
+	g_clear_pointer (&transform, gcm_utils_transform_unref);
+
+	/* a flat field between two 8 bit levels averages out */
+	for (guint i = 0; i < width * height * 3; i++)
+		src[i] = 0x8080 - 0x80;
+	transform = gcm_utils_transform_new (NULL, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL,
+					     TYPE_RGB_16, TYPE_RGB_16, FALSE, &error);
+	g_assert_no_error (error);
+	ret = gcm_utils_transform_process_dither (transform, (const guint8 *) src, width * 6,
+						  dst, width * 3, width, height, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (guint i = 0; i < width * height * 3; i++) {
+		if (dst[i] == 127)
+			n_floor++;
+		else if (dst[i] == 128)
+			n_ceil++;
+	}
+	g_assert_cmpint (n_floor + n_ceil, ==, width * height * 3);
+	g_assert_cmpint (n_floor, >, 0);
+	g_assert_cmpint (n_ceil, >, 0);
+	g_clear_pointer (&transform, gcm_utils_transform_unref);
+
+	/* floating point input */
+	for (guint i = 0; i < width * height * 3; i++)
+		src_flt[i] = 0.25f;
+	transform = gcm_utils_transform_new (NULL, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL,
+					     TYPE_RGB_FLT, TYPE_RGB_16, FALSE, &error);
+	g_assert_no_error (error);
+	ret = gcm_utils_transform_process_dither (transform, (const guint8 *) src_flt, width * 12,
+						  dst, width * 3, width, height, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (guint i = 0; i < width * height * 3; i++)
+		g_assert_cmpint (ABS ((gint) dst[i] - 64), <=, 1);
+}
+
+static void
+gcm_test_pixbuf_convert_data_func (void)
+{
+	const guint width = 256;
+	const guint height = 4;
+	const guint stride = width * 6 + 8;
+	gboolean ret;
+	guint8 *pixels;
+	gint rowstride;
+	g_autofree guint8 *src = g_malloc0 (stride * height);
+	g_autofree guint8 *src_swapped = g_malloc0 (stride * height);
+	g_autofree gfloat *src_flt = g_new (gfloat, width * 3);
+	g_autoptr(GdkPixbuf) dest = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* a 16 bit ramp with padding at the end of each row */
+	for (guint y = 0; y < height; y++) {
+		guint16 *row = (guint16 *) (src + y * stride);
+		guint16 *row_swapped = (guint16 *) (src_swapped + y * stride);
+		for (guint x = 0; x < width; x++) {
+			row[x * 3 + 0] = x * 257;
+			row[x * 3 + 1] = (255 - x) * 257;
+			row[x * 3 + 2] = 0x8000;
+			for (guint c = 0; c < 3; c++)
+				row_swapped[x * 3 + c] = GUINT16_SWAP_LE_BE (row[x * 3 + c]);
+		}
+	}
+	dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+	pixels = gdk_pixbuf_get_pixels (dest);
+	rowstride = gdk_pixbuf_get_rowstride (dest);
+	ret = gcm_utils_pixbuf_convert_data (src, stride, TYPE_RGB_16, dest,
+					     NULL, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+					     NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (guint y = 0; y < height; y++) {
+		for (guint x = 0; x < width; x++) {
+			guint8 *p = pixels + y * rowstride + x * 3;
+			g_assert_cmpint (ABS ((gint) p[0] - (gint) x), <=, 1);
+			g_assert_cmpint (ABS ((gint) p[1] - (gint) (255 - x)), <=, 1);
+			g_assert_cmpint (ABS ((gint) p[2] - 128), <=, 1);
+		}
+	}
+
+	/* the other byte order, as found in big endian files */
+	memset (pixels, 0, rowstride * height);
+	ret = gcm_utils_pixbuf_convert_data (src_swapped, stride,
+					     TYPE_RGB_16 | ENDIAN16_SH(1), dest,
+					     NULL, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+					     NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (guint x = 0; x < width; x++)
+		g_assert_cmpint (ABS ((gint) pixels[x * 3] - (gint) x), <=, 1);
+
+	/* floating point */
+	for (guint x = 0; x < width; x++) {
+		src_flt[x * 3 + 0] = x / 255.f;
+		src_flt[x * 3 + 1] = 1.f - x / 255.f;
+		src_flt[x * 3 + 2] = 0.5f;
+	}
+	g_clear_object (&dest);
+	dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, 1);
+	pixels = gdk_pixbuf_get_pixels (dest);
+	ret = gcm_utils_pixbuf_convert_data ((const guint8 *) src_flt, width * 12,
+					     TYPE_RGB_FLT, dest,
+					     NULL, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+					     NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (guint x = 0; x < width; x++)
+		g_assert_cmpint (ABS ((gint) pixels[x * 3] - (gint) x), <=, 1);
+
+	/* a format LCMS cannot be given */
+	ret = gcm_utils_pixbuf_convert_data (src, stride, 0, dest,
+					     NULL, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+					     NULL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (!ret);
+}
+
+static void
+gcm_test_lut_func (void)
+{
+	const guint grids[] = { GCM_LUT_GRID_DEFAULT, GCM_LUT_GRID_FINE };
+	const guint n_pixels = 64 * 1024;
+	gboolean ret;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree guint8 *src = g_malloc (n_pixels * 3);
+	g_autofree guint8 *ref = g_malloc (n_pixels * 3);
+	g_autofree guint8 *dst = g_malloc (n_pixels * 3);
+	g_autofree guint8 *dst_loaded = g_malloc (n_pixels * 3);
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GcmLut) lut = NULL;
+	g_autoptr(GcmLut) lut_loaded = NULL;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+
+	file = g_file_new_for_path (TESTDATADIR "/ibm-t61.icc");
+	ret = cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* random pixels, plus every gray */
+	for (guint i = 0; i < n_pixels * 3; i++)
+		src[i] = g_random_int_range (0, 256);
+	for (guint i = 0; i < 256; i++)
+		memset (src + i * 3, (gint) i, 3);
+	transform = gcm_utils_transform_new (icc, NULL, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL,
+					     TYPE_RGB_8, TYPE_RGB_8, FALSE, &error);
+	g_assert_no_error (error);
+	cmsDoTransform (gcm_utils_transform_get_handle (transform), src, ref, n_pixels);
+
+	/* compare against LCMS at both sizes */
+	for (guint j = 0; j < G_N_ELEMENTS (grids); j++) {
+		guint max = 0;
+		gdouble mean = 0.f;
+
+		g_clear_pointer (&lut, gcm_lut_free);
+		lut = gcm_lut_new (icc, NULL, NULL, CD_RENDERING_INTENT_PERCEPTUAL,
+				   FALSE, grids[j], &error);
+		g_assert_no_error (error);
+		g_assert (lut != NULL);
+		g_assert_cmpint (gcm_lut_get_grid (lut), ==, grids[j]);
+		gcm_lut_process (lut, src, 3, dst, 3, n_pixels);
+		for (guint i = 0; i < n_pixels * 3; i++) {
+			guint diff = (guint) ABS ((gint) dst[i] - (gint) ref[i]);
+			max = MAX (max, diff);
+			mean += diff;
+		}
+		mean /= n_pixels * 3;
+		g_debug ("%u^3 LUT against LCMS: mean %.3f, max %u", grids[j], mean, max);
+		g_assert_cmpint (max, <=, 4);
+		g_assert_cmpfloat (mean, <, 0.5f);
+	}
+
+	/* saved and loaded, somewhere other test runs cannot use */
+	tmpdir = g_dir_make_tmp ("gcm-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmpdir, "test.lut", NULL);
+	ret = gcm_lut_save (lut, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	lut_loaded = gcm_lut_new_from_file (filename, &error);
+	g_assert_no_error (error);
+	g_assert (lut_loaded != NULL);
+	g_assert_cmpint (gcm_lut_get_grid (lut_loaded), ==, GCM_LUT_GRID_FINE);
+	gcm_lut_process (lut_loaded, src, 3, dst_loaded, 3, n_pixels);
+	g_assert (memcmp (dst, dst_loaded, n_pixels * 3) == 0);
+	g_unlink (filename);
+	g_rmdir (tmpdir);
+}
+
+static void
+gcm_test_shaper_func (void)
+{
+	const guint n_pixels = 64 * 1024;
+	gboolean ret;
+	guint max = 0;
+	g_autofree guint8 *src = g_malloc (n_pixels * 3);
+	g_autofree guint8 *ref = g_malloc (n_pixels * 3);
+	g_autofree guint8 *dst = g_malloc (n_pixels * 3);
+	g_autofree guint16 *src16 = g_new (guint16, n_pixels * 3);
+	g_autofree guint16 *ref16 = g_new (guint16, n_pixels * 3);
+	g_autofree guint16 *dst16 = g_new (guint16, n_pixels * 3);
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GcmShaper) shaper = NULL;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+
+	file = g_file_new_for_path (TESTDATADIR "/ibm-t61.icc");
+	ret = cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (guint i = 0; i < n_pixels * 3; i++) {
+		src[i] = g_random_int_range (0, 256);
+		src16[i] = g_random_int_range (0, 65536);
+	}
+
+	/* 8 bit */
+	transform = gcm_utils_transform_new (icc, NULL, NULL,
+					     CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+					     TYPE_RGB_8, TYPE_RGB_8, FALSE, &error);
+	g_assert_no_error (error);
+	cmsDoTransform (gcm_utils_transform_get_handle (transform), src, ref, n_pixels);
+	g_clear_pointer (&transform, gcm_utils_transform_unref);
+	shaper = gcm_shaper_new (icc, NULL, CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+				 FALSE, TYPE_RGB_8, TYPE_RGB_8, &error);
+	g_assert_no_error (error);
+	g_assert (shaper != NULL);
+	gcm_shaper_process (shaper, src, dst, n_pixels);
+	for (guint i = 0; i < n_pixels * 3; i++)
+		max = MAX (max, (guint) ABS ((gint) dst[i] - (gint) ref[i]));
+	g_debug ("8 bit matrix/shaper against LCMS: max %u", max);
+	g_assert_cmpint (max, <=, 2);
+	g_clear_pointer (&shaper, gcm_shaper_free);
+
+	/* 16 bit */
+	max = 0;
+	transform = gcm_utils_transform_new (icc, NULL, NULL,
+					     CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+					     TYPE_RGB_16, TYPE_RGB_16, FALSE, &error);
+	g_assert_no_error (error);
+	cmsDoTransform (gcm_utils_transform_get_handle (transform), src16, ref16, n_pixels);
+	g_clear_pointer (&transform, gcm_utils_transform_unref);
+	shaper = gcm_shaper_new (icc, NULL, CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+				 FALSE, TYPE_RGB_16, TYPE_RGB_16, &error);
+	g_assert_no_error (error);
+	gcm_shaper_process (shaper, (const guint8 *) src16, (guint8 *) dst16, n_pixels);
+	for (guint i = 0; i < n_pixels * 3; i++)
+		max = MAX (max, (guint) ABS ((gint) dst16[i] - (gint) ref16[i]));
+	g_debug ("16 bit matrix/shaper against LCMS: max %u", max);
+	g_assert_cmpint (max, <=, 8);
+	g_clear_pointer (&shaper, gcm_shaper_free);
+
+	/* there are no perceptual tables, so this is relative colorimetric */
+	shaper = gcm_shaper_new (icc, NULL, CD_RENDERING_INTENT_PERCEPTUAL,
+				 FALSE, TYPE_RGB_8, TYPE_RGB_8, &error);
+	g_assert_no_error (error);
+	g_assert (shaper != NULL);
+	g_clear_pointer (&shaper, gcm_shaper_free);
+
+	/* not possible */
+	shaper = gcm_shaper_new (icc, NULL, CD_RENDERING_INTENT_ABSOLUTE_COLORIMETRIC,
+				 FALSE, TYPE_RGB_8, TYPE_RGB_8, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (shaper == NULL);
+	g_clear_error (&error);
+
+	/* the fast path is used when possible, and LCMS otherwise */
+	transform = gcm_utils_transform_new_fast (icc, NULL, NULL,
+						  CD_RENDERING_INTENT_PERCEPTUAL,
+						  TYPE_RGB_16, TYPE_RGB_16, FALSE, &error);
+	g_assert_no_error (error);
+	g_assert (gcm_utils_transform_get_handle (transform) == NULL);
+	g_clear_pointer (&transform, gcm_utils_transform_unref);
+	transform = gcm_utils_transform_new_fast (NULL, icc, NULL,
+						  CD_RENDERING_INTENT_PERCEPTUAL,
+						  TYPE_RGB_16, TYPE_RGB_16, FALSE, &error);
+	g_assert_no_error (error);
+	g_assert (gcm_utils_transform_get_handle (transform) != NULL);
+}
+
+static void
+gcm_test_tiff_func (void)
+{
+	const gchar *fixtures[] = { TESTDATADIR "/test.tif", NULL };
+	gboolean ret;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autoptr(CdIcc) icc = cd_icc_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFile) file_out = NULL;
+	g_autoptr(GcmTiff) tiff = NULL;
+
+	file = g_file_new_for_path (TESTDATADIR "/ibm-t61.icc");
+	ret = cd_icc_load_file (icc, file, CD_ICC_LOAD_FLAGS_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	tmpdir = g_dir_make_tmp ("gcm-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmpdir, "test.tif", NULL);
+	file_out = g_file_new_for_path (filename);
+
+	/* not a TIFF */
+	tiff = gcm_tiff_new_from_file (TESTDATADIR "/ibm-t61.icc", &error);
+	g_assert_error (error, 1, 0);
+	g_assert (tiff == NULL);
+	g_clear_error (&error);
+
+	/* only the thumbnail is uncompressed, the full image is raw CFA */
+	tiff = gcm_tiff_new_from_file (TESTDATADIR "/test.kdc", &error);
+	g_assert_error (error, 1, 0);
+	g_assert (tiff == NULL);
+	g_clear_error (&error);
+
+	for (guint i = 0; fixtures[i] != NULL; i++) {
+		guint width;
+		guint height;
+		guint row_bytes;
+		guint8 *pixels;
+		guint32 format;
+		g_autofree guint8 *ref = NULL;
+		g_autoptr(GBytes) icc_data = NULL;
+		g_autoptr(GcmTiff) tiff_out = NULL;
+		g_autoptr(GcmUtilsTransform) transform = NULL;
+		g_autoptr(GdkPixbuf) preview = NULL;
+
+		tiff = gcm_tiff_new_from_file (fixtures[i], &error);
+		g_assert_no_error (error);
+		g_assert (tiff != NULL);
+		g_assert_cmpint (gcm_tiff_get_bits_per_sample (tiff), ==, 8);
+		g_assert (!gcm_tiff_get_has_alpha (tiff));
+		width = gcm_tiff_get_width (tiff);
+		height = gcm_tiff_get_height (tiff);
+		row_bytes = width * 3;
+
+		/* convert each row directly as a reference */
+		format = gcm_tiff_get_pixel_format (tiff);
+		transform = gcm_utils_transform_new (NULL, NULL, icc,
+						     CD_RENDERING_INTENT_PERCEPTUAL,
+						     format, TYPE_RGB_8, FALSE, &error);
+		g_assert_no_error (error);
+		ref = g_malloc ((gsize) row_bytes * height);
+		for (guint y = 0; y < height; y++) {
+			cmsDoTransform (gcm_utils_transform_get_handle (transform),
+					gcm_tiff_get_row (tiff, y),
+					ref + y * row_bytes, width);
+		}
+
+		/* streamed to a new file */
+		icc_data = cd_icc_save_data (icc, CD_ICC_SAVE_FLAGS_NONE, &error);
+		g_assert_no_error (error);
+		ret = gcm_tiff_convert_file (tiff, transform, file_out, icc_data,
+					     NULL, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		tiff_out = gcm_tiff_new_from_file (filename, &error);
+		g_assert_no_error (error);
+		g_assert (tiff_out != NULL);
+		g_assert_cmpint (gcm_tiff_get_width (tiff_out), ==, width);
+		g_assert_cmpint (gcm_tiff_get_height (tiff_out), ==, height);
+		g_assert (gcm_tiff_get_icc_data (tiff_out) != NULL);
+		for (guint y = 0; y < height; y++) {
+			g_assert_cmpint (memcmp (gcm_tiff_get_row (tiff_out, y),
+						 ref + y * row_bytes, row_bytes), ==, 0);
+		}
+
+		/* downsampled, where each pixel is the mean of a 3x3 block */
+		preview = gcm_tiff_convert_preview (tiff, transform,
+						    (MAX (width, height) + 2) / 3,
+						    NULL, &error);
+		g_assert_no_error (error);
+		g_assert (preview != NULL);
+		g_assert_cmpint (gdk_pixbuf_get_width (preview), ==, (gint) (width + 2) / 3);
+		g_assert_cmpint (gdk_pixbuf_get_height (preview), ==, (gint) (height + 2) / 3);
+		pixels = gdk_pixbuf_get_pixels (preview);
+		for (guint c = 0; c < 3; c++) {
+			guint sum = 0;
+			for (guint y = 0; y < 3; y++) {
+				for (guint x = 0; x < 3; x++)
+					sum += ref[y * row_bytes + x * 3 + c];
+			}
+			g_assert_cmpint (pixels[c], ==, (sum + 4) / 9);
+		}
+		g_clear_pointer (&tiff, gcm_tiff_free);
+	}
+	g_unlink (filename);
+	g_rmdir (tmpdir);
+}
+
 static void
 gcm_test_utils_func (void)
 {
@@ -173,6 +1421,216 @@ gcm_test_utils_func (void)
 			     "<a href=\"http://www.bbc.co.uk\">http://www.bbc.co.uk</a> really");
 }
 
+static void
+gcm_test_named_color_index_func (void)
+{
+	const gchar *names[] = { "Warm Red", "Reflex Blue", "Process Blue",
+				 "Rubine Red", "Green", "Blue 072", NULL };
+	g_autoptr(GArray) results = NULL;
+	g_autoptr(GcmNamedColorIndex) idx = NULL;
+	g_autoptr(GPtrArray) colors = NULL;
+
+	colors = g_ptr_array_new_with_free_func ((GDestroyNotify) cd_color_swatch_free);
+	for (guint i = 0; names[i] != NULL; i++) {
+		CdColorSwatch *nc = cd_color_swatch_new ();
+		cd_color_swatch_set_name (nc, names[i]);
+		g_ptr_array_add (colors, nc);
+	}
+	idx = gcm_named_color_index_new (colors);
+
+	/* empty query does not filter */
+	results = gcm_named_color_index_search (idx, "");
+	g_assert (results == NULL);
+
+	/* short query, case insensitive */
+	results = gcm_named_color_index_search (idx, "r");
+	g_assert_cmpint (results->len, ==, 5);
+	g_clear_pointer (&results, g_array_unref);
+
+	/* refined from the previous results */
+	results = gcm_named_color_index_search (idx, "RED");
+	g_assert_cmpint (results->len, ==, 2);
+	g_assert_cmpint (g_array_index (results, guint32, 0), ==, 0);
+	g_assert_cmpint (g_array_index (results, guint32, 1), ==, 3);
+	g_clear_pointer (&results, g_array_unref);
+
+	/* trigram lookup */
+	results = gcm_named_color_index_search (idx, "blue");
+	g_assert_cmpint (results->len, ==, 3);
+	g_clear_pointer (&results, g_array_unref);
+	results = gcm_named_color_index_search (idx, "blue 0");
+	g_assert_cmpint (results->len, ==, 1);
+	g_assert_cmpint (g_array_index (results, guint32, 0), ==, 5);
+	g_clear_pointer (&results, g_array_unref);
+
+	/* no trigram match */
+	results = gcm_named_color_index_search (idx, "purple");
+	g_assert_cmpint (results->len, ==, 0);
+}
+
+static void
+gcm_test_named_color_search_func (void)
+{
+	CdColorLab lab;
+	GcmNamedColorMatch *match;
+	g_autoptr(GArray) matches = NULL;
+	g_autoptr(GcmNamedColorSearch) search = NULL;
+	g_autoptr(GPtrArray) colors = NULL;
+
+	/* a regular grid of swatches */
+	colors = g_ptr_array_new_with_free_func ((GDestroyNotify) cd_color_swatch_free);
+	for (guint l = 0; l <= 100; l += 10) {
+		for (gint a = -100; a <= 100; a += 20) {
+			for (gint b = -100; b <= 100; b += 20) {
+				CdColorSwatch *nc = cd_color_swatch_new ();
+				g_autofree gchar *name = g_strdup_printf ("%u,%i,%i", l, a, b);
+				cd_color_lab_set (&lab, l, a, b);
+				cd_color_swatch_set_name (nc, name);
+				cd_color_swatch_set_value (nc, &lab);
+				g_ptr_array_add (colors, nc);
+			}
+		}
+	}
+	search = gcm_named_color_search_new (colors);
+
+	/* exact match */
+	cd_color_lab_set (&lab, 50, 20, -40);
+	matches = gcm_named_color_search_find (search, &lab, 5);
+	g_assert_cmpint (matches->len, ==, 5);
+	match = &g_array_index (matches, GcmNamedColorMatch, 0);
+	g_assert_cmpstr (cd_color_swatch_get_name (match->swatch), ==, "50,20,-40");
+	g_assert_cmpfloat (match->delta_e, <, 0.001);
+	g_clear_pointer (&matches, g_array_unref);
+
+	/* same as a brute force search */
+	for (guint i = 0; i < 100; i++) {
+		gdouble best = G_MAXDOUBLE;
+		cd_color_lab_set (&lab,
+				  g_random_double_range (0, 100),
+				  g_random_double_range (-100, 100),
+				  g_random_double_range (-100, 100));
+		for (guint j = 0; j < colors->len; j++) {
+			CdColorSwatch *nc = g_ptr_array_index (colors, j);
+			best = MIN (best, gcm_color_math_delta_e2000 (&lab, cd_color_swatch_get_value (nc)));
+		}
+		matches = gcm_named_color_search_find (search, &lab, 1);
+		match = &g_array_index (matches, GcmNamedColorMatch, 0);
+		g_assert_cmpfloat (fabs (match->delta_e - best), <, 0.001);
+		g_clear_pointer (&matches, g_array_unref);
+	}
+}
+
+static GBytes *
+gcm_test_palette_export (GPtrArray *colors, GcmPaletteFormat format)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GOutputStream) stream = NULL;
+
+	stream = g_memory_output_stream_new_resizable ();
+	ret = gcm_palette_export (colors, "Salt & Pepper", format,
+				  stream, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = g_output_stream_close (stream, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (stream));
+}
+
+static guint32
+gcm_test_palette_read_uint32 (const guint8 *data)
+{
+	return ((guint32) data[0] << 24) | ((guint32) data[1] << 16) |
+	       ((guint32) data[2] << 8) | data[3];
+}
+
+static void
+gcm_test_palette_func (void)
+{
+	CdColorLab lab;
+	CdColorSwatch *nc;
+	const gchar *str;
+	const guint8 *data;
+	gboolean ret;
+	gsize len;
+	gsize offset;
+	guint blocks = 0;
+	g_autofree gchar *gpl = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GMarkupParseContext) ctx = NULL;
+	g_autoptr(GPtrArray) colors = NULL;
+	GMarkupParser parser = { NULL };
+
+	g_assert_cmpint (gcm_palette_format_from_filename ("test.GPL"), ==, GCM_PALETTE_FORMAT_GPL);
+	g_assert_cmpint (gcm_palette_format_from_filename ("test.ase"), ==, GCM_PALETTE_FORMAT_ASE);
+	g_assert_cmpint (gcm_palette_format_from_filename ("test.cxf"), ==, GCM_PALETTE_FORMAT_CXF);
+	g_assert_cmpint (gcm_palette_format_from_filename ("test.txt"), ==, GCM_PALETTE_FORMAT_UNKNOWN);
+
+	/* black is black whatever the white point */
+	colors = g_ptr_array_new_with_free_func ((GDestroyNotify) cd_color_swatch_free);
+	nc = cd_color_swatch_new ();
+	cd_color_lab_set (&lab, 0, 0, 0);
+	cd_color_swatch_set_name (nc, "Black");
+	cd_color_swatch_set_value (nc, &lab);
+	g_ptr_array_add (colors, nc);
+	nc = cd_color_swatch_new ();
+	cd_color_lab_set (&lab, 50, 20, -40);
+	cd_color_swatch_set_name (nc, "<Blue>");
+	cd_color_swatch_set_value (nc, &lab);
+	g_ptr_array_add (colors, nc);
+
+	/* GIMP */
+	blob = gcm_test_palette_export (colors, GCM_PALETTE_FORMAT_GPL);
+	str = g_bytes_get_data (blob, &len);
+	gpl = g_strndup (str, len);
+	g_assert (g_str_has_prefix (gpl, "GIMP Palette\n"
+					 "Name: Salt & Pepper\n"
+					 "Columns: 0\n"
+					 "#\n"
+					 "  0   0   0\tBlack\n"));
+	g_assert (g_str_has_suffix (gpl, "\t<Blue>\n"));
+	g_clear_pointer (&blob, g_bytes_unref);
+
+	/* Adobe swatch exchange, walking each block */
+	blob = gcm_test_palette_export (colors, GCM_PALETTE_FORMAT_ASE);
+	data = g_bytes_get_data (blob, &len);
+	g_assert_cmpint (len, >, 12);
+	g_assert (memcmp (data, "ASEF\0\1\0\0", 8) == 0);
+	g_assert_cmpint (gcm_test_palette_read_uint32 (data + 8), ==, 2);
+	for (offset = 12; offset + 6 <= len; blocks++) {
+		g_assert_cmpint (data[offset], ==, 0x00);
+		g_assert_cmpint (data[offset + 1], ==, 0x01);
+		offset += 6 + gcm_test_palette_read_uint32 (data + offset + 2);
+	}
+	g_assert_cmpint (offset, ==, len);
+	g_assert_cmpint (blocks, ==, 2);
+
+	/* the first name is "Black" in UTF-16BE, then the Lab model */
+	g_assert_cmpint (data[18], ==, 0x00);
+	g_assert_cmpint (data[19], ==, 6);
+	g_assert (memcmp (data + 20, "\0B\0l\0a\0c\0k\0\0", 12) == 0);
+	g_assert (memcmp (data + 32, "LAB ", 4) == 0);
+	g_clear_pointer (&blob, g_bytes_unref);
+
+	/* CxF, which has to be well formed with the names escaped */
+	blob = gcm_test_palette_export (colors, GCM_PALETTE_FORMAT_CXF);
+	str = g_bytes_get_data (blob, &len);
+	ctx = g_markup_parse_context_new (&parser, 0, NULL, NULL);
+	ret = g_markup_parse_context_parse (ctx, str, len, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = g_markup_parse_context_end_parse (ctx, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (g_strstr_len (str, len, "Name=\"&lt;Blue&gt;\"") != NULL);
+	g_assert (g_strstr_len (str, len, "<cc:L>50.0000</cc:L>") != NULL);
+	g_assert (g_strstr_len (str, len, "<cc:B>-40.0000</cc:B>") != NULL);
+	g_assert (g_strstr_len (str, len, "<cc:Y>0.0000</cc:Y>") != NULL);
+	g_assert (g_strstr_len (str, len, "<cc:Description>Salt &amp; Pepper</cc:Description>") != NULL);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -183,6 +1641,26 @@ main (int argc, char **argv)
 	gcm_debug_setup (g_getenv ("VERBOSE") != NULL);
 
 	g_test_add_func ("/color/utils", gcm_test_utils_func);
+	g_test_add_func ("/color/delta-e", gcm_test_delta_e_func);
+	g_test_add_func ("/color/color-math", gcm_test_color_math_func);
+	g_test_add_func ("/color/lcms-context", gcm_test_lcms_context_func);
+	g_test_add_func ("/color/lcms-threads", gcm_test_lcms_threads_func);
+	g_test_add_func ("/color/transform-cache", gcm_test_transform_cache_func);
+	g_test_add_func ("/color/transform-process", gcm_test_transform_process_func);
+	g_test_add_func ("/color/transform-dither", gcm_test_transform_dither_func);
+	g_test_add_func ("/color/pixbuf-convert", gcm_test_pixbuf_convert_func);
+	g_test_add_func ("/color/pixbuf-convert-data", gcm_test_pixbuf_convert_data_func);
+	g_test_add_func ("/color/pixbuf-proof", gcm_test_pixbuf_proof_func);
+	g_test_add_func ("/color/pixbuf-delta-e", gcm_test_pixbuf_delta_e_func);
+	g_test_add_func ("/color/pixbuf-convert-grid", gcm_test_pixbuf_convert_grid_func);
+	g_test_add_func ("/color/pixbuf-ramps", gcm_test_pixbuf_ramps_func);
+	g_test_add_func ("/color/pyramid", gcm_test_pyramid_func);
+	g_test_add_func ("/color/lut", gcm_test_lut_func);
+	g_test_add_func ("/color/shaper", gcm_test_shaper_func);
+	g_test_add_func ("/color/tiff", gcm_test_tiff_func);
+	g_test_add_func ("/color/named-color-index", gcm_test_named_color_index_func);
+	g_test_add_func ("/color/named-color-search", gcm_test_named_color_search_func);
+	g_test_add_func ("/color/palette", gcm_test_palette_func);
 	if (g_test_thorough ()) {
 		g_test_add_func ("/color/trc", gcm_test_trc_widget_func);
 		g_test_add_func ("/color/cie", gcm_test_cie_widget_func);
@@ -0,0 +1,340 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <lcms2.h>
+#include <math.h>
+
+#include "gcm-lcms.h"
+#include "gcm-shaper.h"
+
+/*
+ * Most display profiles are just three tone curves and a matrix of the
+ * primaries. Between two of these the conversion is linearize, one
+ * combined 3x3 matrix and re-encode, which is done here with a table for
+ * each curve rather than the general LCMS pipeline. The matrix is applied
+ * to all three channels at once using the GCC vector extensions.
+ *
+ * The output curves are steepest near black, so a table indexed by linear
+ * light would put dozens of 16 bit output levels in the first entry.
+ * Indexing by the square root spends more of the table on the shadows,
+ * which keeps 16 bit output within a few levels of LCMS for gamma up to
+ * about 2.4.
+ */
+
+#ifdef __GNUC__
+#define GCM_SHAPER_HAVE_VECTOR	1
+typedef gfloat GcmShaperVec __attribute__ ((vector_size (16)));
+#endif
+
+#define GCM_SHAPER_ENCODE_SIZE	65536
+
+struct _GcmShaper {
+	gfloat		*linearize[3];	/* indexed by the input value */
+	guint16		*encode[3];	/* indexed by sqrt(linear light) */
+	gfloat		 matrix[3][3];
+	guint		 src_channels;
+	guint		 dst_channels;
+	gboolean	 src_16;
+	gboolean	 dst_16;
+};
+
+static gboolean
+gcm_shaper_format_supported (guint32 format)
+{
+	return format == TYPE_RGB_8 || format == TYPE_RGBA_8 ||
+	       format == TYPE_RGB_16 || format == TYPE_RGBA_16;
+}
+
+/* only the colorants and curves are used if there are no LUTs at all */
+static gboolean
+gcm_shaper_profile_supported (cmsHPROFILE profile)
+{
+	const cmsTagSignature luts[] = { cmsSigAToB0Tag, cmsSigAToB1Tag, cmsSigAToB2Tag,
+					 cmsSigBToA0Tag, cmsSigBToA1Tag, cmsSigBToA2Tag,
+					 cmsSigDToB0Tag, cmsSigBToD0Tag };
+
+	if (cmsGetColorSpace (profile) != cmsSigRgbData)
+		return FALSE;
+	if (!cmsIsMatrixShaper (profile))
+		return FALSE;
+	for (guint i = 0; i < G_N_ELEMENTS (luts); i++) {
+		if (cmsIsTag (profile, luts[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+gcm_shaper_get_primaries (cmsHPROFILE profile, gdouble m[3][3])
+{
+	const cmsTagSignature tags[] = { cmsSigRedColorantTag,
+					 cmsSigGreenColorantTag,
+					 cmsSigBlueColorantTag };
+	for (guint j = 0; j < 3; j++) {
+		cmsCIEXYZ *xyz = cmsReadTag (profile, tags[j]);
+		if (xyz == NULL)
+			return FALSE;
+		m[0][j] = xyz->X;
+		m[1][j] = xyz->Y;
+		m[2][j] = xyz->Z;
+	}
+	return TRUE;
+}
+
+static gboolean
+gcm_shaper_invert (gdouble m[3][3], gdouble inv[3][3])
+{
+	gdouble det;
+
+	inv[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	inv[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+	inv[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	inv[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	inv[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+	inv[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+	inv[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	inv[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+	inv[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+	det = m[0][0] * inv[0][0] + m[0][1] * inv[1][0] + m[0][2] * inv[2][0];
+	if (fabs (det) < 1e-9)
+		return FALSE;
+	for (guint i = 0; i < 3; i++) {
+		for (guint j = 0; j < 3; j++)
+			inv[i][j] /= det;
+	}
+	return TRUE;
+}
+
+static gboolean
+gcm_shaper_setup (GcmShaper *shaper,
+		  cmsHPROFILE profile_in,
+		  cmsHPROFILE profile_out,
+		  GError **error)
+{
+	const cmsTagSignature trcs[] = { cmsSigRedTRCTag,
+					 cmsSigGreenTRCTag,
+					 cmsSigBlueTRCTag };
+	guint n_in = shaper->src_16 ? 65536 : 256;
+	gdouble m_in[3][3];
+	gdouble m_out[3][3];
+	gdouble m_out_inv[3][3];
+
+	if (!gcm_shaper_profile_supported (profile_in) ||
+	    !gcm_shaper_profile_supported (profile_out)) {
+		g_set_error_literal (error, 1, 0, "not a matrix/shaper profile");
+		return FALSE;
+	}
+	if (!gcm_shaper_get_primaries (profile_in, m_in) ||
+	    !gcm_shaper_get_primaries (profile_out, m_out) ||
+	    !gcm_shaper_invert (m_out, m_out_inv)) {
+		g_set_error_literal (error, 1, 0, "invalid primaries");
+		return FALSE;
+	}
+
+	/* device RGB -> PCS XYZ -> device RGB */
+	for (guint i = 0; i < 3; i++) {
+		for (guint j = 0; j < 3; j++) {
+			gdouble tmp = 0.f;
+			for (guint k = 0; k < 3; k++)
+				tmp += m_out_inv[i][k] * m_in[k][j];
+			shaper->matrix[i][j] = (gfloat) tmp;
+		}
+	}
+
+	for (guint c = 0; c < 3; c++) {
+		cmsToneCurve *curve_in = cmsReadTag (profile_in, trcs[c]);
+		cmsToneCurve *curve_out = cmsReadTag (profile_out, trcs[c]);
+		cmsToneCurve *curve_rev;
+
+		if (curve_in == NULL || curve_out == NULL) {
+			g_set_error_literal (error, 1, 0, "missing tone curve");
+			return FALSE;
+		}
+		shaper->linearize[c] = g_new (gfloat, n_in);
+		for (guint i = 0; i < n_in; i++)
+			shaper->linearize[c][i] = cmsEvalToneCurveFloat (curve_in, (gfloat) i / (n_in - 1));
+
+		curve_rev = cmsReverseToneCurve (curve_out);
+		if (curve_rev == NULL) {
+			g_set_error_literal (error, 1, 0, "tone curve cannot be reversed");
+			return FALSE;
+		}
+		shaper->encode[c] = g_new (guint16, GCM_SHAPER_ENCODE_SIZE);
+		for (guint i = 0; i < GCM_SHAPER_ENCODE_SIZE; i++) {
+			gfloat tmp = (gfloat) i / (GCM_SHAPER_ENCODE_SIZE - 1);
+			gfloat value = cmsEvalToneCurveFloat (curve_rev, tmp * tmp);
+			shaper->encode[c][i] = (guint16) (CLAMP (value, 0.f, 1.f) * 65535.f + 0.5f);
+		}
+		cmsFreeToneCurve (curve_rev);
+	}
+	return TRUE;
+}
+
+/**
+ * gcm_shaper_new:
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @output: (nullable): the output profile, or %NULL for sRGB
+ * @format_in: 8 or 16 bit RGB, with or without alpha
+ * @format_out: 8 or 16 bit RGB, with or without alpha
+ *
+ * Creates a matrix/shaper transform, which only works when both profiles
+ * are simple RGB matrix/shaper profiles and no black point compensation
+ * or absolute colorimetric scaling is needed. Callers should use the
+ * general LCMS pipeline if this fails.
+ *
+ * Profiles like this have no tables for the perceptual or saturation
+ * intents, so LCMS uses relative colorimetric for those too, and so does
+ * this.
+ *
+ * Returns: a #GcmShaper, or %NULL
+ **/
+GcmShaper *
+gcm_shaper_new (CdIcc *input,
+		CdIcc *output,
+		CdRenderingIntent intent,
+		gboolean bpc,
+		guint32 format_in,
+		guint32 format_out,
+		GError **error)
+{
+	cmsHPROFILE profile_srgb = NULL;
+	gboolean ret;
+	g_autoptr(GcmShaper) shaper = NULL;
+
+	if (!gcm_shaper_format_supported (format_in) ||
+	    !gcm_shaper_format_supported (format_out)) {
+		g_set_error_literal (error, 1, 0, "format not supported");
+		return NULL;
+	}
+	if (bpc || intent == CD_RENDERING_INTENT_ABSOLUTE_COLORIMETRIC) {
+		g_set_error_literal (error, 1, 0,
+				     "black point compensation and absolute "
+				     "colorimetric are not supported");
+		return NULL;
+	}
+
+	shaper = g_new0 (GcmShaper, 1);
+	shaper->src_channels = T_CHANNELS (format_in) + T_EXTRA (format_in);
+	shaper->dst_channels = T_CHANNELS (format_out) + T_EXTRA (format_out);
+	shaper->src_16 = T_BYTES (format_in) == 2;
+	shaper->dst_16 = T_BYTES (format_out) == 2;
+
+	/* no profile means sRGB */
+	if (input == NULL || output == NULL)
+		profile_srgb = cmsCreate_sRGBProfileTHR (gcm_lcms_get_context ());
+	ret = gcm_shaper_setup (shaper,
+				input != NULL ? cd_icc_get_handle (input) : profile_srgb,
+				output != NULL ? cd_icc_get_handle (output) : profile_srgb,
+				error);
+	if (profile_srgb != NULL)
+		cmsCloseProfile (profile_srgb);
+	if (!ret)
+		return NULL;
+	return g_steal_pointer (&shaper);
+}
+
+void
+gcm_shaper_free (GcmShaper *shaper)
+{
+	if (shaper == NULL)
+		return;
+	for (guint c = 0; c < 3; c++) {
+		g_free (shaper->linearize[c]);
+		g_free (shaper->encode[c]);
+	}
+	g_free (shaper);
+}
+
+static inline guint16
+gcm_shaper_encode (GcmShaper *shaper, guint c, gfloat value)
+{
+	value = CLAMP (value, 0.f, 1.f);
+	return shaper->encode[c][(guint) (sqrtf (value) * (GCM_SHAPER_ENCODE_SIZE - 1) + 0.5f)];
+}
+
+/**
+ * gcm_shaper_process:
+ * @shaper: a #GcmShaper
+ * @src: a row of pixels in the input format
+ * @dst: a row of pixels in the output format, which may be @src if the
+ *  output pixels are not larger than the input pixels
+ * @width: the number of pixels
+ *
+ * Converts a row. Any alpha channel is copied, or set to opaque if the
+ * input has none.
+ **/
+void
+gcm_shaper_process (GcmShaper *shaper,
+		    const guint8 *src,
+		    guint8 *dst,
+		    guint width)
+{
+	const guint16 *src16 = (const guint16 *) (gconstpointer) src;
+	guint16 *dst16 = (guint16 *) (gpointer) dst;
+#ifdef GCM_SHAPER_HAVE_VECTOR
+	GcmShaperVec col[3];
+
+	for (guint j = 0; j < 3; j++) {
+		col[j] = (GcmShaperVec) { shaper->matrix[0][j],
+					  shaper->matrix[1][j],
+					  shaper->matrix[2][j],
+					  0.f };
+	}
+#endif
+
+	for (guint x = 0; x < width; x++) {
+		guint16 rgb[3];
+		guint16 alpha;
+		gfloat lin[3];
+
+		/* linearize */
+		if (shaper->src_16) {
+			for (guint c = 0; c < 3; c++)
+				lin[c] = shaper->linearize[c][src16[c]];
+			alpha = shaper->src_channels == 4 ? src16[3] : 0xffff;
+			src16 += shaper->src_channels;
+		} else {
+			for (guint c = 0; c < 3; c++)
+				lin[c] = shaper->linearize[c][src[c]];
+			alpha = shaper->src_channels == 4 ? src[3] * 257 : 0xffff;
+			src += shaper->src_channels;
+		}
+
+		/* mix the primaries and re-encode */
+#ifdef GCM_SHAPER_HAVE_VECTOR
+		{
+			GcmShaperVec acc = col[0] * lin[0] + col[1] * lin[1] + col[2] * lin[2];
+			for (guint c = 0; c < 3; c++)
+				rgb[c] = gcm_shaper_encode (shaper, c, acc[c]);
+		}
+#else
+		for (guint c = 0; c < 3; c++) {
+			gfloat acc = shaper->matrix[c][0] * lin[0] +
+				     shaper->matrix[c][1] * lin[1] +
+				     shaper->matrix[c][2] * lin[2];
+			rgb[c] = gcm_shaper_encode (shaper, c, acc);
+		}
+#endif
+
+		/* pack */
+		if (shaper->dst_16) {
+			for (guint c = 0; c < 3; c++)
+				dst16[c] = rgb[c];
+			if (shaper->dst_channels == 4)
+				dst16[3] = alpha;
+			dst16 += shaper->dst_channels;
+		} else {
+			for (guint c = 0; c < 3; c++)
+				dst[c] = (guint8) ((rgb[c] * 255 + 32895) >> 16);
+			if (shaper->dst_channels == 4)
+				dst[3] = (guint8) ((alpha * 255 + 32895) >> 16);
+			dst += shaper->dst_channels;
+		}
+	}
+}
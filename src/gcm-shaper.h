@@ -0,0 +1,28 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <colord.h>
+
+typedef struct _GcmShaper		GcmShaper;
+
+GcmShaper	*gcm_shaper_new			(CdIcc			*input,
+						 CdIcc			*output,
+						 CdRenderingIntent	 intent,
+						 gboolean		 bpc,
+						 guint32		 format_in,
+						 guint32		 format_out,
+						 GError			**error);
+void		 gcm_shaper_free		(GcmShaper		*shaper);
+void		 gcm_shaper_process		(GcmShaper		*shaper,
+						 const guint8		*src,
+						 guint8			*dst,
+						 guint			 width);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmShaper, gcm_shaper_free)
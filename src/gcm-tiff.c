@@ -0,0 +1,776 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <lcms2.h>
+
+#include "gcm-tiff.h"
+
+/*
+ * Only uncompressed interleaved RGB is supported, which is what scanners
+ * and print workflows produce for very large images, and what most camera
+ * raw containers use for their embedded previews. Each row can then be
+ * found in the mapped file without decoding anything, so images are
+ * converted a band of rows at a time and nothing larger than a band is
+ * ever allocated. Reduced resolution images are skipped, so a raw file is
+ * refused rather than its thumbnail being converted instead.
+ */
+
+#define GCM_TIFF_BAND_SIZE		(1024 * 1024)	/* bytes */
+#define GCM_TIFF_IFD_MAX		16
+
+#define GCM_TIFF_TAG_NEW_SUBFILE_TYPE	254
+#define GCM_TIFF_TAG_IMAGE_WIDTH	256
+#define GCM_TIFF_TAG_IMAGE_LENGTH	257
+#define GCM_TIFF_TAG_BITS_PER_SAMPLE	258
+#define GCM_TIFF_TAG_COMPRESSION	259
+#define GCM_TIFF_TAG_PHOTOMETRIC	262
+#define GCM_TIFF_TAG_STRIP_OFFSETS	273
+#define GCM_TIFF_TAG_SAMPLES_PER_PIXEL	277
+#define GCM_TIFF_TAG_ROWS_PER_STRIP	278
+#define GCM_TIFF_TAG_STRIP_BYTE_COUNTS	279
+#define GCM_TIFF_TAG_PLANAR_CONFIG	284
+#define GCM_TIFF_TAG_SUB_IFDS		330
+#define GCM_TIFF_TAG_EXTRA_SAMPLES	338
+#define GCM_TIFF_TAG_SAMPLE_FORMAT	339
+#define GCM_TIFF_TAG_ICC_PROFILE	34675
+
+#define GCM_TIFF_TYPE_BYTE		1
+#define GCM_TIFF_TYPE_SHORT		3
+#define GCM_TIFF_TYPE_LONG		4
+#define GCM_TIFF_TYPE_UNDEFINED		7
+
+struct _GcmTiff {
+	GMappedFile	*mapped;
+	const guint8	*data;
+	gsize		 len;
+	gboolean	 big_endian;
+	guint		 width;
+	guint		 height;
+	guint		 bits_per_sample;
+	guint		 samples_per_pixel;
+	guint		 rows_per_strip;
+	gsize		 row_bytes;
+	GArray		*strip_offsets;	/* of gsize */
+	GBytes		*icc;
+};
+
+static guint16
+gcm_tiff_read_uint16 (GcmTiff *tiff, gsize offset)
+{
+	guint16 tmp;
+	memcpy (&tmp, tiff->data + offset, sizeof (tmp));
+	return tiff->big_endian ? GUINT16_FROM_BE (tmp) : GUINT16_FROM_LE (tmp);
+}
+
+static guint32
+gcm_tiff_read_uint32 (GcmTiff *tiff, gsize offset)
+{
+	guint32 tmp;
+	memcpy (&tmp, tiff->data + offset, sizeof (tmp));
+	return tiff->big_endian ? GUINT32_FROM_BE (tmp) : GUINT32_FROM_LE (tmp);
+}
+
+/* gets the offset of the values of an IFD entry, which are stored in the
+ * entry itself when they fit */
+static gboolean
+gcm_tiff_get_entry_data (GcmTiff *tiff,
+			 gsize entry,
+			 gsize *offset,
+			 guint32 *count,
+			 guint16 *type,
+			 GError **error)
+{
+	gsize size;
+
+	*type = gcm_tiff_read_uint16 (tiff, entry + 2);
+	*count = gcm_tiff_read_uint32 (tiff, entry + 4);
+	switch (*type) {
+	case GCM_TIFF_TYPE_BYTE:
+	case GCM_TIFF_TYPE_UNDEFINED:
+		size = 1;
+		break;
+	case GCM_TIFF_TYPE_SHORT:
+		size = 2;
+		break;
+	case GCM_TIFF_TYPE_LONG:
+		size = 4;
+		break;
+	default:
+		g_set_error (error, 1, 0, "tag %u has unsupported type %u",
+			     gcm_tiff_read_uint16 (tiff, entry), *type);
+		return FALSE;
+	}
+	if (*count > tiff->len / size) {
+		g_set_error_literal (error, 1, 0, "tag data outside file");
+		return FALSE;
+	}
+	size *= *count;
+	if (size <= 4) {
+		*offset = entry + 8;
+		return TRUE;
+	}
+	*offset = gcm_tiff_read_uint32 (tiff, entry + 8);
+	if (*offset > tiff->len || size > tiff->len - *offset) {
+		g_set_error_literal (error, 1, 0, "tag data outside file");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static guint32
+gcm_tiff_get_entry_value (GcmTiff *tiff, gsize offset, guint16 type, guint idx)
+{
+	if (type == GCM_TIFF_TYPE_SHORT)
+		return gcm_tiff_read_uint16 (tiff, offset + idx * 2);
+	if (type == GCM_TIFF_TYPE_LONG)
+		return gcm_tiff_read_uint32 (tiff, offset + idx * 4);
+	return tiff->data[offset + idx];
+}
+
+static gboolean
+gcm_tiff_check_ifd (GcmTiff *tiff, gsize ifd, GError **error)
+{
+	if (ifd > tiff->len - 2) {
+		g_set_error_literal (error, 1, 0, "image directory outside file");
+		return FALSE;
+	}
+	if ((gsize) gcm_tiff_read_uint16 (tiff, ifd) * 12 + 4 > tiff->len - ifd - 2) {
+		g_set_error_literal (error, 1, 0, "image directory truncated");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* gets a value of a tag in a directory that has been checked */
+static guint32
+gcm_tiff_get_ifd_value (GcmTiff *tiff, gsize ifd, guint16 tag, guint idx, guint32 value)
+{
+	guint16 n_entries = gcm_tiff_read_uint16 (tiff, ifd);
+	for (guint i = 0; i < n_entries; i++) {
+		gsize entry = ifd + 2 + i * 12;
+		gsize offset;
+		guint16 type;
+		guint32 count;
+
+		if (gcm_tiff_read_uint16 (tiff, entry) != tag)
+			continue;
+		if (!gcm_tiff_get_entry_data (tiff, entry, &offset, &count, &type, NULL))
+			return value;
+		if (idx >= count)
+			return value;
+		return gcm_tiff_get_entry_value (tiff, offset, type, idx);
+	}
+	return value;
+}
+
+/* the first full resolution image, which in camera raw files is often in
+ * a SubIFD of the thumbnail */
+static gboolean
+gcm_tiff_find_image (GcmTiff *tiff, gsize *ifd_image, GError **error)
+{
+	gsize ifd = gcm_tiff_read_uint32 (tiff, 4);
+
+	for (guint n = 0; ifd != 0 && n < GCM_TIFF_IFD_MAX; n++) {
+		if (!gcm_tiff_check_ifd (tiff, ifd, error))
+			return FALSE;
+		if ((gcm_tiff_get_ifd_value (tiff, ifd, GCM_TIFF_TAG_NEW_SUBFILE_TYPE, 0, 0) & 1) == 0) {
+			*ifd_image = ifd;
+			return TRUE;
+		}
+		for (guint i = 0; i < GCM_TIFF_IFD_MAX; i++) {
+			gsize sub = gcm_tiff_get_ifd_value (tiff, ifd, GCM_TIFF_TAG_SUB_IFDS, i, 0);
+			if (sub == 0)
+				break;
+			if (!gcm_tiff_check_ifd (tiff, sub, error))
+				return FALSE;
+			if ((gcm_tiff_get_ifd_value (tiff, sub, GCM_TIFF_TAG_NEW_SUBFILE_TYPE, 0, 0) & 1) == 0) {
+				*ifd_image = sub;
+				return TRUE;
+			}
+		}
+		ifd = gcm_tiff_read_uint32 (tiff, ifd + 2 + gcm_tiff_read_uint16 (tiff, ifd) * 12);
+	}
+	g_set_error_literal (error, 1, 0, "only reduced resolution images found");
+	return FALSE;
+}
+
+static gboolean
+gcm_tiff_parse (GcmTiff *tiff, GError **error)
+{
+	gsize ifd = 0;
+	guint16 n_entries;
+	guint compression = 1;
+	guint photometric = G_MAXUINT;
+	guint planar_config = 1;
+	guint sample_format = 1;
+	gsize strip_offsets = 0;
+	guint32 n_strips = 0;
+	guint16 strip_offsets_type = 0;
+	guint n_strips_expected;
+
+	/* header */
+	if (tiff->len < 8) {
+		g_set_error_literal (error, 1, 0, "not a TIFF file");
+		return FALSE;
+	}
+	if (memcmp (tiff->data, "II", 2) == 0) {
+		tiff->big_endian = FALSE;
+	} else if (memcmp (tiff->data, "MM", 2) == 0) {
+		tiff->big_endian = TRUE;
+	} else {
+		g_set_error_literal (error, 1, 0, "not a TIFF file");
+		return FALSE;
+	}
+	if (gcm_tiff_read_uint16 (tiff, 2) != 42) {
+		g_set_error_literal (error, 1, 0, "not a classic TIFF file");
+		return FALSE;
+	}
+
+	/* only the first full resolution image is used */
+	if (!gcm_tiff_find_image (tiff, &ifd, error))
+		return FALSE;
+	n_entries = gcm_tiff_read_uint16 (tiff, ifd);
+	for (guint i = 0; i < n_entries; i++) {
+		gsize entry = ifd + 2 + i * 12;
+		gsize offset;
+		guint16 tag = gcm_tiff_read_uint16 (tiff, entry);
+		guint16 type;
+		guint32 count;
+
+		if (!gcm_tiff_get_entry_data (tiff, entry, &offset, &count, &type, NULL))
+			continue;
+		if (count == 0)
+			continue;
+		switch (tag) {
+		case GCM_TIFF_TAG_IMAGE_WIDTH:
+			tiff->width = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			break;
+		case GCM_TIFF_TAG_IMAGE_LENGTH:
+			tiff->height = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			break;
+		case GCM_TIFF_TAG_BITS_PER_SAMPLE:
+			tiff->bits_per_sample = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			for (guint j = 1; j < count; j++) {
+				if (gcm_tiff_get_entry_value (tiff, offset, type, j) != tiff->bits_per_sample) {
+					g_set_error_literal (error, 1, 0, "mixed sample depths not supported");
+					return FALSE;
+				}
+			}
+			break;
+		case GCM_TIFF_TAG_COMPRESSION:
+			compression = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			break;
+		case GCM_TIFF_TAG_PHOTOMETRIC:
+			photometric = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			break;
+		case GCM_TIFF_TAG_STRIP_OFFSETS:
+			strip_offsets = offset;
+			strip_offsets_type = type;
+			n_strips = count;
+			break;
+		case GCM_TIFF_TAG_SAMPLES_PER_PIXEL:
+			tiff->samples_per_pixel = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			break;
+		case GCM_TIFF_TAG_ROWS_PER_STRIP:
+			tiff->rows_per_strip = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			break;
+		case GCM_TIFF_TAG_PLANAR_CONFIG:
+			planar_config = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			break;
+		case GCM_TIFF_TAG_SAMPLE_FORMAT:
+			sample_format = gcm_tiff_get_entry_value (tiff, offset, type, 0);
+			break;
+		case GCM_TIFF_TAG_ICC_PROFILE:
+			if (type == GCM_TIFF_TYPE_UNDEFINED) {
+				g_autoptr(GBytes) bytes = g_mapped_file_get_bytes (tiff->mapped);
+				tiff->icc = g_bytes_new_from_bytes (bytes, offset, count);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* the pixels have to be usable as they are stored */
+	if (compression != 1) {
+		g_set_error (error, 1, 0, "compression %u not supported", compression);
+		return FALSE;
+	}
+	if (photometric != 2 || planar_config != 1) {
+		g_set_error_literal (error, 1, 0, "only interleaved RGB is supported");
+		return FALSE;
+	}
+	if (tiff->samples_per_pixel != 3 && tiff->samples_per_pixel != 4) {
+		g_set_error (error, 1, 0, "%u samples per pixel not supported",
+			     tiff->samples_per_pixel);
+		return FALSE;
+	}
+	if (sample_format != 1 ||
+	    (tiff->bits_per_sample != 8 && tiff->bits_per_sample != 16)) {
+		g_set_error (error, 1, 0, "%u bits per sample not supported",
+			     tiff->bits_per_sample);
+		return FALSE;
+	}
+	if (tiff->width == 0 || tiff->height == 0 ||
+	    tiff->width > G_MAXSIZE / 8 / tiff->samples_per_pixel) {
+		g_set_error_literal (error, 1, 0, "image size invalid");
+		return FALSE;
+	}
+	tiff->row_bytes = (gsize) tiff->width * tiff->samples_per_pixel * tiff->bits_per_sample / 8;
+
+	/* every row of every strip has to be inside the file */
+	if (tiff->rows_per_strip == 0 || tiff->rows_per_strip > tiff->height)
+		tiff->rows_per_strip = tiff->height;
+	n_strips_expected = (tiff->height + tiff->rows_per_strip - 1) / tiff->rows_per_strip;
+	if (n_strips != n_strips_expected) {
+		g_set_error (error, 1, 0, "expected %u strips, got %u",
+			     n_strips_expected, n_strips);
+		return FALSE;
+	}
+	for (guint i = 0; i < n_strips; i++) {
+		gsize offset = gcm_tiff_get_entry_value (tiff, strip_offsets,
+							 strip_offsets_type, i);
+		guint rows = MIN (tiff->rows_per_strip, tiff->height - i * tiff->rows_per_strip);
+		if (offset > tiff->len || tiff->row_bytes > (tiff->len - offset) / rows) {
+			g_set_error (error, 1, 0, "strip %u outside file", i);
+			return FALSE;
+		}
+		g_array_append_val (tiff->strip_offsets, offset);
+	}
+	return TRUE;
+}
+
+/**
+ * gcm_tiff_new_from_file:
+ * @filename: a TIFF file, or a raw file that uses a TIFF container
+ *
+ * Maps the file into memory, so that it can be converted without reading
+ * all of the pixels at once.
+ *
+ * Returns: a #GcmTiff, or %NULL if the pixels are not stored uncompressed
+ **/
+GcmTiff *
+gcm_tiff_new_from_file (const gchar *filename, GError **error)
+{
+	g_autoptr(GcmTiff) tiff = g_new0 (GcmTiff, 1);
+
+	tiff->strip_offsets = g_array_new (FALSE, FALSE, sizeof (gsize));
+	tiff->mapped = g_mapped_file_new (filename, FALSE, error);
+	if (tiff->mapped == NULL)
+		return NULL;
+	tiff->data = (const guint8 *) g_mapped_file_get_contents (tiff->mapped);
+	tiff->len = g_mapped_file_get_length (tiff->mapped);
+	if (!gcm_tiff_parse (tiff, error))
+		return NULL;
+	return g_steal_pointer (&tiff);
+}
+
+void
+gcm_tiff_free (GcmTiff *tiff)
+{
+	if (tiff == NULL)
+		return;
+	if (tiff->icc != NULL)
+		g_bytes_unref (tiff->icc);
+	if (tiff->mapped != NULL)
+		g_mapped_file_unref (tiff->mapped);
+	g_array_unref (tiff->strip_offsets);
+	g_free (tiff);
+}
+
+guint
+gcm_tiff_get_width (GcmTiff *tiff)
+{
+	return tiff->width;
+}
+
+guint
+gcm_tiff_get_height (GcmTiff *tiff)
+{
+	return tiff->height;
+}
+
+guint
+gcm_tiff_get_bits_per_sample (GcmTiff *tiff)
+{
+	return tiff->bits_per_sample;
+}
+
+gboolean
+gcm_tiff_get_has_alpha (GcmTiff *tiff)
+{
+	return tiff->samples_per_pixel == 4;
+}
+
+/**
+ * gcm_tiff_get_pixel_format:
+ * @tiff: a #GcmTiff
+ *
+ * Gets the LCMS format of the rows as they are stored, which includes the
+ * byte order of 16 bit samples.
+ **/
+guint32
+gcm_tiff_get_pixel_format (GcmTiff *tiff)
+{
+	guint32 format = gcm_utils_get_pixel_format_for_depth (tiff->bits_per_sample,
+							       FALSE,
+							       gcm_tiff_get_has_alpha (tiff));
+	gboolean big_endian = G_BYTE_ORDER == G_BIG_ENDIAN;
+	if (tiff->bits_per_sample == 16 && tiff->big_endian != big_endian)
+		format |= ENDIAN16_SH(1);
+	return format;
+}
+
+/**
+ * gcm_tiff_get_icc_data:
+ * @tiff: a #GcmTiff
+ *
+ * Returns: (transfer none) (nullable): the embedded profile
+ **/
+GBytes *
+gcm_tiff_get_icc_data (GcmTiff *tiff)
+{
+	return tiff->icc;
+}
+
+/**
+ * gcm_tiff_get_row:
+ * @tiff: a #GcmTiff
+ * @y: the row number
+ *
+ * Returns: the pixels of the row, in the format from gcm_tiff_get_pixel_format()
+ **/
+const guint8 *
+gcm_tiff_get_row (GcmTiff *tiff, guint y)
+{
+	gsize offset = g_array_index (tiff->strip_offsets, gsize, y / tiff->rows_per_strip);
+	return tiff->data + offset + (gsize) (y % tiff->rows_per_strip) * tiff->row_bytes;
+}
+
+/* converts rows that may span several strips */
+static gboolean
+gcm_tiff_process_rows (GcmTiff *tiff,
+		       GcmUtilsTransform *transform,
+		       guint y,
+		       guint n_rows,
+		       guint8 *dst,
+		       gsize dst_stride,
+		       guint8 *scratch,
+		       GCancellable *cancellable,
+		       GError **error)
+{
+	while (n_rows > 0) {
+		const guint8 *src = gcm_tiff_get_row (tiff, y);
+		guint run = MIN (n_rows, tiff->rows_per_strip - y % tiff->rows_per_strip);
+
+		/* 16 bit samples are not always aligned in the file */
+		if (scratch != NULL && GPOINTER_TO_SIZE (src) % 2 != 0) {
+			memcpy (scratch, src, run * tiff->row_bytes);
+			src = scratch;
+		}
+		if (!gcm_utils_transform_process (transform,
+						  src, tiff->row_bytes,
+						  dst, dst_stride,
+						  tiff->width, run,
+						  cancellable, error))
+			return FALSE;
+		dst += run * dst_stride;
+		y += run;
+		n_rows -= run;
+	}
+	return TRUE;
+}
+
+static guint
+gcm_tiff_get_band_rows (GcmTiff *tiff, gsize row_bytes)
+{
+	return CLAMP (GCM_TIFF_BAND_SIZE / MAX (row_bytes, tiff->row_bytes), 1, tiff->height);
+}
+
+typedef struct {
+	GByteArray	*ifd;
+	GByteArray	*extra;
+	guint32		 extra_offset;
+} GcmTiffWriter;
+
+static void
+gcm_tiff_writer_add (GcmTiffWriter *writer,
+		     guint16 tag,
+		     guint16 type,
+		     guint32 count,
+		     gconstpointer data,
+		     gsize size)
+{
+	const guint8 pad = 0;
+	guint8 entry[12] = { 0 };
+
+	memcpy (entry + 0, &tag, 2);
+	memcpy (entry + 2, &type, 2);
+	memcpy (entry + 4, &count, 4);
+	if (size <= 4) {
+		memcpy (entry + 8, data, size);
+	} else {
+		guint32 offset = writer->extra_offset + writer->extra->len;
+		memcpy (entry + 8, &offset, 4);
+		g_byte_array_append (writer->extra, data, (guint) size);
+		if (size % 2 != 0)
+			g_byte_array_append (writer->extra, &pad, 1);
+	}
+	g_byte_array_append (writer->ifd, entry, sizeof (entry));
+}
+
+/**
+ * gcm_tiff_convert_file:
+ * @tiff: a #GcmTiff
+ * @transform: a transform from gcm_tiff_get_pixel_format() to the same
+ *	depth and channels in the native byte order
+ * @file: the TIFF file to write
+ * @icc: (nullable): the profile to embed
+ *
+ * Converts the image into an uncompressed TIFF file one band at a time.
+ **/
+gboolean
+gcm_tiff_convert_file (GcmTiff *tiff,
+		       GcmUtilsTransform *transform,
+		       GFile *file,
+		       GBytes *icc,
+		       GCancellable *cancellable,
+		       GError **error)
+{
+	GcmTiffWriter writer;
+	gboolean ret = FALSE;
+	guint band_rows = gcm_tiff_get_band_rows (tiff, tiff->row_bytes);
+	guint n_strips = (tiff->height + band_rows - 1) / band_rows;
+	guint n_entries = 10;
+	guint8 header[8];
+	guint16 tmp16;
+	guint32 tmp32;
+	guint32 ifd_offset;
+	gsize data_size = tiff->row_bytes * tiff->height;
+	g_autofree guint8 *band = NULL;
+	g_autofree guint8 *scratch = NULL;
+	g_autofree guint16 *bits = NULL;
+	g_autofree guint32 *strip_offsets = NULL;
+	g_autofree guint32 *strip_byte_counts = NULL;
+	g_autoptr(GByteArray) extra = g_byte_array_new ();
+	g_autoptr(GByteArray) ifd = g_byte_array_new ();
+	g_autoptr(GFileOutputStream) stream = NULL;
+
+	/* the directory goes after the pixels, and has to be below 4GB */
+	if (data_size > G_MAXUINT32 - 8 - 1) {
+		g_set_error_literal (error, 1, 0, "image too large for TIFF");
+		return FALSE;
+	}
+	ifd_offset = (guint32) (8 + data_size + data_size % 2);
+	if (gcm_tiff_get_has_alpha (tiff))
+		n_entries++;
+	if (icc != NULL)
+		n_entries++;
+
+	/* the strips are written in order, so the layout is known up front */
+	bits = g_new (guint16, tiff->samples_per_pixel);
+	for (guint i = 0; i < tiff->samples_per_pixel; i++)
+		bits[i] = (guint16) tiff->bits_per_sample;
+	strip_offsets = g_new (guint32, n_strips);
+	strip_byte_counts = g_new (guint32, n_strips);
+	for (guint i = 0; i < n_strips; i++) {
+		guint rows = MIN (band_rows, tiff->height - i * band_rows);
+		strip_offsets[i] = (guint32) (8 + (gsize) i * band_rows * tiff->row_bytes);
+		strip_byte_counts[i] = (guint32) (rows * tiff->row_bytes);
+	}
+	writer.ifd = ifd;
+	writer.extra = extra;
+	writer.extra_offset = ifd_offset + 2 + n_entries * 12 + 4;
+	tmp32 = tiff->width;
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_IMAGE_WIDTH, GCM_TIFF_TYPE_LONG, 1, &tmp32, 4);
+	tmp32 = tiff->height;
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_IMAGE_LENGTH, GCM_TIFF_TYPE_LONG, 1, &tmp32, 4);
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_BITS_PER_SAMPLE, GCM_TIFF_TYPE_SHORT,
+			     tiff->samples_per_pixel, bits, tiff->samples_per_pixel * 2);
+	tmp16 = 1;
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_COMPRESSION, GCM_TIFF_TYPE_SHORT, 1, &tmp16, 2);
+	tmp16 = 2;
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_PHOTOMETRIC, GCM_TIFF_TYPE_SHORT, 1, &tmp16, 2);
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_STRIP_OFFSETS, GCM_TIFF_TYPE_LONG,
+			     n_strips, strip_offsets, n_strips * 4);
+	tmp16 = (guint16) tiff->samples_per_pixel;
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_SAMPLES_PER_PIXEL, GCM_TIFF_TYPE_SHORT, 1, &tmp16, 2);
+	tmp32 = band_rows;
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_ROWS_PER_STRIP, GCM_TIFF_TYPE_LONG, 1, &tmp32, 4);
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_STRIP_BYTE_COUNTS, GCM_TIFF_TYPE_LONG,
+			     n_strips, strip_byte_counts, n_strips * 4);
+	tmp16 = 1;
+	gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_PLANAR_CONFIG, GCM_TIFF_TYPE_SHORT, 1, &tmp16, 2);
+	if (gcm_tiff_get_has_alpha (tiff)) {
+		tmp16 = 2; /* unassociated */
+		gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_EXTRA_SAMPLES, GCM_TIFF_TYPE_SHORT, 1, &tmp16, 2);
+	}
+	if (icc != NULL) {
+		gcm_tiff_writer_add (&writer, GCM_TIFF_TAG_ICC_PROFILE, GCM_TIFF_TYPE_UNDEFINED,
+				     (guint32) g_bytes_get_size (icc),
+				     g_bytes_get_data (icc, NULL),
+				     g_bytes_get_size (icc));
+	}
+
+	if ((gsize) writer.extra_offset + extra->len > G_MAXUINT32) {
+		g_set_error_literal (error, 1, 0, "image too large for TIFF");
+		return FALSE;
+	}
+
+	/* header, in the native byte order */
+	memcpy (header, G_BYTE_ORDER == G_BIG_ENDIAN ? "MM" : "II", 2);
+	tmp16 = 42;
+	memcpy (header + 2, &tmp16, 2);
+	memcpy (header + 4, &ifd_offset, 4);
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_REPLACE_DESTINATION,
+				 cancellable, error);
+	if (stream == NULL)
+		return FALSE;
+	if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), header, sizeof (header),
+					NULL, cancellable, error))
+		goto out;
+
+	/* pixels */
+	band = g_malloc (band_rows * tiff->row_bytes);
+	if (tiff->bits_per_sample == 16)
+		scratch = g_malloc (band_rows * tiff->row_bytes);
+	for (guint y = 0; y < tiff->height; y += band_rows) {
+		guint rows = MIN (band_rows, tiff->height - y);
+		if (!gcm_tiff_process_rows (tiff, transform, y, rows,
+					    band, tiff->row_bytes, scratch,
+					    cancellable, error))
+			goto out;
+		if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), band,
+						rows * tiff->row_bytes,
+						NULL, cancellable, error))
+			goto out;
+	}
+	if (data_size % 2 != 0) {
+		const guint8 pad = 0;
+		if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), &pad, 1,
+						NULL, cancellable, error))
+			goto out;
+	}
+
+	/* directory */
+	tmp16 = (guint16) n_entries;
+	tmp32 = 0;
+	if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), &tmp16, 2,
+					NULL, cancellable, error))
+		goto out;
+	if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), ifd->data, ifd->len,
+					NULL, cancellable, error))
+		goto out;
+	if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), &tmp32, 4,
+					NULL, cancellable, error))
+		goto out;
+	if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), extra->data, extra->len,
+					NULL, cancellable, error))
+		goto out;
+	if (!g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable, error))
+		goto out;
+
+	/* success */
+	ret = TRUE;
+out:
+	if (!ret) {
+		g_autoptr(GCancellable) cancellable_close = g_cancellable_new ();
+
+		/* closing when cancelled discards the partial file rather
+		 * than replacing the destination with it */
+		g_cancellable_cancel (cancellable_close);
+		g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable_close, NULL);
+	}
+	return ret;
+}
+
+/**
+ * gcm_tiff_convert_preview:
+ * @tiff: a #GcmTiff
+ * @transform: a transform from gcm_tiff_get_pixel_format() to 8 bit RGB,
+ *	or RGBA if the image has alpha
+ * @max_size: the largest width or height of the preview
+ *
+ * Converts the image one band at a time, averaging the converted pixels
+ * into a preview that is a whole number of times smaller.
+ **/
+GdkPixbuf *
+gcm_tiff_convert_preview (GcmTiff *tiff,
+			  GcmUtilsTransform *transform,
+			  guint max_size,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	guint bpp = gcm_tiff_get_has_alpha (tiff) ? 4 : 3;
+	guint scale;
+	guint dest_width;
+	guint dest_height;
+	guint band_rows;
+	guint y_start = 0;
+	guint8 *pixels;
+	gint rowstride;
+	g_autofree guint64 *acc = NULL;
+	g_autofree guint8 *band = NULL;
+	g_autofree guint8 *scratch = NULL;
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
+
+	if (max_size == 0) {
+		g_set_error_literal (error, 1, 0, "preview size invalid");
+		return NULL;
+	}
+	scale = (MAX (tiff->width, tiff->height) + max_size - 1) / max_size;
+	dest_width = (tiff->width + scale - 1) / scale;
+	dest_height = (tiff->height + scale - 1) / scale;
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, bpp == 4, 8,
+				 (gint) dest_width, (gint) dest_height);
+	if (pixbuf == NULL) {
+		g_set_error_literal (error, 1, 0, "failed to allocate preview");
+		return NULL;
+	}
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+	band_rows = gcm_tiff_get_band_rows (tiff, (gsize) tiff->width * bpp);
+	band = g_malloc ((gsize) band_rows * tiff->width * bpp);
+	if (tiff->bits_per_sample == 16)
+		scratch = g_malloc (band_rows * tiff->row_bytes);
+	acc = g_new0 (guint64, (gsize) dest_width * bpp);
+	for (guint y = 0; y < tiff->height; y += band_rows) {
+		guint rows = MIN (band_rows, tiff->height - y);
+		if (!gcm_tiff_process_rows (tiff, transform, y, rows,
+					    band, (gsize) tiff->width * bpp, scratch,
+					    cancellable, error))
+			return NULL;
+		for (guint j = 0; j < rows; j++) {
+			const guint8 *src = band + (gsize) j * tiff->width * bpp;
+			guint y_src = y + j;
+
+			for (guint x = 0; x < tiff->width; x++) {
+				guint64 *tmp = acc + (x / scale) * bpp;
+				for (guint c = 0; c < bpp; c++)
+					tmp[c] += src[x * bpp + c];
+			}
+
+			/* a full row of blocks, or the last partial one */
+			if ((y_src + 1) % scale != 0 && y_src + 1 != tiff->height)
+				continue;
+			for (guint x = 0; x < dest_width; x++) {
+				guint8 *dst = pixels + (gsize) (y_src / scale) * (gsize) rowstride + x * bpp;
+				guint64 n = (guint64) (MIN ((x + 1) * scale, tiff->width) - x * scale) *
+					    (y_src + 1 - y_start);
+				for (guint c = 0; c < bpp; c++)
+					dst[c] = (guint8) ((acc[x * bpp + c] + n / 2) / n);
+			}
+			memset (acc, 0, (gsize) dest_width * bpp * sizeof (guint64));
+			y_start = y_src + 1;
+		}
+	}
+	return g_steal_pointer (&pixbuf);
+}
@@ -0,0 +1,40 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "gcm-utils.h"
+
+typedef struct _GcmTiff			GcmTiff;
+
+GcmTiff		*gcm_tiff_new_from_file		(const gchar		*filename,
+						 GError			**error);
+void		 gcm_tiff_free			(GcmTiff		*tiff);
+guint		 gcm_tiff_get_width		(GcmTiff		*tiff);
+guint		 gcm_tiff_get_height		(GcmTiff		*tiff);
+guint		 gcm_tiff_get_bits_per_sample	(GcmTiff		*tiff);
+gboolean	 gcm_tiff_get_has_alpha		(GcmTiff		*tiff);
+guint32		 gcm_tiff_get_pixel_format	(GcmTiff		*tiff);
+GBytes		*gcm_tiff_get_icc_data		(GcmTiff		*tiff);
+const guint8	*gcm_tiff_get_row		(GcmTiff		*tiff,
+						 guint			 y);
+gboolean	 gcm_tiff_convert_file		(GcmTiff		*tiff,
+						 GcmUtilsTransform	*transform,
+						 GFile			*file,
+						 GBytes			*icc,
+						 GCancellable		*cancellable,
+						 GError			**error);
+GdkPixbuf	*gcm_tiff_convert_preview	(GcmTiff		*tiff,
+						 GcmUtilsTransform	*transform,
+						 guint			 max_size,
+						 GCancellable		*cancellable,
+						 GError			**error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmTiff, gcm_tiff_free)
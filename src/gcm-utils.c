@@ -10,9 +10,15 @@
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
+#include <glib/gstdio.h>
 #include <colord.h>
+#include <lcms2.h>
 #include <math.h>
 
+#include "gcm-color-math.h"
+#include "gcm-lcms.h"
+#include "gcm-lut.h"
+#include "gcm-shaper.h"
 #include "gcm-utils.h"
 
 gchar *
@@ -77,99 +83,2395 @@ cd_colorspace_to_localised_string (CdColorspace colorspace)
 	return NULL;
 }
 
-static CdPixelFormat
+/*
+ * Building and optimizing an lcms transform is far more expensive than
+ * running it over a preview image, so the transforms are kept in a small
+ * process-wide LRU cache keyed by everything that affects the result. The
+ * transforms are created without the single pixel cache so that one can be
+ * shared between callers.
+ */
+
+#define GCM_UTILS_TRANSFORM_CACHE_MAX		16
+#define GCM_UTILS_LUT_CACHE_MAX			32	/* files, about 300kB each */
+
+struct _GcmUtilsTransform {
+	gchar		*key;		/* NULL if not cached */
+	cmsHTRANSFORM	 handle;	/* NULL if a fast path */
+	GcmLut		*lut;
+	GcmShaper	*shaper;
+	guint		 src_bpp;	/* only for the lut and proofing */
+	guint		 dst_bpp;
+	cmsHTRANSFORM	 xyz_src;	/* only for the gamut warning */
+	cmsHTRANSFORM	 xyz_proof;
+	gfloat		 threshold;
+	CdColorRGB8	 warning;
+	gint		 refcount;
+};
+
+/* used when no gamut warning color is given */
+static const CdColorRGB8 gcm_utils_warning_default = { 0x80, 0x80, 0x80 };
+
+static GMutex	 icc_mutex;
+static GMutex	 transform_cache_mutex;
+static GQueue	 transform_cache = G_QUEUE_INIT;	/* most recent first */
+
+/**
+ * gcm_utils_get_pixel_format_for_depth:
+ * @bits_per_sample: 8, 16 or 32
+ * @is_float: if the samples are floating point, which needs 32 bits
+ * @has_alpha: if there is a fourth sample for each pixel
+ *
+ * Gets the LCMS format for interleaved RGB pixels.
+ *
+ * Returns: a LCMS pixel format, or 0 if not supported
+ **/
+guint32
+gcm_utils_get_pixel_format_for_depth (guint bits_per_sample,
+				      gboolean is_float,
+				      gboolean has_alpha)
+{
+	if (is_float) {
+		if (bits_per_sample != 32)
+			return 0;
+		return has_alpha ? TYPE_RGBA_FLT : TYPE_RGB_FLT;
+	}
+	if (bits_per_sample == 8)
+		return has_alpha ? TYPE_RGBA_8 : TYPE_RGB_8;
+	if (bits_per_sample == 16)
+		return has_alpha ? TYPE_RGBA_16 : TYPE_RGB_16;
+	return 0;
+}
+
+static guint32
 gcm_utils_get_pixel_format (GdkPixbuf *pixbuf)
 {
-	guint bits;
-	CdPixelFormat format = CD_PIXEL_FORMAT_UNKNOWN;
+	return gcm_utils_get_pixel_format_for_depth (gdk_pixbuf_get_bits_per_sample (pixbuf),
+						     FALSE,
+						     gdk_pixbuf_get_has_alpha (pixbuf));
+}
+
+static void
+gcm_utils_transform_free (GcmUtilsTransform *transform)
+{
+	if (transform->handle != NULL)
+		cmsDeleteTransform (transform->handle);
+	if (transform->xyz_src != NULL)
+		cmsDeleteTransform (transform->xyz_src);
+	if (transform->xyz_proof != NULL)
+		cmsDeleteTransform (transform->xyz_proof);
+	gcm_lut_free (transform->lut);
+	gcm_shaper_free (transform->shaper);
+	g_free (transform->key);
+	g_free (transform);
+}
 
-	/* no alpha channel */
-	bits = gdk_pixbuf_get_bits_per_sample (pixbuf);
-	if (!gdk_pixbuf_get_has_alpha (pixbuf) && bits == 8) {
-		format = CD_PIXEL_FORMAT_RGB24;
-		goto out;
+GcmUtilsTransform *
+gcm_utils_transform_ref (GcmUtilsTransform *transform)
+{
+	g_atomic_int_inc (&transform->refcount);
+	return transform;
+}
+
+void
+gcm_utils_transform_unref (GcmUtilsTransform *transform)
+{
+	if (!g_atomic_int_dec_and_test (&transform->refcount))
+		return;
+	gcm_utils_transform_free (transform);
+}
+
+/**
+ * gcm_utils_transform_get_handle:
+ *
+ * Returns: the LCMS transform, or %NULL if it uses a fast path
+ **/
+cmsHTRANSFORM
+gcm_utils_transform_get_handle (GcmUtilsTransform *transform)
+{
+	return transform->handle;
+}
+
+static cmsUInt32Number
+gcm_utils_get_lcms_intent (CdRenderingIntent intent)
+{
+	switch (intent) {
+	case CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC:
+		return INTENT_RELATIVE_COLORIMETRIC;
+	case CD_RENDERING_INTENT_SATURATION:
+		return INTENT_SATURATION;
+	case CD_RENDERING_INTENT_ABSOLUTE_COLORIMETRIC:
+		return INTENT_ABSOLUTE_COLORIMETRIC;
+	default:
+		return INTENT_PERCEPTUAL;
 	}
+}
 
-	/* alpha channel */
-	if (bits == 8) {
-		format = CD_PIXEL_FORMAT_RGBA32;
-		goto out;
+/**
+ * gcm_utils_icc_lock:
+ *
+ * Takes the lock for reading any CdIcc handle, see gcm-utils.h.
+ **/
+void
+gcm_utils_icc_lock (void)
+{
+	g_mutex_lock (&icc_mutex);
+}
+
+/**
+ * gcm_utils_icc_unlock:
+ *
+ * Releases the lock taken with gcm_utils_icc_lock().
+ **/
+void
+gcm_utils_icc_unlock (void)
+{
+	g_mutex_unlock (&icc_mutex);
+}
+
+static cmsHTRANSFORM
+gcm_utils_transform_create (CdIcc *input,
+			    CdIcc *abstract,
+			    CdIcc *output,
+			    CdRenderingIntent intent,
+			    guint32 format_in,
+			    guint32 format_out,
+			    gboolean bpc,
+			    GError **error)
+{
+	cmsContext context = gcm_lcms_get_context ();
+	cmsHPROFILE profiles[3];
+	cmsHPROFILE profile_srgb = NULL;
+	cmsHTRANSFORM handle;
+	cmsUInt32Number flags = cmsFLAGS_NOCACHE;
+	guint n = 0;
+
+	/* no profile means sRGB */
+	if (input == NULL || output == NULL)
+		profile_srgb = cmsCreate_sRGBProfileTHR (context);
+	profiles[n++] = input != NULL ? cd_icc_get_handle (input) : profile_srgb;
+	if (abstract != NULL)
+		profiles[n++] = cd_icc_get_handle (abstract);
+	profiles[n++] = output != NULL ? cd_icc_get_handle (output) : profile_srgb;
+
+	if (bpc)
+		flags |= cmsFLAGS_BLACKPOINTCOMPENSATION;
+	gcm_utils_icc_lock ();
+	handle = cmsCreateMultiprofileTransformTHR (context, profiles, n,
+						    format_in, format_out,
+						    gcm_utils_get_lcms_intent (intent),
+						    flags);
+	gcm_utils_icc_unlock ();
+	if (profile_srgb != NULL)
+		cmsCloseProfile (profile_srgb);
+	if (handle == NULL) {
+		gcm_lcms_set_error (error, "failed to create transform");
+		return NULL;
 	}
-out:
-	return format;
+	return handle;
 }
 
-gboolean
-gcm_utils_image_convert (GtkImage *image,
-			 CdIcc *input,
+/* returns NULL if the profiles cannot be compared */
+static gchar *
+gcm_utils_transform_get_key (CdIcc *input,
+			     CdIcc *abstract,
+			     CdIcc *output,
+			     CdRenderingIntent intent,
+			     guint32 format_in,
+			     guint32 format_out,
+			     gboolean bpc)
+{
+	CdIcc *iccs[] = { input, abstract, output };
+	g_autoptr(GString) key = g_string_new (NULL);
+
+	for (guint i = 0; i < G_N_ELEMENTS (iccs); i++) {
+		const gchar *checksum;
+		if (iccs[i] == NULL) {
+			g_string_append (key, "-|");
+			continue;
+		}
+		checksum = cd_icc_get_checksum (iccs[i]);
+		if (checksum == NULL)
+			return NULL;
+		g_string_append_printf (key, "%s|", checksum);
+	}
+	g_string_append_printf (key, "%u|%x|%x|%i",
+				intent, format_in, format_out, bpc);
+	return g_string_free (g_steal_pointer (&key), FALSE);
+}
+
+/* must be called with transform_cache_mutex held */
+static GcmUtilsTransform *
+gcm_utils_transform_cache_find (const gchar *key)
+{
+	for (GList *l = transform_cache.head; l != NULL; l = l->next) {
+		GcmUtilsTransform *transform = l->data;
+		if (g_strcmp0 (transform->key, key) != 0)
+			continue;
+		g_queue_unlink (&transform_cache, l);
+		g_queue_push_head_link (&transform_cache, l);
+		g_atomic_int_inc (&transform->refcount);
+		return transform;
+	}
+	return NULL;
+}
+
+static GcmUtilsTransform *
+gcm_utils_transform_cache_lookup (const gchar *key)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	if (key == NULL)
+		return NULL;
+	locker = g_mutex_locker_new (&transform_cache_mutex);
+	return gcm_utils_transform_cache_find (key);
+}
+
+/* the transform is built without the lock held, so baking a lookup table
+ * can itself get a transform from the cache */
+static GcmUtilsTransform *
+gcm_utils_transform_cache_add (GcmUtilsTransform *transform, const gchar *key)
+{
+	GcmUtilsTransform *existing;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	if (key == NULL)
+		return transform;
+
+	/* another thread built the same transform first, so use that one */
+	locker = g_mutex_locker_new (&transform_cache_mutex);
+	existing = gcm_utils_transform_cache_find (key);
+	if (existing != NULL) {
+		g_clear_pointer (&locker, g_mutex_locker_free);
+		gcm_utils_transform_unref (transform);
+		return existing;
+	}
+
+	/* the cache holds a ref too */
+	transform->key = g_strdup (key);
+	g_atomic_int_inc (&transform->refcount);
+	g_queue_push_head (&transform_cache, transform);
+	if (transform_cache.length > GCM_UTILS_TRANSFORM_CACHE_MAX)
+		gcm_utils_transform_unref (g_queue_pop_tail (&transform_cache));
+	return transform;
+}
+
+/**
+ * gcm_utils_transform_new:
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @abstract: (nullable): an abstract profile, or %NULL
+ * @output: (nullable): the output profile, or %NULL for sRGB
+ *
+ * Gets a transform from the cache, creating it if required. The transform
+ * is shared and may be used from any thread.
+ *
+ * Returns: a transform, free with gcm_utils_transform_unref()
+ **/
+GcmUtilsTransform *
+gcm_utils_transform_new (CdIcc *input,
 			 CdIcc *abstract,
 			 CdIcc *output,
+			 CdRenderingIntent intent,
+			 guint32 format_in,
+			 guint32 format_out,
+			 gboolean bpc,
 			 GError **error)
 {
-	CdPixelFormat pixel_format;
-	g_autoptr(CdTransform) transform = NULL;
-	GdkPixbuf *pixbuf;
-	GdkPixbuf *original_pixbuf;
-	gboolean ret = TRUE;
-	guchar *data;
-	guint bpp;
+	GcmUtilsTransform *transform;
+	g_autofree gchar *key = NULL;
+
+	/* hit */
+	key = gcm_utils_transform_get_key (input, abstract, output, intent,
+					   format_in, format_out, bpc);
+	transform = gcm_utils_transform_cache_lookup (key);
+	if (transform != NULL)
+		return transform;
+
+	/* miss */
+	transform = g_new0 (GcmUtilsTransform, 1);
+	transform->refcount = 1;
+	transform->handle = gcm_utils_transform_create (input, abstract, output,
+							intent, format_in, format_out,
+							bpc, error);
+	if (transform->handle == NULL) {
+		g_free (transform);
+		return NULL;
+	}
+	return gcm_utils_transform_cache_add (transform, key);
+}
+
+typedef struct {
+	gchar		*filename;
+	gint64		 mtime;
+} GcmUtilsLutCacheItem;
+
+static void
+gcm_utils_lut_cache_item_free (GcmUtilsLutCacheItem *item)
+{
+	g_free (item->filename);
+	g_free (item);
+}
+
+static gint
+gcm_utils_lut_cache_item_sort_cb (gconstpointer a, gconstpointer b)
+{
+	const GcmUtilsLutCacheItem *item1 = *((GcmUtilsLutCacheItem **) a);
+	const GcmUtilsLutCacheItem *item2 = *((GcmUtilsLutCacheItem **) b);
+	if (item1->mtime > item2->mtime)
+		return -1;
+	if (item1->mtime < item2->mtime)
+		return 1;
+	return 0;
+}
+
+/* keep only the most recently used files, as each profile, abstract and
+ * intent combination that has ever been previewed gets its own */
+static void
+gcm_utils_lut_cache_prune (const gchar *dirname)
+{
+	const gchar *tmp;
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GPtrArray) items = NULL;
+
+	dir = g_dir_open (dirname, 0, NULL);
+	if (dir == NULL)
+		return;
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) gcm_utils_lut_cache_item_free);
+	while ((tmp = g_dir_read_name (dir)) != NULL) {
+		GcmUtilsLutCacheItem *item;
+		GStatBuf st;
+		g_autofree gchar *filename = NULL;
+
+		if (!g_str_has_suffix (tmp, ".lut"))
+			continue;
+		filename = g_build_filename (dirname, tmp, NULL);
+		if (g_stat (filename, &st) != 0)
+			continue;
+		item = g_new0 (GcmUtilsLutCacheItem, 1);
+		item->filename = g_steal_pointer (&filename);
+		item->mtime = st.st_mtime;
+		g_ptr_array_add (items, item);
+	}
+	if (items->len <= GCM_UTILS_LUT_CACHE_MAX)
+		return;
+	g_ptr_array_sort (items, gcm_utils_lut_cache_item_sort_cb);
+	for (guint i = GCM_UTILS_LUT_CACHE_MAX; i < items->len; i++) {
+		GcmUtilsLutCacheItem *item = g_ptr_array_index (items, i);
+		if (g_unlink (item->filename) != 0)
+			g_debug ("failed to remove %s", item->filename);
+	}
+}
+
+/* baking a large profile takes much longer than loading the result */
+static GcmLut *
+gcm_utils_lut_new (CdIcc *input,
+		   CdIcc *abstract,
+		   CdIcc *output,
+		   CdRenderingIntent intent,
+		   gboolean bpc,
+		   GError **error)
+{
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GcmLut) lut = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	key = gcm_utils_transform_get_key (input, abstract, output, intent, 0, 0, bpc);
+	if (key == NULL) {
+		return gcm_lut_new (input, abstract, output, intent, bpc,
+				    GCM_LUT_GRID_DEFAULT, error);
+	}
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+	basename = g_strdup_printf ("%s-%u.lut", checksum, (guint) GCM_LUT_GRID_DEFAULT);
+	dirname = g_build_filename (g_get_user_cache_dir (), "gnome-color-manager", "lut", NULL);
+	filename = g_build_filename (dirname, basename, NULL);
+	if (g_file_test (filename, G_FILE_TEST_EXISTS)) {
+		lut = gcm_lut_new_from_file (filename, &error_local);
+		if (lut != NULL) {
+			/* so it is the last to be pruned */
+			g_utime (filename, NULL);
+			return g_steal_pointer (&lut);
+		}
+		g_debug ("failed to load %s: %s", filename, error_local->message);
+		g_clear_error (&error_local);
+	}
+
+	/* not fatal, it will just be baked again next time */
+	lut = gcm_lut_new (input, abstract, output, intent, bpc,
+			   GCM_LUT_GRID_DEFAULT, error);
+	if (lut == NULL)
+		return NULL;
+	if (g_mkdir_with_parents (dirname, 0700) != 0 ||
+	    !gcm_lut_save (lut, filename, &error_local)) {
+		g_debug ("failed to save %s: %s", filename,
+			 error_local != NULL ? error_local->message : "no directory");
+	}
+	gcm_utils_lut_cache_prune (dirname);
+	return g_steal_pointer (&lut);
+}
+
+/**
+ * gcm_utils_transform_new_fast:
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @abstract: (nullable): an abstract profile, or %NULL
+ * @output: (nullable): the output profile, or %NULL for sRGB
+ *
+ * Gets a transform for previews that avoids the full LCMS pipeline where
+ * possible. Between two matrix/shaper profiles the curves and primaries
+ * are used directly, for 8 or 16 bit pixels. Otherwise 8 bit images use a
+ * 3D lookup table, with an error of about one level, and the most recently
+ * used tables are also cached on disk. Anything else falls back to
+ * gcm_utils_transform_new().
+ *
+ * Returns: a transform, free with gcm_utils_transform_unref()
+ **/
+GcmUtilsTransform *
+gcm_utils_transform_new_fast (CdIcc *input,
+			      CdIcc *abstract,
+			      CdIcc *output,
+			      CdRenderingIntent intent,
+			      guint32 format_in,
+			      guint32 format_out,
+			      gboolean bpc,
+			      GError **error)
+{
+	GcmUtilsTransform *transform;
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *key_fast = NULL;
+	g_autoptr(GcmShaper) shaper = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* hit */
+	key = gcm_utils_transform_get_key (input, abstract, output, intent,
+					   format_in, format_out, bpc);
+	if (key != NULL)
+		key_fast = g_strdup_printf ("fast|%s", key);
+	transform = gcm_utils_transform_cache_lookup (key_fast);
+	if (transform != NULL)
+		return transform;
+
+	/* exact, and does not need baking */
+	if (abstract == NULL) {
+		gcm_utils_icc_lock ();
+		shaper = gcm_shaper_new (input, output, intent, bpc,
+					 format_in, format_out, &error_local);
+		gcm_utils_icc_unlock ();
+		if (shaper == NULL)
+			g_debug ("no matrix/shaper fast path: %s", error_local->message);
+	}
+	if (shaper != NULL) {
+		transform = g_new0 (GcmUtilsTransform, 1);
+		transform->refcount = 1;
+		transform->shaper = g_steal_pointer (&shaper);
+		return gcm_utils_transform_cache_add (transform, key_fast);
+	}
+
+	/* only 8 bit images can use the table */
+	if ((format_in != TYPE_RGB_8 && format_in != TYPE_RGBA_8) ||
+	    (format_out != TYPE_RGB_8 && format_out != TYPE_RGBA_8)) {
+		return gcm_utils_transform_new (input, abstract, output, intent,
+						format_in, format_out, bpc, error);
+	}
+	transform = g_new0 (GcmUtilsTransform, 1);
+	transform->refcount = 1;
+	transform->src_bpp = format_in == TYPE_RGBA_8 ? 4 : 3;
+	transform->dst_bpp = format_out == TYPE_RGBA_8 ? 4 : 3;
+	transform->lut = gcm_utils_lut_new (input, abstract, output,
+					    intent, bpc, error);
+	if (transform->lut == NULL) {
+		g_free (transform);
+		return NULL;
+	}
+	return gcm_utils_transform_cache_add (transform, key_fast);
+}
+
+/**
+ * gcm_utils_transform_new_proof:
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @proof: the profile of the device to simulate, e.g. a printer
+ * @output: (nullable): the display profile, or %NULL for sRGB
+ * @intent: the rendering intent for @proof
+ * @format_out: 8 bit RGB or RGBA
+ * @threshold: the CIE94 color difference above which a color is out of
+ *	gamut, or 0 to not show a gamut warning
+ * @warning: (nullable): the color for out of gamut pixels, or %NULL for gray
+ *
+ * Gets a transform that shows how an image would look on @proof. Each
+ * pixel is also converted to Lab both directly and through @proof with
+ * relative colorimetric intent, and any pixel where the proofed color
+ * differs from the direct one by more than @threshold is painted with
+ * @warning in the same pass. CIE94 weights chroma differences down for
+ * saturated colors, so a slightly desaturated proof of a vivid color is
+ * not marked as if it were a hue shift.
+ *
+ * Returns: a transform, free with gcm_utils_transform_unref()
+ **/
+GcmUtilsTransform *
+gcm_utils_transform_new_proof (CdIcc *input,
+			       CdIcc *proof,
+			       CdIcc *output,
+			       CdRenderingIntent intent,
+			       guint32 format_in,
+			       guint32 format_out,
+			       gdouble threshold,
+			       const CdColorRGB8 *warning,
+			       GError **error)
+{
+	cmsContext context = gcm_lcms_get_context ();
+	cmsHPROFILE profile_in;
+	cmsHPROFILE profile_out;
+	cmsHPROFILE profile_xyz;
+	cmsHPROFILE profile_srgb = NULL;
+	cmsUInt32Number flags = cmsFLAGS_SOFTPROOFING | cmsFLAGS_NOCACHE;
+	cmsUInt32Number format_xyz = TYPE_XYZ_FLT | PLANAR_SH(1);
+	GcmUtilsTransform *transform;
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *key_proof = NULL;
+
+	if (format_out != TYPE_RGB_8 && format_out != TYPE_RGBA_8) {
+		g_set_error_literal (error, 1, 0, "proof output must be 8 bit");
+		return NULL;
+	}
+	if (warning == NULL)
+		warning = &gcm_utils_warning_default;
+
+	/* hit */
+	key = gcm_utils_transform_get_key (input, proof, output, intent,
+					   format_in, format_out, FALSE);
+	if (key != NULL) {
+		key_proof = g_strdup_printf ("proof|%s|%.2f|%02x%02x%02x",
+					     key, threshold,
+					     warning->R, warning->G, warning->B);
+	}
+	transform = gcm_utils_transform_cache_lookup (key_proof);
+	if (transform != NULL)
+		return transform;
+
+	/* miss */
+	if (input == NULL || output == NULL)
+		profile_srgb = cmsCreate_sRGBProfileTHR (context);
+	profile_in = input != NULL ? cd_icc_get_handle (input) : profile_srgb;
+	profile_out = output != NULL ? cd_icc_get_handle (output) : profile_srgb;
+	transform = g_new0 (GcmUtilsTransform, 1);
+	transform->refcount = 1;
+	transform->src_bpp = T_CHANNELS (format_in) + T_EXTRA (format_in);
+	transform->dst_bpp = format_out == TYPE_RGBA_8 ? 4 : 3;
+	transform->threshold = (gfloat) threshold;
+	transform->warning = *warning;
+	gcm_utils_icc_lock ();
+	transform->handle = cmsCreateProofingTransformTHR (context,
+							   profile_in, format_in,
+							   profile_out, format_out,
+							   cd_icc_get_handle (proof),
+							   gcm_utils_get_lcms_intent (intent),
+							   INTENT_RELATIVE_COLORIMETRIC,
+							   flags);
+	if (transform->handle != NULL && threshold > 0) {
+		profile_xyz = cmsCreateXYZProfileTHR (context);
+		transform->xyz_src = cmsCreateTransformTHR (context,
+							    profile_in, format_in,
+							    profile_xyz, format_xyz,
+							    INTENT_RELATIVE_COLORIMETRIC,
+							    cmsFLAGS_NOCACHE);
+		transform->xyz_proof = cmsCreateProofingTransformTHR (context,
+								      profile_in, format_in,
+								      profile_xyz, format_xyz,
+								      cd_icc_get_handle (proof),
+								      INTENT_RELATIVE_COLORIMETRIC,
+								      INTENT_RELATIVE_COLORIMETRIC,
+								      flags);
+		cmsCloseProfile (profile_xyz);
+	}
+	gcm_utils_icc_unlock ();
+	if (profile_srgb != NULL)
+		cmsCloseProfile (profile_srgb);
+	if (transform->handle == NULL ||
+	    (threshold > 0 && (transform->xyz_src == NULL || transform->xyz_proof == NULL))) {
+		gcm_lcms_set_error (error, "failed to create proofing transform");
+		gcm_utils_transform_free (transform);
+		return NULL;
+	}
+	return gcm_utils_transform_cache_add (transform, key_proof);
+}
+
+/*
+ * Large images are split into tiles of whole rows that fit in the cache,
+ * and the tiles are claimed one at a time from a shared counter by the
+ * calling thread and the workers in a pool. A worker that gets cheap tiles
+ * simply claims more, so uneven tiles balance out without any per-worker
+ * queues. The shared transform is reentrant, see above.
+ */
+
+#define GCM_UTILS_TILE_SIZE			(256 * 1024)	/* bytes */
+
+/*
+ * When dithering, each row is converted to 16 bits per sample and then
+ * reduced to 8 bits using an ordered dither. The threshold only depends on
+ * the pixel position, so tiles can be processed in any order and a static
+ * image does not crawl when it is converted again.
+ */
+
+static const guint8 gcm_utils_bayer8[8][8] = {
+	{  0, 32,  8, 40,  2, 34, 10, 42 },
+	{ 48, 16, 56, 24, 50, 18, 58, 26 },
+	{ 12, 44,  4, 36, 14, 46,  6, 38 },
+	{ 60, 28, 52, 20, 62, 30, 54, 22 },
+	{  3, 35, 11, 43,  1, 33,  9, 41 },
+	{ 51, 19, 59, 27, 49, 17, 57, 25 },
+	{ 15, 47,  7, 39, 13, 45,  5, 37 },
+	{ 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+static void
+gcm_utils_dither_row (const guint16 *src, guint8 *dst,
+		      guint width, guint n_channels, guint n_color, guint y)
+{
+	const guint8 *bayer = gcm_utils_bayer8[y & 7];
+
+	for (guint x = 0; x < width; x++) {
+		/* centre of each of the 64 steps, scaled to 0..65535 */
+		guint32 threshold = ((guint32) bayer[x & 7] * 2 + 1) * 65535 / 128;
+		for (guint c = 0; c < n_color; c++)
+			dst[c] = (guint8) (((guint32) src[c] * 255 + threshold) / 65535);
+
+		/* dithering the alpha just adds noise to the edges */
+		for (guint c = n_color; c < n_channels; c++)
+			dst[c] = (guint8) (((guint32) src[c] * 255 + 32767) / 65535);
+		src += n_channels;
+		dst += n_channels;
+	}
+}
+
+/*
+ * The difference between two images is summarised without keeping every
+ * value: a histogram is enough for the percentiles, and tiles can be
+ * merged into it in any order as they finish.
+ */
+
+#define GCM_UTILS_DELTA_E_BINS			1000
+#define GCM_UTILS_DELTA_E_BIN_WIDTH		0.1f
+/* the heatmap is saturated for anything this different */
+#define GCM_UTILS_DELTA_E_HEATMAP_MAX		10.f
+
+struct _GcmUtilsDeltaE {
+	GMutex		 mutex;
+	guint64		 count;
+	gdouble		 sum;
+	gfloat		 max;
+	guint64		 histogram[GCM_UTILS_DELTA_E_BINS + 1];	/* last is overflow */
+};
+
+/**
+ * gcm_utils_delta_e_new:
+ *
+ * Creates an empty set of color difference statistics.
+ *
+ * Returns: a #GcmUtilsDeltaE, free with gcm_utils_delta_e_free()
+ **/
+GcmUtilsDeltaE *
+gcm_utils_delta_e_new (void)
+{
+	GcmUtilsDeltaE *delta_e = g_new0 (GcmUtilsDeltaE, 1);
+	g_mutex_init (&delta_e->mutex);
+	return delta_e;
+}
 
-	/* get pixbuf */
-	pixbuf = gtk_image_get_pixbuf (image);
-	if (pixbuf == NULL)
+void
+gcm_utils_delta_e_free (GcmUtilsDeltaE *delta_e)
+{
+	g_mutex_clear (&delta_e->mutex);
+	g_free (delta_e);
+}
+
+/**
+ * gcm_utils_delta_e_get_stats:
+ * @delta_e: a #GcmUtilsDeltaE
+ * @mean: (out) (optional): the mean difference
+ * @p95: (out) (optional): the 95th percentile, to within 0.1
+ * @max: (out) (optional): the largest difference
+ *
+ * Gets the statistics of the pixels compared so far. This can be called
+ * while gcm_utils_pixbuf_delta_e() is running in another thread.
+ *
+ * Returns: %FALSE if no pixels have been compared yet
+ **/
+gboolean
+gcm_utils_delta_e_get_stats (GcmUtilsDeltaE *delta_e,
+			     gdouble *mean,
+			     gdouble *p95,
+			     gdouble *max)
+{
+	guint64 rank;
+	guint64 total = 0;
+	guint i;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&delta_e->mutex);
+
+	if (delta_e->count == 0)
 		return FALSE;
+	if (mean != NULL)
+		*mean = delta_e->sum / (gdouble) delta_e->count;
+	if (max != NULL)
+		*max = delta_e->max;
+	if (p95 != NULL) {
+		rank = (delta_e->count * 95 + 99) / 100;
+		for (i = 0; i < GCM_UTILS_DELTA_E_BINS; i++) {
+			total += delta_e->histogram[i];
+			if (total >= rank)
+				break;
+		}
+		*p95 = MIN ((i + 1) * GCM_UTILS_DELTA_E_BIN_WIDTH, delta_e->max);
+	}
+	return TRUE;
+}
 
-	/* work out the pixel format */
-	pixel_format = gcm_utils_get_pixel_format (pixbuf);
-	if (pixel_format == CD_PIXEL_FORMAT_UNKNOWN) {
-		ret = FALSE;
+static void
+gcm_utils_delta_e_add_row (GcmUtilsDeltaE *delta_e, const gfloat *values, guint width)
+{
+	for (guint x = 0; x < width; x++) {
+		guint bin = (guint) (values[x] / GCM_UTILS_DELTA_E_BIN_WIDTH);
+		delta_e->histogram[MIN (bin, GCM_UTILS_DELTA_E_BINS)]++;
+		delta_e->sum += values[x];
+		if (values[x] > delta_e->max)
+			delta_e->max = values[x];
+	}
+	delta_e->count += width;
+}
+
+/* adds a finished tile and clears it for the next one */
+static void
+gcm_utils_delta_e_merge (GcmUtilsDeltaE *delta_e, GcmUtilsDeltaE *tile)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&delta_e->mutex);
+	for (guint i = 0; i <= GCM_UTILS_DELTA_E_BINS; i++) {
+		delta_e->histogram[i] += tile->histogram[i];
+		tile->histogram[i] = 0;
+	}
+	delta_e->count += tile->count;
+	delta_e->sum += tile->sum;
+	delta_e->max = MAX (delta_e->max, tile->max);
+	tile->count = 0;
+	tile->sum = 0.f;
+	tile->max = 0.f;
+}
+
+/* black for no difference, through red to yellow */
+static void
+gcm_utils_delta_e_heatmap_row (const gfloat *values, guint width, guint8 *dst, guint bpp)
+{
+	for (guint x = 0; x < width; x++) {
+		gfloat t = MIN (values[x] / GCM_UTILS_DELTA_E_HEATMAP_MAX, 1.f) * 2.f;
+		dst[x * bpp + 0] = (guint8) (MIN (t, 1.f) * 255.f + 0.5f);
+		dst[x * bpp + 1] = (guint8) (MAX (t - 1.f, 0.f) * 255.f + 0.5f);
+		dst[x * bpp + 2] = 0;
+	}
+}
+
+typedef struct {
+	GdkPixbuf		*src;		/* shared, never written */
+	GdkPixbuf		*dest;
+	CdIcc			*profiles[3];	/* input, abstract, output */
+	CdRenderingIntent	 intent;
+	gboolean		 bpc;
+	GCancellable		*cancellable;
+	GError			*error;
+} GcmUtilsGridCell;
+
+static void gcm_utils_grid_cell_run (GcmUtilsGridCell *cell);
+
+typedef struct {
+	cmsHTRANSFORM	 handle;
+	GcmLut		*lut;
+	GcmShaper	*shaper;
+	guint		 src_bpp;
+	guint		 dst_bpp;
+	gboolean	 dither;
+	guint		 n_channels;
+	guint		 n_color;
+	cmsHTRANSFORM	 xyz_src;
+	cmsHTRANSFORM	 xyz_proof;
+	gfloat		 threshold;
+	CdColorRGB8	 warning;
+	const GcmUtilsRegion *regions;		/* one tile each, or NULL */
+	GcmUtilsGridCell *cells;		/* one tile each, or NULL */
+	GcmUtilsDeltaE	*delta_e;		/* compare src with cmp instead */
+	const guint8	*cmp;
+	guint		 cmp_stride;
+	const guint8	*src;
+	guint8		*dst;			/* NULL for no heatmap */
+	guint		 src_stride;
+	guint		 dst_stride;
+	guint		 width;
+	guint		 height;
+	guint		 tile_rows;
+	gint		 tiles_total;
+	gint		 tile_next;		/* atomic */
+	gint		 tiles_done;		/* protected by mutex */
+	gint		 refcount;		/* atomic */
+	GCancellable	*cancellable;
+	GMutex		 mutex;
+	GCond		 cond;
+} GcmUtilsConvertJob;
+
+static void
+gcm_utils_convert_job_unref (GcmUtilsConvertJob *job)
+{
+	if (!g_atomic_int_dec_and_test (&job->refcount))
+		return;
+	g_mutex_clear (&job->mutex);
+	g_cond_clear (&job->cond);
+	g_free (job);
+}
+
+static void
+gcm_utils_convert_job_row (GcmUtilsConvertJob *job,
+			   const guint8 *src,
+			   guint8 *dst,
+			   guint width,
+			   guint y,
+			   guint16 *row,
+			   gfloat *lab,
+			   gfloat *values)
+{
+	/* before @src is overwritten by an in place conversion */
+	if (job->xyz_src != NULL) {
+		cmsDoTransform (job->xyz_src, src, lab, width);
+		cmsDoTransform (job->xyz_proof, src, lab + width * 3, width);
+		gcm_color_math_xyz_to_lab_array (lab, NULL, lab, width);
+		gcm_color_math_xyz_to_lab_array (lab + width * 3, NULL, lab + width * 3, width);
+		gcm_color_math_delta_e94_array (lab, lab + width * 3, values, width);
+	}
+
+	if (job->shaper != NULL) {
+		gcm_shaper_process (job->shaper, src, dst, width);
+	} else if (job->lut != NULL) {
+		gcm_lut_process (job->lut, src, job->src_bpp,
+				 dst, job->dst_bpp, width);
+	} else if (!job->dither) {
+		cmsDoTransform (job->handle, src, dst, width);
+	} else {
+		cmsDoTransform (job->handle, src, row, width);
+		gcm_utils_dither_row (row, dst, width,
+				      job->n_channels, job->n_color, y);
+	}
+
+	if (job->xyz_src != NULL) {
+		for (guint x = 0; x < width; x++) {
+			if (values[x] <= job->threshold)
+				continue;
+			dst[x * job->dst_bpp + 0] = job->warning.R;
+			dst[x * job->dst_bpp + 1] = job->warning.G;
+			dst[x * job->dst_bpp + 2] = job->warning.B;
+		}
+	}
+}
+
+/* @handle converts both images to planar XYZ, which is then made Lab in place */
+static void
+gcm_utils_delta_e_job_row (GcmUtilsConvertJob *job,
+			   guint y,
+			   gfloat *lab,
+			   gfloat *values,
+			   GcmUtilsDeltaE *tile)
+{
+	const guint8 *src = job->src + (gsize) y * job->src_stride;
+	const guint8 *cmp = job->cmp + (gsize) y * job->cmp_stride;
+
+	cmsDoTransform (job->handle, src, lab, job->width);
+	cmsDoTransform (job->handle, cmp, lab + job->width * 3, job->width);
+	gcm_color_math_xyz_to_lab_array (lab, NULL, lab, job->width);
+	gcm_color_math_xyz_to_lab_array (lab + job->width * 3, NULL,
+					 lab + job->width * 3, job->width);
+	gcm_color_math_delta_e2000_array (lab, lab + job->width * 3, values, job->width);
+	gcm_utils_delta_e_add_row (tile, values, job->width);
+	if (job->dst != NULL) {
+		gcm_utils_delta_e_heatmap_row (values, job->width,
+					       job->dst + (gsize) y * job->dst_stride,
+					       job->dst_bpp);
+	}
+}
+
+static void
+gcm_utils_convert_job_run (GcmUtilsConvertJob *job)
+{
+	g_autofree guint16 *row = NULL;
+	g_autofree gfloat *lab = NULL;
+	g_autofree gfloat *values = NULL;
+	g_autofree GcmUtilsDeltaE *tile_delta_e = NULL;
+
+	/* one high precision row for each thread */
+	if (job->dither)
+		row = g_new (guint16, (gsize) job->width * job->n_channels);
+
+	/* and two rows of XYZ, made Lab in place, for the gamut warning */
+	if (job->xyz_src != NULL) {
+		lab = g_new (gfloat, (gsize) job->width * 6);
+		values = g_new (gfloat, job->width);
+	}
+
+	/* or for the color difference, which is merged after each tile */
+	if (job->delta_e != NULL) {
+		lab = g_new (gfloat, (gsize) job->width * 6);
+		values = g_new (gfloat, job->width);
+		tile_delta_e = g_new0 (GcmUtilsDeltaE, 1);
+	}
+
+	for (;;) {
+		gint tile = g_atomic_int_add (&job->tile_next, 1);
+		guint y_end;
+
+		if (tile >= job->tiles_total)
+			break;
+
+		/* still claim the tile so the caller is not left waiting */
+		if (job->cells != NULL &&
+		    !g_cancellable_is_cancelled (job->cancellable)) {
+			gcm_utils_grid_cell_run (&job->cells[tile]);
+		} else if (job->regions != NULL &&
+		    !g_cancellable_is_cancelled (job->cancellable)) {
+			const GcmUtilsRegion *region = &job->regions[tile];
+			for (guint y = 0; y < region->height; y++) {
+				gcm_utils_convert_job_row (job,
+							   region->src + (gsize) y * region->src_stride,
+							   region->dst + (gsize) y * region->dst_stride,
+							   region->width, y,
+							   row, lab, values);
+			}
+		} else if (!g_cancellable_is_cancelled (job->cancellable)) {
+			y_end = MIN ((guint) (tile + 1) * job->tile_rows, job->height);
+			for (guint y = (guint) tile * job->tile_rows; y < y_end; y++) {
+				if (job->delta_e != NULL) {
+					gcm_utils_delta_e_job_row (job, y, lab, values,
+								   tile_delta_e);
+					continue;
+				}
+				gcm_utils_convert_job_row (job,
+							   job->src + (gsize) y * job->src_stride,
+							   job->dst + (gsize) y * job->dst_stride,
+							   job->width, y,
+							   row, lab, values);
+			}
+			if (job->delta_e != NULL)
+				gcm_utils_delta_e_merge (job->delta_e, tile_delta_e);
+		}
+
+		g_mutex_lock (&job->mutex);
+		if (++job->tiles_done == job->tiles_total)
+			g_cond_signal (&job->cond);
+		g_mutex_unlock (&job->mutex);
+	}
+}
+
+static void
+gcm_utils_convert_worker_cb (gpointer data, gpointer user_data)
+{
+	GcmUtilsConvertJob *job = (GcmUtilsConvertJob *) data;
+	gcm_utils_convert_job_run (job);
+	gcm_utils_convert_job_unref (job);
+}
+
+static GThreadPool *
+gcm_utils_get_convert_pool (void)
+{
+	static gsize pool_once = 0;
+	static GThreadPool *pool = NULL;
+
+	if (g_once_init_enter (&pool_once)) {
+		guint n_workers = MAX (g_get_num_processors (), 2) - 1;
+		pool = g_thread_pool_new (gcm_utils_convert_worker_cb, NULL,
+					  (gint) n_workers, FALSE, NULL);
+		g_once_init_leave (&pool_once, 1);
+	}
+	return pool;
+}
+
+/* runs the tiles of @job on all the CPU cores and frees it */
+static gboolean
+gcm_utils_convert_job_process (GcmUtilsConvertJob *job,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	GThreadPool *pool;
+	guint n_workers;
+	guint stride = MAX (MAX (job->src_stride, job->dst_stride), job->cmp_stride);
+
+	if (job->regions == NULL && job->cells == NULL) {
+		job->tile_rows = MAX (GCM_UTILS_TILE_SIZE / MAX (stride, 1), 1);
+		job->tiles_total = (gint) ((job->height + job->tile_rows - 1) / job->tile_rows);
+	}
+	job->cancellable = cancellable;
+	job->refcount = 1;
+	g_mutex_init (&job->mutex);
+	g_cond_init (&job->cond);
+
+	/* workers that start after the last tile has gone just drop their ref */
+	pool = gcm_utils_get_convert_pool ();
+	n_workers = MIN ((guint) job->tiles_total, g_get_num_processors ()) - 1;
+	for (guint i = 0; i < n_workers; i++) {
+		g_atomic_int_inc (&job->refcount);
+		if (!g_thread_pool_push (pool, job, NULL))
+			gcm_utils_convert_job_unref (job);
+	}
+
+	/* help out, then wait for the tiles still in progress */
+	gcm_utils_convert_job_run (job);
+	g_mutex_lock (&job->mutex);
+	while (job->tiles_done < job->tiles_total)
+		g_cond_wait (&job->cond, &job->mutex);
+	g_mutex_unlock (&job->mutex);
+	gcm_utils_convert_job_unref (job);
+
+	return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+static GcmUtilsConvertJob *
+gcm_utils_convert_job_new (GcmUtilsTransform *transform)
+{
+	GcmUtilsConvertJob *job = g_new0 (GcmUtilsConvertJob, 1);
+	job->handle = transform->handle;
+	job->lut = transform->lut;
+	job->shaper = transform->shaper;
+	job->src_bpp = transform->src_bpp;
+	job->dst_bpp = transform->dst_bpp;
+	job->xyz_src = transform->xyz_src;
+	job->xyz_proof = transform->xyz_proof;
+	job->threshold = transform->threshold;
+	job->warning = transform->warning;
+	return job;
+}
+
+static gboolean
+gcm_utils_transform_process_internal (GcmUtilsTransform *transform,
+				      const guint8 *src,
+				      guint src_stride,
+				      guint8 *dst,
+				      guint dst_stride,
+				      guint width,
+				      guint height,
+				      gboolean dither,
+				      GCancellable *cancellable,
+				      GError **error)
+{
+	GcmUtilsConvertJob *job;
+
+	if (width == 0 || height == 0)
+		return TRUE;
+
+	job = gcm_utils_convert_job_new (transform);
+	if (dither) {
+		cmsUInt32Number format_out = cmsGetTransformOutputFormat (transform->handle);
+		job->dither = TRUE;
+		job->n_color = T_CHANNELS (format_out);
+		job->n_channels = job->n_color + T_EXTRA (format_out);
+	}
+	job->src = src;
+	job->dst = dst;
+	job->src_stride = src_stride;
+	job->dst_stride = dst_stride;
+	job->width = width;
+	job->height = height;
+	return gcm_utils_convert_job_process (job, cancellable, error);
+}
+
+/**
+ * gcm_utils_transform_process:
+ * @transform: a #GcmUtilsTransform
+ * @src: the source pixels
+ * @src_stride: the source rowstride in bytes
+ * @dst: the destination pixels, which may be the same as @src
+ * @dst_stride: the destination rowstride in bytes
+ * @width: the width in pixels
+ * @height: the height in pixels
+ * @cancellable: (nullable): a #GCancellable
+ *
+ * Converts an image using all the CPU cores. When @src and @dst are the
+ * same the conversion is done in place, which needs the input and output
+ * pixel formats to be the same size.
+ **/
+gboolean
+gcm_utils_transform_process (GcmUtilsTransform *transform,
+			     const guint8 *src,
+			     guint src_stride,
+			     guint8 *dst,
+			     guint dst_stride,
+			     guint width,
+			     guint height,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	g_return_val_if_fail (transform != NULL, FALSE);
+	return gcm_utils_transform_process_internal (transform,
+						     src, src_stride,
+						     dst, dst_stride,
+						     width, height, FALSE,
+						     cancellable, error);
+}
+
+/**
+ * gcm_utils_transform_process_regions:
+ * @transform: a #GcmUtilsTransform
+ * @regions: the parts of images to convert
+ * @n_regions: the number of @regions
+ * @cancellable: (nullable): a #GCancellable
+ *
+ * Converts many small images, such as the visible tiles of a larger one,
+ * using all the CPU cores. Each region is converted by one thread, and
+ * like gcm_utils_transform_process() may be converted in place.
+ **/
+gboolean
+gcm_utils_transform_process_regions (GcmUtilsTransform *transform,
+				     const GcmUtilsRegion *regions,
+				     guint n_regions,
+				     GCancellable *cancellable,
+				     GError **error)
+{
+	GcmUtilsConvertJob *job;
+
+	g_return_val_if_fail (transform != NULL, FALSE);
+
+	if (n_regions == 0)
+		return TRUE;
+	job = gcm_utils_convert_job_new (transform);
+	job->regions = regions;
+	job->tiles_total = (gint) n_regions;
+	for (guint i = 0; i < n_regions; i++)
+		job->width = MAX (job->width, regions[i].width);
+	return gcm_utils_convert_job_process (job, cancellable, error);
+}
+
+/**
+ * gcm_utils_transform_process_dither:
+ * @transform: a #GcmUtilsTransform with a 16 bit output format
+ * @src: the source pixels, in any format
+ * @src_stride: the source rowstride in bytes
+ * @dst: the 8 bit destination pixels
+ * @dst_stride: the destination rowstride in bytes
+ * @width: the width in pixels
+ * @height: the height in pixels
+ * @cancellable: (nullable): a #GCancellable
+ *
+ * Converts a high bit depth image for display. The transform is done at
+ * 16 bits per sample and only the result is reduced to 8 bits, using an
+ * ordered dither so smooth gradients do not band. The destination has
+ * the same number of channels as the transform output.
+ **/
+gboolean
+gcm_utils_transform_process_dither (GcmUtilsTransform *transform,
+				    const guint8 *src,
+				    guint src_stride,
+				    guint8 *dst,
+				    guint dst_stride,
+				    guint width,
+				    guint height,
+				    GCancellable *cancellable,
+				    GError **error)
+{
+	cmsUInt32Number format_out;
+
+	g_return_val_if_fail (transform != NULL, FALSE);
+
+	if (transform->handle == NULL) {
+		g_set_error_literal (error, 1, 0, "transform output is not 16 bit");
+		return FALSE;
+	}
+	format_out = cmsGetTransformOutputFormat (transform->handle);
+	if (T_BYTES (format_out) != 2 || T_FLOAT (format_out)) {
+		g_set_error_literal (error, 1, 0, "transform output is not 16 bit");
+		return FALSE;
+	}
+	return gcm_utils_transform_process_internal (transform,
+						     src, src_stride,
+						     dst, dst_stride,
+						     width, height, TRUE,
+						     cancellable, error);
+}
+
+/* box filters @src into @dest if that is smaller, so only the pixels that
+ * will be shown are transformed; returns the pixbuf to convert from */
+static GdkPixbuf *
+gcm_utils_pixbuf_prepare (GdkPixbuf *src,
+			  GdkPixbuf *dest,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	gint width = gdk_pixbuf_get_width (dest);
+	gint height = gdk_pixbuf_get_height (dest);
+	guint32 format_in = gcm_utils_get_pixel_format (src);
+	guint32 format_out = gcm_utils_get_pixel_format (dest);
+
+	if (format_in == 0 || format_out == 0) {
 		g_set_error_literal (error, 1, 0, "format not supported");
+		return NULL;
+	}
+	if (width > gdk_pixbuf_get_width (src) ||
+	    height > gdk_pixbuf_get_height (src)) {
+		g_set_error_literal (error, 1, 0, "destination is larger than source");
+		return NULL;
+	}
+	if (width == gdk_pixbuf_get_width (src) &&
+	    height == gdk_pixbuf_get_height (src))
+		return src;
+
+	/* downscale into @dest, which is then converted in place */
+	if (format_in != format_out) {
+		g_set_error_literal (error, 1, 0, "cannot scale between formats");
+		return NULL;
+	}
+	gdk_pixbuf_scale (src, dest, 0, 0, width, height, 0.f, 0.f,
+			  (gdouble) width / gdk_pixbuf_get_width (src),
+			  (gdouble) height / gdk_pixbuf_get_height (src),
+			  GDK_INTERP_TILES);
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		return NULL;
+	return dest;
+}
+
+static gboolean
+gcm_utils_pixbuf_convert_internal (GdkPixbuf *src,
+				   GdkPixbuf *dest,
+				   CdIcc *input,
+				   CdIcc *abstract,
+				   CdIcc *output,
+				   CdRenderingIntent intent,
+				   gboolean bpc,
+				   gboolean fast,
+				   GCancellable *cancellable,
+				   GError **error)
+{
+	guint32 format_in;
+	guint32 format_out;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+
+	src = gcm_utils_pixbuf_prepare (src, dest, cancellable, error);
+	if (src == NULL)
+		return FALSE;
+
+	/* only a cache miss has to build the transform */
+	format_in = gcm_utils_get_pixel_format (src);
+	format_out = gcm_utils_get_pixel_format (dest);
+	if (fast) {
+		transform = gcm_utils_transform_new_fast (input, abstract, output, intent,
+							  format_in, format_out, bpc, error);
+	} else {
+		transform = gcm_utils_transform_new (input, abstract, output, intent,
+						     format_in, format_out, bpc, error);
+	}
+	if (transform == NULL)
+		return FALSE;
+	return gcm_utils_transform_process (transform,
+					    gdk_pixbuf_read_pixels (src),
+					    gdk_pixbuf_get_rowstride (src),
+					    gdk_pixbuf_get_pixels (dest),
+					    gdk_pixbuf_get_rowstride (dest),
+					    gdk_pixbuf_get_width (dest),
+					    gdk_pixbuf_get_height (dest),
+					    cancellable, error);
+}
+
+/**
+ * gcm_utils_pixbuf_convert:
+ * @src: the source #GdkPixbuf
+ * @dest: the destination #GdkPixbuf, which may be @src
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @abstract: (nullable): an abstract profile, or %NULL
+ * @output: (nullable): the output profile, or %NULL for sRGB
+ *
+ * Converts the pixels of @src into @dest with the full LCMS pipeline. If
+ * @dest is smaller then @src is box filtered down to that size first, so
+ * only the pixels that will be shown are transformed. The image must not
+ * be scaled up.
+ **/
+gboolean
+gcm_utils_pixbuf_convert (GdkPixbuf *src,
+			  GdkPixbuf *dest,
+			  CdIcc *input,
+			  CdIcc *abstract,
+			  CdIcc *output,
+			  CdRenderingIntent intent,
+			  gboolean bpc,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	return gcm_utils_pixbuf_convert_internal (src, dest, input, abstract, output,
+						  intent, bpc, FALSE,
+						  cancellable, error);
+}
+
+/**
+ * gcm_utils_pixbuf_convert_preview:
+ * @src: the source #GdkPixbuf
+ * @dest: the destination #GdkPixbuf, which may be @src
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @abstract: (nullable): an abstract profile, or %NULL
+ * @output: (nullable): the output profile, or %NULL for sRGB
+ *
+ * Like gcm_utils_pixbuf_convert(), but uses gcm_utils_transform_new_fast()
+ * so the result can be about one level different from the exact value.
+ * This is only suitable for showing on screen.
+ **/
+gboolean
+gcm_utils_pixbuf_convert_preview (GdkPixbuf *src,
+				  GdkPixbuf *dest,
+				  CdIcc *input,
+				  CdIcc *abstract,
+				  CdIcc *output,
+				  CdRenderingIntent intent,
+				  gboolean bpc,
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	return gcm_utils_pixbuf_convert_internal (src, dest, input, abstract, output,
+						  intent, bpc, TRUE,
+						  cancellable, error);
+}
+
+/**
+ * gcm_utils_pixbuf_proof:
+ * @src: the sRGB source #GdkPixbuf
+ * @dest: the destination #GdkPixbuf, which may be @src
+ * @proof: the profile of the device to simulate
+ * @intent: the rendering intent for @proof
+ * @threshold: the color difference that is out of gamut, or 0
+ * @warning: (nullable): the gamut warning color
+ *
+ * Shows how @src would look on @proof when displayed on an sRGB monitor,
+ * optionally with a gamut warning; see gcm_utils_transform_new_proof().
+ * Like gcm_utils_pixbuf_convert() only the pixels that will be shown are
+ * transformed.
+ **/
+gboolean
+gcm_utils_pixbuf_proof (GdkPixbuf *src,
+			GdkPixbuf *dest,
+			CdIcc *proof,
+			CdRenderingIntent intent,
+			gdouble threshold,
+			const CdColorRGB8 *warning,
+			GCancellable *cancellable,
+			GError **error)
+{
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+
+	src = gcm_utils_pixbuf_prepare (src, dest, cancellable, error);
+	if (src == NULL)
+		return FALSE;
+	transform = gcm_utils_transform_new_proof (NULL, proof, NULL, intent,
+						   gcm_utils_get_pixel_format (src),
+						   gcm_utils_get_pixel_format (dest),
+						   threshold, warning, error);
+	if (transform == NULL)
+		return FALSE;
+	return gcm_utils_transform_process (transform,
+					    gdk_pixbuf_read_pixels (src),
+					    gdk_pixbuf_get_rowstride (src),
+					    gdk_pixbuf_get_pixels (dest),
+					    gdk_pixbuf_get_rowstride (dest),
+					    gdk_pixbuf_get_width (dest),
+					    gdk_pixbuf_get_height (dest),
+					    cancellable, error);
+}
+
+/**
+ * gcm_utils_pixbuf_convert_data:
+ * @src: the source pixels
+ * @src_stride: the source rowstride in bytes
+ * @format_in: the source format, e.g. from gcm_utils_get_pixel_format_for_depth()
+ * @dest: the destination #GdkPixbuf, which sets the size
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @abstract: (nullable): an abstract profile, or %NULL
+ * @output: (nullable): the output profile, or %NULL for sRGB
+ *
+ * Converts 8 bit, 16 bit or floating point pixels into @dest for display.
+ * Deep images are not quantized to 8 bits until after the conversion.
+ **/
+gboolean
+gcm_utils_pixbuf_convert_data (const guint8 *src,
+			       guint src_stride,
+			       guint32 format_in,
+			       GdkPixbuf *dest,
+			       CdIcc *input,
+			       CdIcc *abstract,
+			       CdIcc *output,
+			       CdRenderingIntent intent,
+			       gboolean bpc,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	gboolean has_alpha = gdk_pixbuf_get_has_alpha (dest);
+	guint32 format_out;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+
+	if (format_in == 0 || gcm_utils_get_pixel_format (dest) == 0) {
+		g_set_error_literal (error, 1, 0, "format not supported");
+		return FALSE;
+	}
+
+	/* nothing to gain from dithering */
+	if (T_BYTES (format_in) == 1) {
+		format_out = gcm_utils_get_pixel_format (dest);
+		transform = gcm_utils_transform_new (input, abstract, output, intent,
+						     format_in, format_out, bpc, error);
+		if (transform == NULL)
+			return FALSE;
+		return gcm_utils_transform_process (transform, src, src_stride,
+						    gdk_pixbuf_get_pixels (dest),
+						    gdk_pixbuf_get_rowstride (dest),
+						    gdk_pixbuf_get_width (dest),
+						    gdk_pixbuf_get_height (dest),
+						    cancellable, error);
+	}
+
+	format_out = gcm_utils_get_pixel_format_for_depth (16, FALSE, has_alpha);
+	transform = gcm_utils_transform_new (input, abstract, output, intent,
+					     format_in, format_out, bpc, error);
+	if (transform == NULL)
+		return FALSE;
+	return gcm_utils_transform_process_dither (transform, src, src_stride,
+						   gdk_pixbuf_get_pixels (dest),
+						   gdk_pixbuf_get_rowstride (dest),
+						   gdk_pixbuf_get_width (dest),
+						   gdk_pixbuf_get_height (dest),
+						   cancellable, error);
+}
+
+/**
+ * gcm_utils_pixbuf_delta_e:
+ * @src: the original sRGB #GdkPixbuf
+ * @dest: the converted #GdkPixbuf, with the same format as @src
+ * @heatmap: (nullable): a #GdkPixbuf the size of @dest, which may be @dest
+ * @delta_e: a #GcmUtilsDeltaE to add the differences to
+ * @cancellable: (nullable): a #GCancellable
+ *
+ * Works out the CIEDE2000 difference of each pixel of @dest from @src,
+ * taking both as sRGB. If @src is larger it is scaled down first in the
+ * same way as gcm_utils_pixbuf_convert(). Tiles are compared on all the
+ * CPU cores and added to @delta_e as each finishes, so partial results
+ * can be got from another thread with gcm_utils_delta_e_get_stats().
+ * If @heatmap is set the color channels are replaced with a heatmap of
+ * the differences.
+ **/
+gboolean
+gcm_utils_pixbuf_delta_e (GdkPixbuf *src,
+			  GdkPixbuf *dest,
+			  GdkPixbuf *heatmap,
+			  GcmUtilsDeltaE *delta_e,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	cmsContext context;
+	cmsHPROFILE profile_srgb;
+	cmsHPROFILE profile_xyz;
+	cmsHTRANSFORM handle;
+	GcmUtilsConvertJob *job;
+	gint width = gdk_pixbuf_get_width (dest);
+	gint height = gdk_pixbuf_get_height (dest);
+	guint32 format = gcm_utils_get_pixel_format (dest);
+	gboolean ret;
+	g_autoptr(GdkPixbuf) scaled = NULL;
+
+	if (format == 0 || gcm_utils_get_pixel_format (src) != format) {
+		g_set_error_literal (error, 1, 0, "formats are not the same");
+		return FALSE;
+	}
+	if (heatmap != NULL &&
+	    (gdk_pixbuf_get_width (heatmap) != width ||
+	     gdk_pixbuf_get_height (heatmap) != height ||
+	     gcm_utils_get_pixel_format (heatmap) == 0)) {
+		g_set_error_literal (error, 1, 0, "heatmap is not the same size");
+		return FALSE;
+	}
+	if (width != gdk_pixbuf_get_width (src) ||
+	    height != gdk_pixbuf_get_height (src)) {
+		scaled = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
+					 gdk_pixbuf_get_has_alpha (src), 8,
+					 width, height);
+		src = gcm_utils_pixbuf_prepare (src, scaled, cancellable, error);
+		if (src == NULL)
+			return FALSE;
+	}
+	if (width == 0 || height == 0)
+		return TRUE;
+
+	/* both images are converted to XYZ with the same transform, and
+	 * then to Lab with the cube roots done four at a time */
+	context = gcm_lcms_get_context ();
+	profile_srgb = cmsCreate_sRGBProfileTHR (context);
+	profile_xyz = cmsCreateXYZProfileTHR (context);
+	handle = cmsCreateTransformTHR (context,
+					profile_srgb, format,
+					profile_xyz, TYPE_XYZ_FLT | PLANAR_SH(1),
+					INTENT_RELATIVE_COLORIMETRIC,
+					cmsFLAGS_NOCACHE);
+	cmsCloseProfile (profile_srgb);
+	cmsCloseProfile (profile_xyz);
+	if (handle == NULL) {
+		gcm_lcms_set_error (error, "failed to create XYZ transform");
+		return FALSE;
+	}
+
+	job = g_new0 (GcmUtilsConvertJob, 1);
+	job->handle = handle;
+	job->delta_e = delta_e;
+	job->src = gdk_pixbuf_read_pixels (src);
+	job->src_stride = gdk_pixbuf_get_rowstride (src);
+	job->cmp = gdk_pixbuf_read_pixels (dest);
+	job->cmp_stride = gdk_pixbuf_get_rowstride (dest);
+	if (heatmap != NULL) {
+		job->dst = gdk_pixbuf_get_pixels (heatmap);
+		job->dst_stride = gdk_pixbuf_get_rowstride (heatmap);
+		job->dst_bpp = gdk_pixbuf_get_n_channels (heatmap);
+	}
+	job->width = width;
+	job->height = height;
+	ret = gcm_utils_convert_job_process (job, cancellable, error);
+	cmsDeleteTransform (handle);
+	return ret;
+}
+
+typedef struct {
+	GdkPixbuf		*src;
+	GdkPixbuf		*dest;
+	CdIcc			*input;
+	CdIcc			*abstract;
+	CdIcc			*output;
+	CdIcc			*proof;
+	CdRenderingIntent	 intent;
+	gboolean		 bpc;
+	gdouble			 threshold;
+	CdColorRGB8		 warning;
+} GcmUtilsConvertHelper;
+
+static void
+gcm_utils_convert_helper_free (GcmUtilsConvertHelper *helper)
+{
+	g_object_unref (helper->src);
+	g_object_unref (helper->dest);
+	if (helper->input != NULL)
+		g_object_unref (helper->input);
+	if (helper->abstract != NULL)
+		g_object_unref (helper->abstract);
+	if (helper->output != NULL)
+		g_object_unref (helper->output);
+	if (helper->proof != NULL)
+		g_object_unref (helper->proof);
+	g_free (helper);
+}
+
+static void
+gcm_utils_pixbuf_convert_thread_cb (GTask *task,
+				    gpointer source_object,
+				    gpointer task_data,
+				    GCancellable *cancellable)
+{
+	GcmUtilsConvertHelper *helper = (GcmUtilsConvertHelper *) task_data;
+	GError *error = NULL;
+
+	if (helper->proof != NULL) {
+		if (!gcm_utils_pixbuf_proof (helper->src, helper->dest,
+					     helper->proof,
+					     helper->intent,
+					     helper->threshold,
+					     &helper->warning,
+					     cancellable, &error)) {
+			g_task_return_error (task, error);
+			return;
+		}
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+	if (!gcm_utils_pixbuf_convert_preview (helper->src, helper->dest,
+					       helper->input,
+					       helper->abstract,
+					       helper->output,
+					       helper->intent,
+					       helper->bpc,
+					       cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gcm_utils_pixbuf_convert_preview_async:
+ * @src: the source #GdkPixbuf, which is not modified
+ * @dest: the destination #GdkPixbuf
+ *
+ * Converts @src into @dest in a thread; see gcm_utils_pixbuf_convert_preview().
+ * The caller must not start another conversion into @dest until this one
+ * has finished, even if it is cancelled.
+ **/
+void
+gcm_utils_pixbuf_convert_preview_async (GdkPixbuf *src,
+					GdkPixbuf *dest,
+					CdIcc *input,
+					CdIcc *abstract,
+					CdIcc *output,
+					CdRenderingIntent intent,
+					gboolean bpc,
+					GCancellable *cancellable,
+					GAsyncReadyCallback callback,
+					gpointer user_data)
+{
+	GcmUtilsConvertHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	helper = g_new0 (GcmUtilsConvertHelper, 1);
+	helper->src = g_object_ref (src);
+	helper->dest = g_object_ref (dest);
+	helper->input = input != NULL ? g_object_ref (input) : NULL;
+	helper->abstract = abstract != NULL ? g_object_ref (abstract) : NULL;
+	helper->output = output != NULL ? g_object_ref (output) : NULL;
+	helper->intent = intent;
+	helper->bpc = bpc;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gcm_utils_convert_helper_free);
+	g_task_run_in_thread (task, gcm_utils_pixbuf_convert_thread_cb);
+}
+
+/**
+ * gcm_utils_pixbuf_proof_async:
+ * @src: the source #GdkPixbuf, which is not modified
+ * @dest: the destination #GdkPixbuf
+ *
+ * Proofs @src into @dest in a thread; see gcm_utils_pixbuf_proof(). The
+ * result is got with gcm_utils_pixbuf_convert_finish().
+ **/
+void
+gcm_utils_pixbuf_proof_async (GdkPixbuf *src,
+			      GdkPixbuf *dest,
+			      CdIcc *proof,
+			      CdRenderingIntent intent,
+			      gdouble threshold,
+			      const CdColorRGB8 *warning,
+			      GCancellable *cancellable,
+			      GAsyncReadyCallback callback,
+			      gpointer user_data)
+{
+	GcmUtilsConvertHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	helper = g_new0 (GcmUtilsConvertHelper, 1);
+	helper->src = g_object_ref (src);
+	helper->dest = g_object_ref (dest);
+	helper->proof = g_object_ref (proof);
+	helper->intent = intent;
+	helper->threshold = threshold;
+	helper->warning = warning != NULL ? *warning : gcm_utils_warning_default;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gcm_utils_convert_helper_free);
+	g_task_run_in_thread (task, gcm_utils_pixbuf_convert_thread_cb);
+}
+
+typedef struct {
+	GdkPixbuf		*src;
+	GdkPixbuf		*dest;
+	GdkPixbuf		*heatmap;
+	CdIcc			*icc;
+	GcmUtilsDeltaE		*delta_e;
+} GcmUtilsDeltaEHelper;
+
+static void
+gcm_utils_delta_e_helper_free (GcmUtilsDeltaEHelper *helper)
+{
+	g_object_unref (helper->src);
+	g_object_unref (helper->dest);
+	if (helper->heatmap != NULL)
+		g_object_unref (helper->heatmap);
+	if (helper->icc != NULL)
+		g_object_unref (helper->icc);
+	g_free (helper);
+}
+
+static void
+gcm_utils_pixbuf_delta_e_thread_cb (GTask *task,
+				    gpointer source_object,
+				    gpointer task_data,
+				    GCancellable *cancellable)
+{
+	GcmUtilsDeltaEHelper *helper = (GcmUtilsDeltaEHelper *) task_data;
+	GError *error = NULL;
+
+	/* measure what is lost going into the profile and back */
+	if (helper->icc != NULL &&
+	    !gcm_utils_pixbuf_convert (helper->src, helper->dest,
+				       NULL, helper->icc, NULL,
+				       CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+				       FALSE, cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	if (!gcm_utils_pixbuf_delta_e (helper->src, helper->dest,
+				       helper->heatmap,
+				       helper->delta_e,
+				       cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gcm_utils_pixbuf_delta_e_async:
+ * @src: the original #GdkPixbuf
+ * @dest: the converted #GdkPixbuf
+ * @heatmap: (nullable): a #GdkPixbuf for the heatmap
+ * @icc: (nullable): a profile to convert @src through, or %NULL
+ * @delta_e: a #GcmUtilsDeltaE, which must outlive the task
+ *
+ * Compares @src and @dest in a thread; see gcm_utils_pixbuf_delta_e().
+ * If @icc is set, @dest is first overwritten with @src converted from
+ * sRGB to @icc and back with relative colorimetric intent, so the
+ * comparison shows the colors that @icc cannot reproduce.
+ * The result is got with gcm_utils_pixbuf_convert_finish().
+ **/
+void
+gcm_utils_pixbuf_delta_e_async (GdkPixbuf *src,
+				GdkPixbuf *dest,
+				GdkPixbuf *heatmap,
+				CdIcc *icc,
+				GcmUtilsDeltaE *delta_e,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer user_data)
+{
+	GcmUtilsDeltaEHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	helper = g_new0 (GcmUtilsDeltaEHelper, 1);
+	helper->src = g_object_ref (src);
+	helper->dest = g_object_ref (dest);
+	if (heatmap != NULL)
+		helper->heatmap = g_object_ref (heatmap);
+	if (icc != NULL)
+		helper->icc = g_object_ref (icc);
+	helper->delta_e = delta_e;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gcm_utils_delta_e_helper_free);
+	g_task_run_in_thread (task, gcm_utils_pixbuf_delta_e_thread_cb);
+}
+
+/*
+ * Banding is found by converting synthetic 16 bit ramps of each primary
+ * and of gray, then applying the VCGT as the video card would. A smooth
+ * curve never holds a level for long, so a level that is held and then
+ * jumps by several times the mean step is a quantization step, and any
+ * fall is a reversal. Each channel is only checked in the ramps that drive
+ * it, as the other channels of a primary ramp need not be monotonic.
+ */
+
+/* red, green, blue and gray */
+#define GCM_UTILS_RAMP_ROWS			4
+#define GCM_UTILS_RAMP_SAMPLES			1024	/* one for each 10 bit level */
+/* a jump larger than this many mean steps, after a held level */
+#define GCM_UTILS_BANDING_STEP_FACTOR		4
+/* a level is held if it changes by less than this fraction of a mean step */
+#define GCM_UTILS_BANDING_HOLD_FACTOR		8
+/* 16 bit rounding in LCMS */
+#define GCM_UTILS_BANDING_NOISE			2
+
+#define GCM_UTILS_BANDING_FLAG_STEP		(1 << 0)
+#define GCM_UTILS_BANDING_FLAG_REVERSAL		(1 << 1)
+
+struct _GcmUtilsBanding {
+	gboolean	 valid;
+	guint		 levels[3];
+	guint		 steps[3];
+	guint		 reversals[3];
+};
+
+/**
+ * gcm_utils_banding_new:
+ *
+ * Creates an empty set of banding statistics.
+ *
+ * Returns: a #GcmUtilsBanding, free with gcm_utils_banding_free()
+ **/
+GcmUtilsBanding *
+gcm_utils_banding_new (void)
+{
+	return g_new0 (GcmUtilsBanding, 1);
+}
+
+/**
+ * gcm_utils_banding_free:
+ * @banding: a #GcmUtilsBanding
+ *
+ * Frees the banding statistics.
+ **/
+void
+gcm_utils_banding_free (GcmUtilsBanding *banding)
+{
+	g_free (banding);
+}
+
+/**
+ * gcm_utils_banding_get_stats:
+ * @banding: a #GcmUtilsBanding
+ * @channel: 0 for red, 1 for green or 2 for blue
+ * @levels: (out) (optional): the number of distinct 16 bit output levels in
+ *	the ramps that drive the channel
+ * @steps: (out) (optional): the number of quantization steps
+ * @reversals: (out) (optional): the number of places the output falls
+ *
+ * Gets the statistics for one channel of the ramps converted by
+ * gcm_utils_pixbuf_ramps().
+ *
+ * Returns: %FALSE if no ramps have been converted yet
+ **/
+gboolean
+gcm_utils_banding_get_stats (GcmUtilsBanding *banding,
+			     guint channel,
+			     guint *levels,
+			     guint *steps,
+			     guint *reversals)
+{
+	g_return_val_if_fail (channel < 3, FALSE);
+
+	if (!banding->valid)
 		return FALSE;
+	if (levels != NULL)
+		*levels = banding->levels[channel];
+	if (steps != NULL)
+		*steps = banding->steps[channel];
+	if (reversals != NULL)
+		*reversals = banding->reversals[channel];
+	return TRUE;
+}
+
+/* one pass over a channel of an interleaved RGB ramp */
+static void
+gcm_utils_banding_scan_ramp (GcmUtilsBanding *banding,
+			     const guint16 *ramp,
+			     guint channel,
+			     guint8 *seen,
+			     guint8 *flags)
+{
+	const guint16 *v = ramp + channel;
+	const guint n = GCM_UTILS_RAMP_SAMPLES;
+	gint32 mean = ((gint32) v[(n - 1) * 3] - (gint32) v[0]) / (gint32) (n - 1);
+	gint32 delta_last;
+
+	mean = MAX (mean, 1);
+	delta_last = mean;
+	seen[v[0] >> 3] |= 1 << (v[0] & 7);
+	for (guint i = 1; i < n; i++) {
+		guint16 value = v[i * 3];
+		gint32 delta = (gint32) value - (gint32) v[(i - 1) * 3];
+
+		seen[value >> 3] |= 1 << (value & 7);
+		if (delta < -GCM_UTILS_BANDING_NOISE) {
+			banding->reversals[channel]++;
+			flags[i] |= GCM_UTILS_BANDING_FLAG_REVERSAL;
+		} else if (delta > mean * GCM_UTILS_BANDING_STEP_FACTOR &&
+			   delta_last * GCM_UTILS_BANDING_HOLD_FACTOR < mean) {
+			banding->steps[channel]++;
+			flags[i] |= GCM_UTILS_BANDING_FLAG_STEP;
+		}
+		delta_last = delta;
 	}
+}
 
-	/* get a copy of the original image, *not* a ref */
-	original_pixbuf = g_object_get_data (G_OBJECT (pixbuf), "GcmImageOld");
-	if (original_pixbuf == NULL) {
-		data = g_memdup (gdk_pixbuf_get_pixels (pixbuf),
-				 gdk_pixbuf_get_bits_per_sample (pixbuf) *
-				 gdk_pixbuf_get_rowstride (pixbuf) *
-				 gdk_pixbuf_get_height (pixbuf) / 8);
-		original_pixbuf = gdk_pixbuf_new_from_data (data,
-			  gdk_pixbuf_get_colorspace (pixbuf),
-			  gdk_pixbuf_get_has_alpha (pixbuf),
-			  gdk_pixbuf_get_bits_per_sample (pixbuf),
-			  gdk_pixbuf_get_width (pixbuf),
-			  gdk_pixbuf_get_height (pixbuf),
-			  gdk_pixbuf_get_rowstride (pixbuf),
-			  (GdkPixbufDestroyNotify) g_free, NULL);
-		g_object_set_data_full (G_OBJECT (pixbuf), "GcmImageOld",
-					original_pixbuf,
-					(GDestroyNotify) g_object_unref);
-	}
-
-	/* convert in-place */
-	transform = cd_transform_new ();
-	cd_transform_set_input_icc (transform, input);
-	cd_transform_set_abstract_icc (transform, abstract);
-	cd_transform_set_output_icc (transform, output);
-	cd_transform_set_rendering_intent (transform, CD_RENDERING_INTENT_PERCEPTUAL);
-	cd_transform_set_input_pixel_format (transform, pixel_format);
-	cd_transform_set_output_pixel_format (transform, pixel_format);
-	bpp = gdk_pixbuf_get_rowstride (pixbuf) / gdk_pixbuf_get_width (pixbuf);
-	ret = cd_transform_process (transform,
-				    gdk_pixbuf_get_pixels (original_pixbuf),
-				    gdk_pixbuf_get_pixels (pixbuf),
-				    gdk_pixbuf_get_width (pixbuf),
-				    gdk_pixbuf_get_height (pixbuf),
-				    gdk_pixbuf_get_rowstride (pixbuf) / bpp,
-				    NULL,
-				    error);
-	if (!ret)
-		return FALSE;
-
-	/* refresh */
-	g_object_ref (pixbuf);
-	gtk_image_set_from_pixbuf (image, pixbuf);
-	g_object_unref (pixbuf);
+/* as the video card would, with the same resolution as the ramps */
+static void
+gcm_utils_ramps_apply_vcgt (guint16 *ramps, guint n_pixels, GPtrArray *vcgt)
+{
+	gfloat scale = (gfloat) (vcgt->len - 1) / 65535.f;
+
+	for (guint i = 0; i < n_pixels * 3; i++) {
+		const CdColorRGB *lo;
+		const CdColorRGB *hi;
+		gdouble values[2];
+		gfloat pos = (gfloat) ramps[i] * scale;
+		guint idx = MIN ((guint) pos, vcgt->len - 2);
+		gfloat frac = pos - (gfloat) idx;
+		gfloat value;
+
+		lo = g_ptr_array_index (vcgt, idx);
+		hi = g_ptr_array_index (vcgt, idx + 1);
+		switch (i % 3) {
+		case 0:
+			values[0] = lo->R;
+			values[1] = hi->R;
+			break;
+		case 1:
+			values[0] = lo->G;
+			values[1] = hi->G;
+			break;
+		default:
+			values[0] = lo->B;
+			values[1] = hi->B;
+			break;
+		}
+		value = (gfloat) (values[0] + (values[1] - values[0]) * frac);
+		ramps[i] = (guint16) (CLAMP (value, 0.f, 1.f) * 65535.f + 0.5f);
+	}
+}
+
+/* each ramp is a band, with a strip underneath marking where it bands */
+static void
+gcm_utils_ramps_draw (GdkPixbuf *dest, const guint16 *ramps, guint8 *flags)
+{
+	const CdColorRGB8 color_step = { 255, 255, 0 };
+	const CdColorRGB8 color_reversal = { 255, 0, 255 };
+	const guint n = GCM_UTILS_RAMP_SAMPLES;
+	guint bpp = (guint) gdk_pixbuf_get_n_channels (dest);
+	guint stride = (guint) gdk_pixbuf_get_rowstride (dest);
+	guint width = (guint) gdk_pixbuf_get_width (dest);
+	guint height = (guint) gdk_pixbuf_get_height (dest);
+	guint8 *pixels = gdk_pixbuf_get_pixels (dest);
+
+	for (guint y = 0; y < height; y++) {
+		guint row = y * GCM_UTILS_RAMP_ROWS / height;
+		guint top = (row * height + GCM_UTILS_RAMP_ROWS - 1) / GCM_UTILS_RAMP_ROWS;
+		guint bottom = ((row + 1) * height + GCM_UTILS_RAMP_ROWS - 1) / GCM_UTILS_RAMP_ROWS;
+		gboolean strip = y >= bottom - MAX ((bottom - top) / 5, 1);
+		guint8 *dst = pixels + y * stride;
+
+		for (guint x = 0; x < width; x++) {
+			guint i0 = x * n / width;
+			guint i1 = MAX ((x + 1) * n / width, i0 + 1);
+			const guint16 *src = ramps + (row * n + i0) * 3;
+			guint8 mark = 0;
+
+			if (!strip) {
+				for (guint c = 0; c < 3; c++)
+					dst[x * bpp + c] = (guint8) (((guint32) src[c] * 255 + 32767) / 65535);
+				continue;
+			}
+			for (guint i = i0; i < i1; i++)
+				mark |= flags[row * n + i];
+			if (mark & GCM_UTILS_BANDING_FLAG_REVERSAL) {
+				dst[x * bpp + 0] = color_reversal.R;
+				dst[x * bpp + 1] = color_reversal.G;
+				dst[x * bpp + 2] = color_reversal.B;
+			} else if (mark & GCM_UTILS_BANDING_FLAG_STEP) {
+				dst[x * bpp + 0] = color_step.R;
+				dst[x * bpp + 1] = color_step.G;
+				dst[x * bpp + 2] = color_step.B;
+			} else {
+				dst[x * bpp + 0] = 0;
+				dst[x * bpp + 1] = 0;
+				dst[x * bpp + 2] = 0;
+			}
+		}
+		if (bpp == 4) {
+			for (guint x = 0; x < width; x++)
+				dst[x * bpp + 3] = 255;
+		}
+	}
+}
+
+/**
+ * gcm_utils_pixbuf_ramps:
+ * @dest: (nullable): a #GdkPixbuf for the preview, or %NULL
+ * @output: the display profile
+ * @banding: a #GcmUtilsBanding for the results
+ * @cancellable: (nullable): a #GCancellable
+ * @error: a #GError, or %NULL
+ *
+ * Converts 16 bit ramps of red, green, blue and gray from sRGB to @output,
+ * applies any VCGT, and finds where the result bands. The ramps are drawn
+ * into @dest from top to bottom as the application would send them to the
+ * display, each with a strip underneath marking steps in yellow and
+ * reversals in magenta.
+ *
+ * Returns: %TRUE if @banding was filled in
+ **/
+gboolean
+gcm_utils_pixbuf_ramps (GdkPixbuf *dest,
+			CdIcc *output,
+			GcmUtilsBanding *banding,
+			GCancellable *cancellable,
+			GError **error)
+{
+	const guint n = GCM_UTILS_RAMP_SAMPLES;
+	guint16 *calibrated;
+	guint16 *ramps;
+	guint8 *flags;
+	guint8 *seen;
+	gboolean ret;
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autoptr(GPtrArray) vcgt = NULL;
+
+	g_return_val_if_fail (CD_IS_ICC (output), FALSE);
+	g_return_val_if_fail (banding != NULL, FALSE);
+
+	memset (banding, 0, sizeof (GcmUtilsBanding));
+	if (cd_icc_get_colorspace (output) != CD_COLORSPACE_RGB) {
+		g_set_error_literal (error, 1, 0, "not an RGB profile");
+		return FALSE;
+	}
+	transform = gcm_utils_transform_new (NULL, NULL, output,
+					     CD_RENDERING_INTENT_PERCEPTUAL,
+					     TYPE_RGB_16, TYPE_RGB_16,
+					     FALSE, error);
+	if (transform == NULL)
+		return FALSE;
+
+	/* red, green, blue, then gray */
+	ramps = g_new0 (guint16, GCM_UTILS_RAMP_ROWS * n * 3);
+	for (guint i = 0; i < n; i++) {
+		guint16 value = (guint16) (i * 65535 / (n - 1));
+		for (guint c = 0; c < 3; c++) {
+			ramps[(c * n + i) * 3 + c] = value;
+			ramps[(3 * n + i) * 3 + c] = value;
+		}
+	}
+	ret = gcm_utils_transform_process (transform,
+					   (const guint8 *) ramps, n * 6,
+					   (guint8 *) ramps, n * 6,
+					   n, GCM_UTILS_RAMP_ROWS,
+					   cancellable, error);
+	if (!ret) {
+		g_free (ramps);
+		return FALSE;
+	}
+
+	/* what the display shows */
+	calibrated = g_new (guint16, GCM_UTILS_RAMP_ROWS * n * 3);
+	memcpy (calibrated, ramps, GCM_UTILS_RAMP_ROWS * n * 6);
+	gcm_utils_icc_lock ();
+	vcgt = cd_icc_get_vcgt (output, n, NULL);
+	gcm_utils_icc_unlock ();
+	if (vcgt != NULL && vcgt->len >= 2)
+		gcm_utils_ramps_apply_vcgt (calibrated, GCM_UTILS_RAMP_ROWS * n, vcgt);
+
+	/* a primary only drives its own channel, gray drives all three */
+	flags = g_new0 (guint8, GCM_UTILS_RAMP_ROWS * n);
+	seen = g_new (guint8, 65536 / 8);
+	for (guint c = 0; c < 3; c++) {
+		memset (seen, 0, 65536 / 8);
+		gcm_utils_banding_scan_ramp (banding, calibrated + c * n * 3, c,
+					     seen, flags + c * n);
+		gcm_utils_banding_scan_ramp (banding, calibrated + 3 * n * 3, c,
+					     seen, flags + 3 * n);
+		for (guint i = 0; i < 65536 / 8; i++) {
+			for (guint8 bits = seen[i]; bits != 0; bits &= bits - 1)
+				banding->levels[c]++;
+		}
+	}
+	banding->valid = TRUE;
+
+	if (dest != NULL)
+		gcm_utils_ramps_draw (dest, ramps, flags);
+	g_free (calibrated);
+	g_free (flags);
+	g_free (ramps);
+	g_free (seen);
 	return TRUE;
 }
+
+typedef struct {
+	GdkPixbuf		*dest;
+	CdIcc			*output;
+	GcmUtilsBanding		*banding;
+} GcmUtilsRampsHelper;
+
+static void
+gcm_utils_ramps_helper_free (GcmUtilsRampsHelper *helper)
+{
+	if (helper->dest != NULL)
+		g_object_unref (helper->dest);
+	g_object_unref (helper->output);
+	g_free (helper);
+}
+
+static void
+gcm_utils_pixbuf_ramps_thread_cb (GTask *task,
+				  gpointer source_object,
+				  gpointer task_data,
+				  GCancellable *cancellable)
+{
+	GcmUtilsRampsHelper *helper = (GcmUtilsRampsHelper *) task_data;
+	GError *error = NULL;
+
+	if (!gcm_utils_pixbuf_ramps (helper->dest, helper->output,
+				     helper->banding,
+				     cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gcm_utils_pixbuf_ramps_async:
+ * @dest: (nullable): a #GdkPixbuf for the preview
+ * @output: the display profile
+ * @banding: a #GcmUtilsBanding, which must outlive the task
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the ramps have been converted
+ * @user_data: data for @callback
+ *
+ * Converts the ramps in a thread; see gcm_utils_pixbuf_ramps().
+ * The result is got with gcm_utils_pixbuf_convert_finish(), which sets
+ * an error and returns %FALSE if the conversion failed or was cancelled.
+ **/
+void
+gcm_utils_pixbuf_ramps_async (GdkPixbuf *dest,
+			      CdIcc *output,
+			      GcmUtilsBanding *banding,
+			      GCancellable *cancellable,
+			      GAsyncReadyCallback callback,
+			      gpointer user_data)
+{
+	GcmUtilsRampsHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	helper = g_new0 (GcmUtilsRampsHelper, 1);
+	if (dest != NULL)
+		helper->dest = g_object_ref (dest);
+	helper->output = g_object_ref (output);
+	helper->banding = banding;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gcm_utils_ramps_helper_free);
+	g_task_run_in_thread (task, gcm_utils_pixbuf_ramps_thread_cb);
+}
+
+/*
+ * Comparing rendering intents needs eight transforms, and building them is
+ * most of the work for a preview. They are built at the same time, one
+ * thread each, from the shared profiles; only reading the profiles is
+ * serialized, and baking and applying the transforms are not. The source
+ * is scaled once and shared, so only the destinations are written.
+ */
+
+static const struct {
+	CdRenderingIntent	 intent;
+	gboolean		 bpc;
+} gcm_utils_intent_grid[GCM_UTILS_INTENT_GRID_SIZE] = {
+	{ CD_RENDERING_INTENT_PERCEPTUAL,		FALSE },
+	{ CD_RENDERING_INTENT_PERCEPTUAL,		TRUE },
+	{ CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC,	FALSE },
+	{ CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC,	TRUE },
+	{ CD_RENDERING_INTENT_SATURATION,		FALSE },
+	{ CD_RENDERING_INTENT_SATURATION,		TRUE },
+	{ CD_RENDERING_INTENT_ABSOLUTE_COLORIMETRIC,	FALSE },
+	{ CD_RENDERING_INTENT_ABSOLUTE_COLORIMETRIC,	TRUE },
+};
+
+/**
+ * gcm_utils_intent_grid_get_cell:
+ * @idx: the cell index, less than %GCM_UTILS_INTENT_GRID_SIZE
+ * @intent: (out): the rendering intent
+ * @bpc: (out): if black point compensation is used
+ *
+ * Gets what the destination at @idx of gcm_utils_pixbuf_convert_grid()
+ * is converted with. Each intent is followed by the same with BPC.
+ **/
+void
+gcm_utils_intent_grid_get_cell (guint idx, CdRenderingIntent *intent, gboolean *bpc)
+{
+	g_return_if_fail (idx < GCM_UTILS_INTENT_GRID_SIZE);
+	*intent = gcm_utils_intent_grid[idx].intent;
+	*bpc = gcm_utils_intent_grid[idx].bpc;
+}
+
+static void
+gcm_utils_grid_cell_run (GcmUtilsGridCell *cell)
+{
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+
+	/* the lookup table takes longer to build than to apply */
+	if (g_cancellable_set_error_if_cancelled (cell->cancellable, &cell->error))
+		return;
+	transform = gcm_utils_transform_new_fast (cell->profiles[0],
+						  cell->profiles[1],
+						  cell->profiles[2],
+						  cell->intent,
+						  gcm_utils_get_pixel_format (cell->src),
+						  gcm_utils_get_pixel_format (cell->dest),
+						  cell->bpc, &cell->error);
+	if (transform == NULL)
+		return;
+	gcm_utils_transform_process (transform,
+				     gdk_pixbuf_read_pixels (cell->src),
+				     gdk_pixbuf_get_rowstride (cell->src),
+				     gdk_pixbuf_get_pixels (cell->dest),
+				     gdk_pixbuf_get_rowstride (cell->dest),
+				     gdk_pixbuf_get_width (cell->dest),
+				     gdk_pixbuf_get_height (cell->dest),
+				     cell->cancellable, &cell->error);
+}
+
+/**
+ * gcm_utils_pixbuf_convert_grid:
+ * @src: the source #GdkPixbuf, which is not modified
+ * @dests: (element-type GdkPixbuf): %GCM_UTILS_INTENT_GRID_SIZE pixbufs
+ *	all the same size and no larger than @src
+ * @input: (nullable): the input profile, or %NULL for sRGB
+ * @abstract: (nullable): an abstract profile
+ * @output: (nullable): the output profile, or %NULL for sRGB
+ * @cancellable: (nullable): a #GCancellable
+ *
+ * Converts @src with every rendering intent, with and without black point
+ * compensation, in parallel; see gcm_utils_intent_grid_get_cell() for the
+ * order of @dests.
+ **/
+gboolean
+gcm_utils_pixbuf_convert_grid (GdkPixbuf *src,
+			       GPtrArray *dests,
+			       CdIcc *input,
+			       CdIcc *abstract,
+			       CdIcc *output,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	CdIcc *profiles[] = { input, abstract, output };
+	GcmUtilsConvertJob *job;
+	GcmUtilsGridCell cells[GCM_UTILS_INTENT_GRID_SIZE];
+	GdkPixbuf *dest;
+	gboolean ret;
+	g_autoptr(GdkPixbuf) scaled = NULL;
+
+	if (dests->len != GCM_UTILS_INTENT_GRID_SIZE) {
+		g_set_error_literal (error, 1, 0, "wrong number of destinations");
+		return FALSE;
+	}
+	dest = g_ptr_array_index (dests, 0);
+	for (guint i = 1; i < dests->len; i++) {
+		GdkPixbuf *tmp = g_ptr_array_index (dests, i);
+		if (gdk_pixbuf_get_width (tmp) != gdk_pixbuf_get_width (dest) ||
+		    gdk_pixbuf_get_height (tmp) != gdk_pixbuf_get_height (dest) ||
+		    gcm_utils_get_pixel_format (tmp) != gcm_utils_get_pixel_format (dest)) {
+			g_set_error_literal (error, 1, 0, "destinations are not the same");
+			return FALSE;
+		}
+	}
+
+	/* scaled once for all the cells */
+	if (gdk_pixbuf_get_width (src) != gdk_pixbuf_get_width (dest) ||
+	    gdk_pixbuf_get_height (src) != gdk_pixbuf_get_height (dest)) {
+		scaled = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
+					 gdk_pixbuf_get_has_alpha (src), 8,
+					 gdk_pixbuf_get_width (dest),
+					 gdk_pixbuf_get_height (dest));
+		src = gcm_utils_pixbuf_prepare (src, scaled, cancellable, error);
+	} else {
+		src = gcm_utils_pixbuf_prepare (src, dest, cancellable, error);
+	}
+	if (src == NULL)
+		return FALSE;
+
+	job = g_new0 (GcmUtilsConvertJob, 1);
+	job->cells = cells;
+	job->tiles_total = GCM_UTILS_INTENT_GRID_SIZE;
+	for (guint i = 0; i < GCM_UTILS_INTENT_GRID_SIZE; i++) {
+		GcmUtilsGridCell *cell = &cells[i];
+		cell->src = src;
+		cell->dest = g_ptr_array_index (dests, i);
+		for (guint j = 0; j < 3; j++)
+			cell->profiles[j] = profiles[j];
+		cell->intent = gcm_utils_intent_grid[i].intent;
+		cell->bpc = gcm_utils_intent_grid[i].bpc;
+		cell->cancellable = cancellable;
+		cell->error = NULL;
+	}
+	ret = gcm_utils_convert_job_process (job, cancellable, error);
+	for (guint i = 0; i < GCM_UTILS_INTENT_GRID_SIZE; i++) {
+		if (cells[i].error == NULL)
+			continue;
+		if (ret)
+			g_propagate_error (error, cells[i].error);
+		else
+			g_error_free (cells[i].error);
+		ret = FALSE;
+	}
+	return ret;
+}
+
+typedef struct {
+	GdkPixbuf		*src;
+	GPtrArray		*dests;
+	CdIcc			*input;
+	CdIcc			*abstract;
+	CdIcc			*output;
+} GcmUtilsGridHelper;
+
+static void
+gcm_utils_grid_helper_free (GcmUtilsGridHelper *helper)
+{
+	g_object_unref (helper->src);
+	g_ptr_array_unref (helper->dests);
+	if (helper->input != NULL)
+		g_object_unref (helper->input);
+	if (helper->abstract != NULL)
+		g_object_unref (helper->abstract);
+	if (helper->output != NULL)
+		g_object_unref (helper->output);
+	g_free (helper);
+}
+
+static void
+gcm_utils_pixbuf_convert_grid_thread_cb (GTask *task,
+					 gpointer source_object,
+					 gpointer task_data,
+					 GCancellable *cancellable)
+{
+	GcmUtilsGridHelper *helper = (GcmUtilsGridHelper *) task_data;
+	GError *error = NULL;
+
+	if (!gcm_utils_pixbuf_convert_grid (helper->src, helper->dests,
+					    helper->input,
+					    helper->abstract,
+					    helper->output,
+					    cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gcm_utils_pixbuf_convert_grid_async:
+ * @src: the source #GdkPixbuf, which is not modified
+ * @dests: (element-type GdkPixbuf): the destinations
+ *
+ * Converts @src into each of @dests in a thread; see
+ * gcm_utils_pixbuf_convert_grid(). The result is got with
+ * gcm_utils_pixbuf_convert_finish().
+ **/
+void
+gcm_utils_pixbuf_convert_grid_async (GdkPixbuf *src,
+				     GPtrArray *dests,
+				     CdIcc *input,
+				     CdIcc *abstract,
+				     CdIcc *output,
+				     GCancellable *cancellable,
+				     GAsyncReadyCallback callback,
+				     gpointer user_data)
+{
+	GcmUtilsGridHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	helper = g_new0 (GcmUtilsGridHelper, 1);
+	helper->src = g_object_ref (src);
+	helper->dests = g_ptr_array_ref (dests);
+	if (input != NULL)
+		helper->input = g_object_ref (input);
+	if (abstract != NULL)
+		helper->abstract = g_object_ref (abstract);
+	if (output != NULL)
+		helper->output = g_object_ref (output);
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gcm_utils_grid_helper_free);
+	g_task_run_in_thread (task, gcm_utils_pixbuf_convert_grid_thread_cb);
+}
+
+/**
+ * gcm_utils_pixbuf_convert_finish:
+ *
+ * Gets the result of the conversion, proof or comparison. If the #GCancellable was cancelled at
+ * any time before this is called then the result should be discarded.
+ **/
+gboolean
+gcm_utils_pixbuf_convert_finish (GAsyncResult *res, GError **error)
+{
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
@@ -9,6 +9,8 @@
 
 #include <glib-object.h>
 #include <gtk/gtk.h>
+#include <colord.h>
+#include <lcms2.h>
 
 #define GCM_STOCK_ICON					"gnome-color-manager"
 #define GCM_DBUS_SERVICE				"org.gnome.ColorManager"
@@ -21,11 +23,205 @@
 #define GCM_PREFS_PACKAGE_NAME_COLOR_PROFILES		"shared-color-profiles"
 #define GCM_PREFS_PACKAGE_NAME_COLOR_PROFILES_EXTRA	"shared-color-profiles-extra"
 
+/* every rendering intent, with and without black point compensation */
+#define GCM_UTILS_INTENT_GRID_SIZE			8
+
+typedef struct _GcmUtilsTransform			GcmUtilsTransform;
+typedef struct _GcmUtilsDeltaE				GcmUtilsDeltaE;
+typedef struct _GcmUtilsBanding				GcmUtilsBanding;
+
+typedef struct {
+	const guint8	*src;
+	guint		 src_stride;
+	guint8		*dst;
+	guint		 dst_stride;
+	guint		 width;
+	guint		 height;
+} GcmUtilsRegion;
+
+/*
+ * The LCMS handle of a CdIcc reads its tags lazily from the profile data,
+ * so it must never be used by two threads at once. Anything that reads
+ * through cd_icc_get_handle(), either directly or in colord functions such
+ * as cd_icc_get_vcgt(), holds gcm_utils_icc_lock() while it does. The
+ * gcm_utils transform constructors take the lock themselves, so CdIcc
+ * objects can be shared with any thread and need not be copied; the
+ * transforms they return do not use the profiles again and can be run
+ * from any number of threads at once.
+ */
+void		 gcm_utils_icc_lock			(void);
+void		 gcm_utils_icc_unlock			(void);
 gchar		*gcm_utils_linkify			(const gchar		*text);
 const gchar	*cd_colorspace_to_localised_string	(CdColorspace		 colorspace);
-gboolean	 gcm_utils_image_convert		(GtkImage		*image,
+guint32		 gcm_utils_get_pixel_format_for_depth	(guint			 bits_per_sample,
+							 gboolean		 is_float,
+							 gboolean		 has_alpha);
+GcmUtilsTransform *gcm_utils_transform_new		(CdIcc			*input,
+							 CdIcc			*abstract,
+							 CdIcc			*output,
+							 CdRenderingIntent	 intent,
+							 guint32		 format_in,
+							 guint32		 format_out,
+							 gboolean		 bpc,
+							 GError			**error);
+GcmUtilsTransform *gcm_utils_transform_new_fast		(CdIcc			*input,
+							 CdIcc			*abstract,
+							 CdIcc			*output,
+							 CdRenderingIntent	 intent,
+							 guint32		 format_in,
+							 guint32		 format_out,
+							 gboolean		 bpc,
+							 GError			**error);
+GcmUtilsTransform *gcm_utils_transform_new_proof		(CdIcc			*input,
+							 CdIcc			*proof,
+							 CdIcc			*output,
+							 CdRenderingIntent	 intent,
+							 guint32		 format_in,
+							 guint32		 format_out,
+							 gdouble		 threshold,
+							 const CdColorRGB8	*warning,
+							 GError			**error);
+cmsHTRANSFORM	 gcm_utils_transform_get_handle		(GcmUtilsTransform	*transform);
+GcmUtilsTransform *gcm_utils_transform_ref		(GcmUtilsTransform	*transform);
+void		 gcm_utils_transform_unref		(GcmUtilsTransform	*transform);
+gboolean	 gcm_utils_transform_process		(GcmUtilsTransform	*transform,
+							 const guint8		*src,
+							 guint			 src_stride,
+							 guint8			*dst,
+							 guint			 dst_stride,
+							 guint			 width,
+							 guint			 height,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_utils_transform_process_regions	(GcmUtilsTransform	*transform,
+							 const GcmUtilsRegion	*regions,
+							 guint			 n_regions,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_utils_transform_process_dither	(GcmUtilsTransform	*transform,
+							 const guint8		*src,
+							 guint			 src_stride,
+							 guint8			*dst,
+							 guint			 dst_stride,
+							 guint			 width,
+							 guint			 height,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_utils_pixbuf_convert		(GdkPixbuf		*src,
+							 GdkPixbuf		*dest,
+							 CdIcc			*input,
+							 CdIcc			*abstract,
+							 CdIcc			*output,
+							 CdRenderingIntent	 intent,
+							 gboolean		 bpc,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_utils_pixbuf_convert_preview	(GdkPixbuf		*src,
+							 GdkPixbuf		*dest,
+							 CdIcc			*input,
+							 CdIcc			*abstract,
+							 CdIcc			*output,
+							 CdRenderingIntent	 intent,
+							 gboolean		 bpc,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_utils_pixbuf_proof			(GdkPixbuf		*src,
+							 GdkPixbuf		*dest,
+							 CdIcc			*proof,
+							 CdRenderingIntent	 intent,
+							 gdouble		 threshold,
+							 const CdColorRGB8	*warning,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_utils_pixbuf_delta_e		(GdkPixbuf		*src,
+							 GdkPixbuf		*dest,
+							 GdkPixbuf		*heatmap,
+							 GcmUtilsDeltaE		*delta_e,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_utils_pixbuf_ramps			(GdkPixbuf		*dest,
+							 CdIcc			*output,
+							 GcmUtilsBanding	*banding,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 gcm_utils_pixbuf_convert_grid		(GdkPixbuf		*src,
+							 GPtrArray		*dests,
+							 CdIcc			*input,
+							 CdIcc			*abstract,
+							 CdIcc			*output,
+							 GCancellable		*cancellable,
+							 GError			**error);
+void		 gcm_utils_intent_grid_get_cell		(guint			 idx,
+							 CdRenderingIntent	*intent,
+							 gboolean		*bpc);
+gboolean	 gcm_utils_pixbuf_convert_data		(const guint8		*src,
+							 guint			 src_stride,
+							 guint32		 format_in,
+							 GdkPixbuf		*dest,
+							 CdIcc			*input,
+							 CdIcc			*abstract,
+							 CdIcc			*output,
+							 CdRenderingIntent	 intent,
+							 gboolean		 bpc,
+							 GCancellable		*cancellable,
+							 GError			**error);
+void		 gcm_utils_pixbuf_convert_preview_async (GdkPixbuf		*src,
+							 GdkPixbuf		*dest,
+							 CdIcc			*input,
+							 CdIcc			*abstract,
+							 CdIcc			*output,
+							 CdRenderingIntent	 intent,
+							 gboolean		 bpc,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+void		 gcm_utils_pixbuf_proof_async		(GdkPixbuf		*src,
+							 GdkPixbuf		*dest,
+							 CdIcc			*proof,
+							 CdRenderingIntent	 intent,
+							 gdouble		 threshold,
+							 const CdColorRGB8	*warning,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+void		 gcm_utils_pixbuf_delta_e_async		(GdkPixbuf		*src,
+							 GdkPixbuf		*dest,
+							 GdkPixbuf		*heatmap,
+							 CdIcc			*icc,
+							 GcmUtilsDeltaE		*delta_e,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+void		 gcm_utils_pixbuf_ramps_async		(GdkPixbuf		*dest,
+							 CdIcc			*output,
+							 GcmUtilsBanding	*banding,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+void		 gcm_utils_pixbuf_convert_grid_async	(GdkPixbuf		*src,
+							 GPtrArray		*dests,
 							 CdIcc			*input,
 							 CdIcc			*abstract,
 							 CdIcc			*output,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+gboolean	 gcm_utils_pixbuf_convert_finish	(GAsyncResult		*res,
 							 GError			**error);
+GcmUtilsDeltaE	*gcm_utils_delta_e_new			(void);
+void		 gcm_utils_delta_e_free			(GcmUtilsDeltaE		*delta_e);
+gboolean	 gcm_utils_delta_e_get_stats		(GcmUtilsDeltaE		*delta_e,
+							 gdouble		*mean,
+							 gdouble		*p95,
+							 gdouble		*max);
+GcmUtilsBanding	*gcm_utils_banding_new			(void);
+void		 gcm_utils_banding_free			(GcmUtilsBanding	*banding);
+gboolean	 gcm_utils_banding_get_stats		(GcmUtilsBanding	*banding,
+							 guint			 channel,
+							 guint			*levels,
+							 guint			*steps,
+							 guint			*reversals);
 
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmUtilsTransform, gcm_utils_transform_unref)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmUtilsDeltaE, gcm_utils_delta_e_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GcmUtilsBanding, gcm_utils_banding_free)
@@ -18,10 +18,85 @@
 #include "gcm-cell-renderer-profile-text.h"
 #include "gcm-cell-renderer-color.h"
 #include "gcm-cie-widget.h"
+#include "gcm-named-color-index.h"
+#include "gcm-named-color-model.h"
+#include "gcm-palette.h"
+#include "gcm-pyramid.h"
+#include "gcm-tiff.h"
 #include "gcm-trc-widget.h"
 #include "gcm-utils.h"
 #include "gcm-debug.h"
 
+/* the size of the bundled example images */
+#define GCM_VIEWER_PREVIEW_WIDTH_DEFAULT	400	/* logical px */
+/* less spare room than this can be the notebook frame */
+#define GCM_VIEWER_PREVIEW_GROW_MIN		32	/* logical px */
+/* smaller previews are converted in one go */
+#define GCM_VIEWER_PREVIEW_PROGRESSIVE_MIN	(256 * 256)	/* device px */
+#define GCM_VIEWER_PREVIEW_PROGRESSIVE_DIVISOR	8
+/* enough for switching back and forth between a few profiles and images */
+#define GCM_VIEWER_PREVIEW_CACHE_MAX		8
+/* a difference that is obvious side by side */
+#define GCM_VIEWER_PREVIEW_GAMUT_THRESHOLD	5.f	/* CIE94 */
+/* how often partial color difference statistics are shown */
+#define GCM_VIEWER_PREVIEW_STATS_INTERVAL	100	/* ms */
+/* four intents side by side still fit next to the profile list */
+#define GCM_VIEWER_GRID_WIDTH			160	/* logical px */
+/* previews never show more than this, so larger images use a smaller level */
+#define GCM_VIEWER_PREVIEW_SOURCE_MAX		2048	/* px */
+/* each step doubles or halves the size */
+#define GCM_VIEWER_ZOOM_MAX			16.0	/* logical px for each image px */
+/* wide enough to see single steps in the ramps */
+#define GCM_VIEWER_RAMPS_WIDTH			512	/* logical px */
+#define GCM_VIEWER_RAMPS_HEIGHT			160	/* logical px */
+/* deep images are copied out of the mapped file this much at a time */
+#define GCM_VIEWER_LOAD_BAND_SIZE		(1024 * 1024)	/* bytes */
+
+typedef struct {
+	gchar		*key;
+	GdkPixbuf	*pixbuf;
+	gchar		*stats;		/* NULL if not a heatmap */
+} GcmViewerPreviewCached;
+
+typedef struct {
+	GtkWidget	*widget;
+	GtkWidget	*page;		/* notebook page showing widget */
+	GdkPixbuf	*source;	/* shared, never written */
+	guint		 source_index;
+	GdkPixbuf	*dest;		/* reused for each conversion */
+	GdkPixbuf	*dest_low;	/* reused for the first pass */
+	gint		 dest_scale;	/* device pixels per logical pixel */
+	gint		 max_width;	/* logical px */
+	GCancellable	*cancellable;
+	CdIcc		*input;
+	CdIcc		*abstract;
+	CdIcc		*output;
+	CdIcc		*proof;		/* simulate this device instead */
+	gboolean	 gamut_warning;
+	gboolean	 heatmap;	/* show the difference from the source */
+	GtkWidget	*label_stats;	/* NULL if there is no heatmap */
+	GcmUtilsDeltaE	*delta_e;	/* of the current comparison */
+	guint		 stats_id;	/* shows partial results */
+	gboolean	 busy;		/* a thread is writing dest */
+	gboolean	 pending;	/* convert again when done */
+	gboolean	 low_res;	/* the first pass is running */
+	gboolean	 destroyed;
+	gchar		*key;		/* of the current conversion */
+	GQueue		 cache;		/* of GcmViewerPreviewCached, newest first */
+} GcmViewerPreview;
+
+typedef struct {
+	GtkWidget	*images[GCM_UTILS_INTENT_GRID_SIZE];
+	GdkPixbuf	*source;	/* shared, never written */
+	GPtrArray	*dests;		/* of GdkPixbuf, reused */
+	gint		 dest_scale;	/* device pixels per logical pixel */
+	GCancellable	*cancellable;
+	CdIcc		*icc;
+	gboolean	 busy;		/* threads are writing dests */
+	gboolean	 pending;	/* convert again when done */
+	gboolean	 destroyed;
+} GcmViewerGrid;
+
 typedef struct {
 	GtkBuilder	*builder;
 	GtkApplication	*application;
@@ -30,14 +105,31 @@ typedef struct {
 	GtkWidget	*cie_widget;
 	GtkWidget	*trc_widget;
 	GtkWidget	*vcgt_widget;
-	GtkWidget	*preview_widget_input;
-	GtkWidget	*preview_widget_output;
+	GcmViewerPreview *preview_input;
+	GcmViewerPreview *preview_output;
+	GcmViewerPreview *preview_proof;
+	GcmViewerGrid	*grid_intents;
+	CdIcc		*preview_icc;
+	GPtrArray	*example_images;	/* of GcmPyramid, decoded once */
 	guint		 example_index;
+	GCancellable	*load_cancellable;
+	guint		 load_tasks;		/* example and dropped images */
+	GtkWidget	*zoom_area;
+	gdouble		 zoom;			/* logical px for each image px, or 0 to fit */
+	GCancellable	*zoom_cancellable;
+	gboolean	 zoom_busy;		/* converting visible tiles */
+	gboolean	 zoom_failed;		/* do not retry until the transform changes */
+	gboolean	 zoom_transform_pending;	/* tiles wait for the new transform */
+	guint		 zoom_tasks;		/* transforms and tiles still running */
+	GtkWidget	*ramps_image;
+	GCancellable	*ramps_cancellable;
+	guint		 ramps_tasks;		/* including abandoned ones */
 	gchar		*profile_id;
 	gchar		*filename;
 	guint		 xid;
 	const gchar	*lang;
-	GtkListStore	*liststore_nc;
+	GcmNamedColorModel *model_nc;
+	GcmNamedColorIndex *index_nc;
 	GtkListStore	*liststore_metadata;
 	gboolean	 clearing_store;
 } GcmViewerPrivate;
@@ -51,13 +143,6 @@ typedef enum {
 	GCM_VIEWER_PREVIEW_OUTPUT
 } GcmViewerGraphType;
 
-enum {
-	GCM_NAMED_COLORS_COLUMN_TITLE,
-	GCM_NAMED_COLORS_COLUMN_SORT,
-	GCM_NAMED_COLORS_COLUMN_COLOR,
-	GCM_NAMED_COLORS_COLUMN_LAST
-};
-
 enum {
 	GCM_METADATA_COLUMN_KEY,
 	GCM_METADATA_COLUMN_VALUE,
@@ -90,41 +175,1381 @@ gcm_viewer_error_dialog (GcmViewerPrivate *viewer, const gchar *title, const gch
 }
 
 static void
-gcm_viewer_set_example_image (GcmViewerPrivate *viewer, GtkImage *image)
+gcm_viewer_preview_cached_free (GcmViewerPreviewCached *cached)
 {
-	g_autofree gchar *filename;
-	g_autofree gchar *path = NULL;
-	g_autoptr(GdkPixbuf) pixbuf = NULL;
+	g_free (cached->key);
+	g_object_unref (cached->pixbuf);
+	g_free (cached->stats);
+	g_free (cached);
+}
+
+static void
+gcm_viewer_preview_free (GcmViewerPreview *preview)
+{
+	GcmViewerPreviewCached *cached;
+
+	/* the thread still needs the buffers */
+	g_cancellable_cancel (preview->cancellable);
+	if (preview->stats_id != 0) {
+		g_source_remove (preview->stats_id);
+		preview->stats_id = 0;
+	}
+	if (preview->busy) {
+		preview->destroyed = TRUE;
+		return;
+	}
+	g_clear_object (&preview->source);
+	g_clear_object (&preview->dest);
+	g_clear_object (&preview->dest_low);
+	g_clear_object (&preview->cancellable);
+	g_clear_object (&preview->input);
+	g_clear_object (&preview->abstract);
+	g_clear_object (&preview->output);
+	g_clear_object (&preview->proof);
+	if (preview->delta_e != NULL)
+		gcm_utils_delta_e_free (preview->delta_e);
+	while ((cached = g_queue_pop_head (&preview->cache)) != NULL)
+		gcm_viewer_preview_cached_free (cached);
+	g_free (preview->key);
+	g_free (preview);
+}
+
+static GcmViewerPreview *
+gcm_viewer_preview_new (void)
+{
+	GcmViewerPreview *preview = g_new0 (GcmViewerPreview, 1);
+	preview->widget = gtk_image_new ();
+	preview->max_width = GCM_VIEWER_PREVIEW_WIDTH_DEFAULT;
+	preview->cancellable = g_cancellable_new ();
+	return preview;
+}
+
+static void
+gcm_viewer_preview_set_source (GcmViewerPreview *preview,
+			       GdkPixbuf *source,
+			       guint source_index)
+{
+	g_set_object (&preview->source, source);
+	preview->source_index = source_index;
+	gtk_image_set_from_pixbuf (GTK_IMAGE (preview->widget), source);
+}
+
+static void gcm_viewer_preview_start (GcmViewerPreview *preview);
+static void gcm_viewer_preview_get_size (GcmViewerPreview *preview,
+					 gint *width, gint *height, gint *scale);
+static void gcm_viewer_preview_run (GcmViewerPreview *preview, GdkPixbuf *dest);
+
+static void
+gcm_viewer_preview_show (GcmViewerPreview *preview, GdkPixbuf *pixbuf)
+{
+	cairo_surface_t *surface;
+
+	/* the surface is a copy, so dest can be written again */
+	surface = gdk_cairo_surface_create_from_pixbuf (pixbuf,
+							preview->dest_scale,
+							gtk_widget_get_window (preview->widget));
+	gtk_image_set_from_surface (GTK_IMAGE (preview->widget), surface);
+	cairo_surface_destroy (surface);
+}
+
+/* the figure, the profiles in the order they are applied, and the size */
+static gchar *
+gcm_viewer_preview_get_key (GcmViewerPreview *preview, gint width, gint height)
+{
+	CdIcc *profiles[] = { preview->input,
+			      preview->abstract,
+			      preview->output,
+			      preview->proof };
+	GString *key = g_string_new (NULL);
+
+	g_string_append_printf (key, "%u:%ix%i", preview->source_index, width, height);
+	for (guint i = 0; i < G_N_ELEMENTS (profiles); i++) {
+		const gchar *checksum;
+		if (profiles[i] == NULL) {
+			g_string_append (key, ":-");
+			continue;
+		}
+		checksum = cd_icc_get_checksum (profiles[i]);
+		if (checksum == NULL) {
+			g_string_free (key, TRUE);
+			return NULL;
+		}
+		g_string_append_printf (key, ":%s", checksum);
+	}
+	if (preview->gamut_warning)
+		g_string_append (key, ":gamut");
+	if (preview->heatmap)
+		g_string_append (key, ":heatmap");
+	return g_string_free (key, FALSE);
+}
+
+static GcmViewerPreviewCached *
+gcm_viewer_preview_cache_lookup (GcmViewerPreview *preview, const gchar *key)
+{
+	if (key == NULL)
+		return NULL;
+	for (GList *l = preview->cache.head; l != NULL; l = l->next) {
+		GcmViewerPreviewCached *cached = l->data;
+		if (g_strcmp0 (cached->key, key) != 0)
+			continue;
+
+		/* the least recently shown is dropped first */
+		g_queue_unlink (&preview->cache, l);
+		g_queue_push_head_link (&preview->cache, l);
+		return cached;
+	}
+	return NULL;
+}
+
+static void
+gcm_viewer_preview_cache_add (GcmViewerPreview *preview, const gchar *stats)
+{
+	GcmViewerPreviewCached *cached;
+
+	if (preview->key == NULL)
+		return;
+	cached = g_new0 (GcmViewerPreviewCached, 1);
+	cached->key = g_strdup (preview->key);
+	cached->pixbuf = gdk_pixbuf_copy (preview->dest);
+	cached->stats = g_strdup (stats);
+	g_queue_push_head (&preview->cache, cached);
+	while (preview->cache.length > GCM_VIEWER_PREVIEW_CACHE_MAX) {
+		cached = g_queue_pop_tail (&preview->cache);
+		gcm_viewer_preview_cached_free (cached);
+	}
+}
+
+static void
+gcm_viewer_preview_set_stats (GcmViewerPreview *preview, const gchar *stats)
+{
+	if (preview->label_stats == NULL)
+		return;
+	gtk_label_set_text (GTK_LABEL (preview->label_stats), stats != NULL ? stats : "");
+	gtk_widget_set_visible (preview->label_stats, stats != NULL);
+}
+
+static gchar *
+gcm_viewer_preview_get_stats (GcmViewerPreview *preview)
+{
+	gdouble mean;
+	gdouble p95;
+	gdouble max;
+
+	if (!gcm_utils_delta_e_get_stats (preview->delta_e, &mean, &p95, &max))
+		return NULL;
+	/* TRANSLATORS: the CIEDE2000 color difference between the example
+	 * image and the same image converted to the profile and back, where
+	 * 95% of pixels are closer than the second value */
+	return g_strdup_printf (_("Color difference: mean %.2f, 95%% below %.1f, largest %.2f"),
+				mean, p95, max);
+}
+
+/* shows an earlier conversion for the same figure, profiles and size */
+static gboolean
+gcm_viewer_preview_show_cached (GcmViewerPreview *preview)
+{
+	gint width;
+	gint height;
+	GcmViewerPreviewCached *cached;
+
+	gcm_viewer_preview_get_size (preview, &width, &height, &preview->dest_scale);
+	g_free (preview->key);
+	preview->key = gcm_viewer_preview_get_key (preview, width, height);
+	cached = gcm_viewer_preview_cache_lookup (preview, preview->key);
+	if (cached == NULL)
+		return FALSE;
+	gcm_viewer_preview_show (preview, cached->pixbuf);
+	gcm_viewer_preview_set_stats (preview, cached->stats);
+	return TRUE;
+}
+
+/* the statistics are updated as each tile is compared */
+static gboolean
+gcm_viewer_preview_stats_cb (gpointer user_data)
+{
+	GcmViewerPreview *preview = (GcmViewerPreview *) user_data;
+	g_autofree gchar *stats = gcm_viewer_preview_get_stats (preview);
+	if (stats != NULL)
+		gcm_viewer_preview_set_stats (preview, stats);
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+gcm_viewer_preview_compared_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GcmViewerPreview *preview = (GcmViewerPreview *) user_data;
+	g_autofree gchar *stats = NULL;
+	g_autoptr(GError) error = NULL;
+
+	preview->busy = FALSE;
+	if (preview->stats_id != 0) {
+		g_source_remove (preview->stats_id);
+		preview->stats_id = 0;
+	}
+	if (preview->destroyed) {
+		gcm_viewer_preview_free (preview);
+		return;
+	}
+	if (preview->pending) {
+		preview->pending = FALSE;
+		gcm_viewer_preview_start (preview);
+		return;
+	}
+	if (!gcm_utils_pixbuf_convert_finish (res, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to compare preview: %s", error->message);
+		return;
+	}
+	stats = gcm_viewer_preview_get_stats (preview);
+	gcm_viewer_preview_set_stats (preview, stats);
+	gcm_viewer_preview_show (preview, preview->dest);
+	gcm_viewer_preview_cache_add (preview, stats);
+}
+
+/* replaces the converted image in dest with the difference between the
+ * source and the source converted to the profile and back */
+static void
+gcm_viewer_preview_compare (GcmViewerPreview *preview)
+{
+	CdIcc *icc = preview->input;
+
+	if (icc == NULL)
+		icc = preview->abstract;
+	if (icc == NULL)
+		icc = preview->output;
+	if (preview->delta_e != NULL)
+		gcm_utils_delta_e_free (preview->delta_e);
+	preview->delta_e = gcm_utils_delta_e_new ();
+	preview->busy = TRUE;
+	preview->stats_id = g_timeout_add (GCM_VIEWER_PREVIEW_STATS_INTERVAL,
+					   gcm_viewer_preview_stats_cb, preview);
+	gcm_utils_pixbuf_delta_e_async (preview->source,
+					preview->dest,
+					preview->dest,
+					icc,
+					preview->delta_e,
+					preview->cancellable,
+					gcm_viewer_preview_compared_cb,
+					preview);
+}
+
+static void
+gcm_viewer_preview_converted_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GcmViewerPreview *preview = (GcmViewerPreview *) user_data;
+	g_autoptr(GError) error = NULL;
+
+	preview->busy = FALSE;
+	if (preview->destroyed) {
+		gcm_viewer_preview_free (preview);
+		return;
+	}
+
+	/* the profile or image has changed since, so dest can be reused */
+	if (preview->pending) {
+		preview->pending = FALSE;
+		gcm_viewer_preview_start (preview);
+		return;
+	}
+	if (!gcm_utils_pixbuf_convert_finish (res, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to convert preview: %s", error->message);
+		return;
+	}
+
+	/* show the first pass scaled up, then refine it in the background;
+	 * a new selection cancels the refinement like any other conversion */
+	if (preview->low_res) {
+		gint width = gdk_pixbuf_get_width (preview->dest);
+		gint height = gdk_pixbuf_get_height (preview->dest);
+		gdk_pixbuf_scale (preview->dest_low, preview->dest,
+				  0, 0, width, height, 0.f, 0.f,
+				  (gdouble) width / gdk_pixbuf_get_width (preview->dest_low),
+				  (gdouble) height / gdk_pixbuf_get_height (preview->dest_low),
+				  GDK_INTERP_BILINEAR);
+		gcm_viewer_preview_show (preview, preview->dest);
+		preview->low_res = FALSE;
+		gcm_viewer_preview_run (preview, preview->dest);
+		return;
+	}
+	gcm_viewer_preview_show (preview, preview->dest);
+	if (preview->heatmap) {
+		gcm_viewer_preview_compare (preview);
+		return;
+	}
+	gcm_viewer_preview_cache_add (preview, NULL);
+}
+
+/* only convert the pixels that are going to be shown */
+static void
+gcm_viewer_preview_get_size (GcmViewerPreview *preview,
+			     gint *width, gint *height, gint *scale)
+{
+	gint src_width = gdk_pixbuf_get_width (preview->source);
+	gint src_height = gdk_pixbuf_get_height (preview->source);
+	gint scale_factor = gtk_widget_get_scale_factor (preview->widget);
+	gint logical = MIN (src_width, preview->max_width);
+
+	/* use every device pixel if the source has enough detail */
+	if (src_width >= logical * scale_factor) {
+		*width = logical * scale_factor;
+		*scale = scale_factor;
+	} else {
+		*width = logical;
+		*scale = 1;
+	}
+	*height = MAX ((gint) ((gint64) src_height * *width / src_width), 1);
+}
+
+static void
+gcm_viewer_preview_start (GcmViewerPreview *preview)
+{
+	gint width;
+	gint height;
+
+	if (gcm_viewer_preview_show_cached (preview))
+		return;
+	gcm_viewer_preview_set_stats (preview, NULL);
+
+	/* only allocate when the display size changes */
+	gcm_viewer_preview_get_size (preview, &width, &height, &preview->dest_scale);
+	if (preview->dest == NULL ||
+	    gdk_pixbuf_get_width (preview->dest) != width ||
+	    gdk_pixbuf_get_height (preview->dest) != height ||
+	    gdk_pixbuf_get_has_alpha (preview->dest) != gdk_pixbuf_get_has_alpha (preview->source)) {
+		g_clear_object (&preview->dest);
+		preview->dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
+						gdk_pixbuf_get_has_alpha (preview->source), 8,
+						width, height);
+	}
+
+	/* the first pass is so small it is shown in the next frame */
+	preview->low_res = width * height >= GCM_VIEWER_PREVIEW_PROGRESSIVE_MIN;
+	if (!preview->low_res) {
+		gcm_viewer_preview_run (preview, preview->dest);
+		return;
+	}
+	width = MAX (width / GCM_VIEWER_PREVIEW_PROGRESSIVE_DIVISOR, 1);
+	height = MAX (height / GCM_VIEWER_PREVIEW_PROGRESSIVE_DIVISOR, 1);
+	if (preview->dest_low == NULL ||
+	    gdk_pixbuf_get_width (preview->dest_low) != width ||
+	    gdk_pixbuf_get_height (preview->dest_low) != height ||
+	    gdk_pixbuf_get_has_alpha (preview->dest_low) != gdk_pixbuf_get_has_alpha (preview->source)) {
+		g_clear_object (&preview->dest_low);
+		preview->dest_low = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
+						    gdk_pixbuf_get_has_alpha (preview->source), 8,
+						    width, height);
+	}
+	gcm_viewer_preview_run (preview, preview->dest_low);
+}
+
+static void
+gcm_viewer_preview_run (GcmViewerPreview *preview, GdkPixbuf *dest)
+{
+	preview->busy = TRUE;
+	if (preview->proof != NULL) {
+		gcm_utils_pixbuf_proof_async (preview->source, dest,
+					      preview->proof,
+					      CD_RENDERING_INTENT_PERCEPTUAL,
+					      preview->gamut_warning ?
+						GCM_VIEWER_PREVIEW_GAMUT_THRESHOLD : 0.f,
+					      NULL,
+					      preview->cancellable,
+					      gcm_viewer_preview_converted_cb,
+					      preview);
+		return;
+	}
+	gcm_utils_pixbuf_convert_preview_async (preview->source, dest,
+						preview->input,
+						preview->abstract,
+						preview->output,
+						CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+						preview->cancellable,
+						gcm_viewer_preview_converted_cb,
+						preview);
+}
+
+static void
+gcm_viewer_preview_restart (GcmViewerPreview *preview)
+{
+	/* abandon any conversion for the previous selection */
+	g_cancellable_cancel (preview->cancellable);
+	g_object_unref (preview->cancellable);
+	preview->cancellable = g_cancellable_new ();
+
+	/* only one thread can write to dest at a time, but an earlier
+	 * conversion can be shown without waiting for it */
+	if (preview->busy) {
+		preview->pending = !gcm_viewer_preview_show_cached (preview);
+		return;
+	}
+	gcm_viewer_preview_start (preview);
+}
+
+static void
+gcm_viewer_preview_convert (GcmViewerPreview *preview,
+			    CdIcc *input,
+			    CdIcc *abstract,
+			    CdIcc *output)
+{
+	if (preview->source == NULL)
+		return;
+	g_set_object (&preview->input, input);
+	g_set_object (&preview->abstract, abstract);
+	g_set_object (&preview->output, output);
+	gcm_viewer_preview_restart (preview);
+}
+
+/* shows how the sRGB source would look when reproduced by @proof */
+static void
+gcm_viewer_preview_proof (GcmViewerPreview *preview,
+			  CdIcc *proof,
+			  gboolean gamut_warning)
+{
+	if (preview->source == NULL)
+		return;
+	g_set_object (&preview->proof, proof);
+	preview->gamut_warning = gamut_warning;
+	gcm_viewer_preview_restart (preview);
+}
+
+static void
+gcm_viewer_grid_free (GcmViewerGrid *grid)
+{
+	/* the threads still need the buffers */
+	g_cancellable_cancel (grid->cancellable);
+	if (grid->busy) {
+		grid->destroyed = TRUE;
+		return;
+	}
+	g_clear_object (&grid->source);
+	g_clear_object (&grid->cancellable);
+	g_clear_object (&grid->icc);
+	if (grid->dests != NULL)
+		g_ptr_array_unref (grid->dests);
+	g_free (grid);
+}
+
+static const gchar *
+gcm_viewer_grid_get_label (guint idx)
+{
+	CdRenderingIntent intent;
+	gboolean bpc;
+
+	gcm_utils_intent_grid_get_cell (idx, &intent, &bpc);
+	switch (intent) {
+	case CD_RENDERING_INTENT_PERCEPTUAL:
+		/* TRANSLATORS: rendering intent, BPC is black point compensation */
+		return bpc ? _("Perceptual with BPC") : _("Perceptual");
+	case CD_RENDERING_INTENT_RELATIVE_COLORIMETRIC:
+		/* TRANSLATORS: rendering intent, BPC is black point compensation */
+		return bpc ? _("Relative with BPC") : _("Relative");
+	case CD_RENDERING_INTENT_SATURATION:
+		/* TRANSLATORS: rendering intent, BPC is black point compensation */
+		return bpc ? _("Saturation with BPC") : _("Saturation");
+	default:
+		/* TRANSLATORS: rendering intent, BPC is black point compensation */
+		return bpc ? _("Absolute with BPC") : _("Absolute");
+	}
+}
+
+/* each intent is a column, with BPC underneath */
+static GcmViewerGrid *
+gcm_viewer_grid_new (GtkGrid *widget)
+{
+	GcmViewerGrid *grid = g_new0 (GcmViewerGrid, 1);
+	grid->cancellable = g_cancellable_new ();
+	for (guint i = 0; i < GCM_UTILS_INTENT_GRID_SIZE; i++) {
+		GtkWidget *box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 3);
+		GtkWidget *label = gtk_label_new (gcm_viewer_grid_get_label (i));
+		grid->images[i] = gtk_image_new ();
+		gtk_box_pack_start (GTK_BOX (box), grid->images[i], FALSE, FALSE, 0);
+		gtk_box_pack_start (GTK_BOX (box), label, FALSE, FALSE, 0);
+		gtk_grid_attach (widget, box, (gint) i / 2, (gint) i % 2, 1, 1);
+		gtk_widget_show_all (box);
+	}
+	return grid;
+}
+
+static void gcm_viewer_grid_start (GcmViewerGrid *grid);
+
+static void
+gcm_viewer_grid_converted_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GcmViewerGrid *grid = (GcmViewerGrid *) user_data;
+	g_autoptr(GError) error = NULL;
+
+	grid->busy = FALSE;
+	if (grid->destroyed) {
+		gcm_viewer_grid_free (grid);
+		return;
+	}
+	if (grid->pending) {
+		grid->pending = FALSE;
+		gcm_viewer_grid_start (grid);
+		return;
+	}
+	if (!gcm_utils_pixbuf_convert_finish (res, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to convert intents: %s", error->message);
+		return;
+	}
+	for (guint i = 0; i < GCM_UTILS_INTENT_GRID_SIZE; i++) {
+		cairo_surface_t *surface;
+		surface = gdk_cairo_surface_create_from_pixbuf (g_ptr_array_index (grid->dests, i),
+								grid->dest_scale,
+								gtk_widget_get_window (grid->images[i]));
+		gtk_image_set_from_surface (GTK_IMAGE (grid->images[i]), surface);
+		cairo_surface_destroy (surface);
+	}
+}
+
+static void
+gcm_viewer_grid_start (GcmViewerGrid *grid)
+{
+	GdkPixbuf *dest;
+	gint src_width = gdk_pixbuf_get_width (grid->source);
+	gint width = MIN (src_width, GCM_VIEWER_GRID_WIDTH);
+	gint height;
+	gint scale = gtk_widget_get_scale_factor (grid->images[0]);
+
+	/* use every device pixel if the source has enough detail */
+	grid->dest_scale = 1;
+	if (src_width >= width * scale) {
+		width *= scale;
+		grid->dest_scale = scale;
+	}
+	height = MAX ((gint) ((gint64) gdk_pixbuf_get_height (grid->source) * width / src_width), 1);
+
+	/* only allocate when the display size changes */
+	dest = grid->dests != NULL ? g_ptr_array_index (grid->dests, 0) : NULL;
+	if (dest == NULL ||
+	    gdk_pixbuf_get_width (dest) != width ||
+	    gdk_pixbuf_get_height (dest) != height ||
+	    gdk_pixbuf_get_has_alpha (dest) != gdk_pixbuf_get_has_alpha (grid->source)) {
+		if (grid->dests != NULL)
+			g_ptr_array_unref (grid->dests);
+		grid->dests = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		for (guint i = 0; i < GCM_UTILS_INTENT_GRID_SIZE; i++) {
+			g_ptr_array_add (grid->dests,
+					 gdk_pixbuf_new (GDK_COLORSPACE_RGB,
+							 gdk_pixbuf_get_has_alpha (grid->source), 8,
+							 width, height));
+		}
+	}
+
+	/* sRGB -> profile -> sRGB */
+	grid->busy = TRUE;
+	gcm_utils_pixbuf_convert_grid_async (grid->source, grid->dests,
+					     NULL, grid->icc, NULL,
+					     grid->cancellable,
+					     gcm_viewer_grid_converted_cb,
+					     grid);
+}
+
+static void
+gcm_viewer_grid_convert (GcmViewerGrid *grid, GdkPixbuf *source, CdIcc *icc)
+{
+	if (source == NULL)
+		return;
+	g_set_object (&grid->source, source);
+	g_set_object (&grid->icc, icc);
+
+	/* abandon any conversion for the previous selection */
+	g_cancellable_cancel (grid->cancellable);
+	g_object_unref (grid->cancellable);
+	grid->cancellable = g_cancellable_new ();
+	if (grid->busy) {
+		grid->pending = TRUE;
+		return;
+	}
+	gcm_viewer_grid_start (grid);
+}
+
+static GcmPyramid *
+gcm_viewer_get_example_image (GcmViewerPrivate *viewer)
+{
+	/* still loading */
+	if (viewer->example_images == NULL || viewer->example_images->len == 0)
+		return NULL;
+	return g_ptr_array_index (viewer->example_images, viewer->example_index);
+}
+
+/* the previews are never larger than this, so huge images are not rescaled
+ * from the full size for every conversion */
+static GdkPixbuf *
+gcm_viewer_get_example_pixbuf (GcmViewerPrivate *viewer)
+{
+	GcmPyramid *pyramid = gcm_viewer_get_example_image (viewer);
+	guint level;
+
+	if (pyramid == NULL)
+		return NULL;
+	level = gcm_pyramid_get_level_for_width (pyramid, GCM_VIEWER_PREVIEW_SOURCE_MAX);
+	return gcm_pyramid_get_level (pyramid, level);
+}
+
+static gdouble
+gcm_viewer_zoom_get_scale (GcmViewerPrivate *viewer)
+{
+	GcmPyramid *pyramid = gcm_viewer_get_example_image (viewer);
+	GdkPixbuf *source;
+	gdouble scale_x;
+	gdouble scale_y;
+
+	if (viewer->zoom > 0)
+		return viewer->zoom;
+
+	/* fit the room the scrolled window gives, but never enlarge */
+	source = gcm_pyramid_get_level (pyramid, 0);
+	scale_x = (gdouble) gtk_widget_get_allocated_width (viewer->zoom_area) /
+		  gdk_pixbuf_get_width (source);
+	scale_y = (gdouble) gtk_widget_get_allocated_height (viewer->zoom_area) /
+		  gdk_pixbuf_get_height (source);
+	return CLAMP (MIN (scale_x, scale_y), 1.0 / gdk_pixbuf_get_width (source), 1.0);
+}
+
+static void
+gcm_viewer_zoom_update_size (GcmViewerPrivate *viewer)
+{
+	GcmPyramid *pyramid = gcm_viewer_get_example_image (viewer);
+	GdkPixbuf *source;
+
+	if (pyramid == NULL)
+		return;
+
+	/* when fitting the drawing area gets all the room there is */
+	if (viewer->zoom > 0) {
+		source = gcm_pyramid_get_level (pyramid, 0);
+		gtk_widget_set_size_request (viewer->zoom_area,
+					     ceil (gdk_pixbuf_get_width (source) * viewer->zoom),
+					     ceil (gdk_pixbuf_get_height (source) * viewer->zoom));
+		gtk_widget_set_halign (viewer->zoom_area, GTK_ALIGN_CENTER);
+		gtk_widget_set_valign (viewer->zoom_area, GTK_ALIGN_CENTER);
+	} else {
+		gtk_widget_set_size_request (viewer->zoom_area, -1, -1);
+		gtk_widget_set_halign (viewer->zoom_area, GTK_ALIGN_FILL);
+		gtk_widget_set_valign (viewer->zoom_area, GTK_ALIGN_FILL);
+	}
+	gtk_widget_queue_draw (viewer->zoom_area);
+}
+
+static void
+gcm_viewer_zoom_converted_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GcmViewerPrivate *viewer = (GcmViewerPrivate *) user_data;
+	g_autoptr(GError) error = NULL;
+
+	/* the image or profile changed, or the viewer is closing */
+	viewer->zoom_tasks--;
+	if (!gcm_pyramid_convert_finish (res, &error)) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			return;
+		g_warning ("failed to convert tiles: %s", error->message);
+		viewer->zoom_failed = TRUE;
+	}
+	viewer->zoom_busy = FALSE;
+
+	/* the view may have scrolled to more tiles in the meantime */
+	gtk_widget_queue_draw (viewer->zoom_area);
+}
+
+static gboolean
+gcm_viewer_zoom_draw_cb (GtkWidget *widget, cairo_t *cr, GcmViewerPrivate *viewer)
+{
+	GcmPyramid *pyramid = gcm_viewer_get_example_image (viewer);
+	GdkPixbuf *level_pixbuf;
+	GdkRectangle clip;
+	GdkRectangle area;
+	GdkRectangle bounds = { 0, 0, 0, 0 };
+	gboolean missing = FALSE;
+	gdouble level_scale;
+	gdouble zoom;
+	gint scale = gtk_widget_get_scale_factor (widget);
+	guint level;
+
+	if (pyramid == NULL || !gdk_cairo_get_clip_rectangle (cr, &clip))
+		return FALSE;
+
+	/* the smallest level with a pixel for every device pixel */
+	zoom = gcm_viewer_zoom_get_scale (viewer);
+	level = gcm_pyramid_get_level_for_scale (pyramid, zoom * scale);
+	level_pixbuf = gcm_pyramid_get_level (pyramid, level);
+	level_scale = zoom * gdk_pixbuf_get_width (gcm_pyramid_get_level (pyramid, 0)) /
+		      gdk_pixbuf_get_width (level_pixbuf);
+
+	/* only the exposed part of the level */
+	bounds.width = gdk_pixbuf_get_width (level_pixbuf);
+	bounds.height = gdk_pixbuf_get_height (level_pixbuf);
+	area.x = floor (clip.x / level_scale);
+	area.y = floor (clip.y / level_scale);
+	area.width = ceil ((clip.x + clip.width) / level_scale) - area.x;
+	area.height = ceil ((clip.y + clip.height) / level_scale) - area.y;
+	if (!gdk_rectangle_intersect (&area, &bounds, &area))
+		return FALSE;
+
+	cairo_save (cr);
+	cairo_scale (cr, level_scale, level_scale);
+	for (gint ty = area.y / GCM_PYRAMID_TILE_SIZE;
+	     ty * GCM_PYRAMID_TILE_SIZE < area.y + area.height; ty++) {
+		for (gint tx = area.x / GCM_PYRAMID_TILE_SIZE;
+		     tx * GCM_PYRAMID_TILE_SIZE < area.x + area.width; tx++) {
+			g_autoptr(GdkPixbuf) tile = NULL;
+
+			tile = gcm_pyramid_get_tile (pyramid, level, tx, ty);
+			if (tile == NULL) {
+				missing = TRUE;
+				continue;
+			}
+			gdk_cairo_set_source_pixbuf (cr, tile,
+						     tx * GCM_PYRAMID_TILE_SIZE,
+						     ty * GCM_PYRAMID_TILE_SIZE);
+
+			/* show each pixel as a sharp square when zoomed in */
+			if (level_scale * scale > 1.0)
+				cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_NEAREST);
+			cairo_rectangle (cr,
+					 tx * GCM_PYRAMID_TILE_SIZE,
+					 ty * GCM_PYRAMID_TILE_SIZE,
+					 gdk_pixbuf_get_width (tile),
+					 gdk_pixbuf_get_height (tile));
+			cairo_fill (cr);
+		}
+	}
+	cairo_restore (cr);
+
+	/* convert what is shown and draw again when done */
+	if (missing && !viewer->zoom_busy && !viewer->zoom_failed &&
+	    !viewer->zoom_transform_pending) {
+		viewer->zoom_busy = TRUE;
+		viewer->zoom_tasks++;
+		gcm_pyramid_convert_async (pyramid, level, &area,
+					   viewer->zoom_cancellable,
+					   gcm_viewer_zoom_converted_cb,
+					   viewer);
+	}
+	return FALSE;
+}
+
+typedef struct {
+	GcmPyramid	*pyramid;
+	CdIcc		*icc;
+} GcmViewerZoomHelper;
+
+static void
+gcm_viewer_zoom_helper_free (GcmViewerZoomHelper *helper)
+{
+	gcm_pyramid_unref (helper->pyramid);
+	g_object_unref (helper->icc);
+	g_free (helper);
+}
+
+static void
+gcm_viewer_zoom_transform_thread_cb (GTask *task,
+				     gpointer source_object,
+				     gpointer task_data,
+				     GCancellable *cancellable)
+{
+	GcmViewerZoomHelper *helper = (GcmViewerZoomHelper *) task_data;
+	GdkPixbuf *source = gcm_pyramid_get_level (helper->pyramid, 0);
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	CdIcc *input = NULL;
+	CdIcc *abstract = NULL;
+	guint32 format;
+	g_autoptr(GError) error = NULL;
+
+	/* as the image would look if it was encoded with the profile, and
+	 * round trip other colorspaces like the other previews; this is the
+	 * view for inspecting single pixels, so the exact transform is used
+	 * rather than the lookup table, and only the visible tiles are
+	 * converted anyway */
+	if (cd_icc_get_colorspace (helper->icc) == CD_COLORSPACE_RGB)
+		input = helper->icc;
+	else
+		abstract = helper->icc;
+	format = gcm_utils_get_pixel_format_for_depth (8, FALSE,
+						       gdk_pixbuf_get_has_alpha (source));
+	transform = gcm_utils_transform_new (input, abstract, NULL,
+					     CD_RENDERING_INTENT_PERCEPTUAL,
+					     format, format, FALSE, &error);
+	if (transform == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	g_task_return_pointer (task, g_steal_pointer (&transform),
+			       (GDestroyNotify) gcm_utils_transform_unref);
+}
+
+static void
+gcm_viewer_zoom_transform_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GcmViewerPrivate *viewer = (GcmViewerPrivate *) user_data;
+	GcmViewerZoomHelper *helper = g_task_get_task_data (G_TASK (res));
+	g_autoptr(GcmUtilsTransform) transform = NULL;
+	g_autoptr(GError) error = NULL;
+
+	viewer->zoom_tasks--;
+	transform = g_task_propagate_pointer (G_TASK (res), &error);
+	if (transform == NULL) {
+		/* a newer transform is being built, or the viewer is closing */
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			return;
+		g_warning ("failed to create zoom transform: %s", error->message);
+		viewer->zoom_transform_pending = FALSE;
+		viewer->zoom_failed = TRUE;
+		return;
+	}
+
+	/* tiles from the previous transform are dropped, and any failure
+	 * was with that transform too */
+	gcm_pyramid_set_transform (helper->pyramid, transform);
+	viewer->zoom_transform_pending = FALSE;
+	viewer->zoom_failed = FALSE;
+	gtk_widget_queue_draw (viewer->zoom_area);
+}
+
+static void
+gcm_viewer_zoom_convert (GcmViewerPrivate *viewer, CdIcc *icc)
+{
+	GcmPyramid *pyramid = gcm_viewer_get_example_image (viewer);
+	GcmViewerZoomHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	if (pyramid == NULL)
+		return;
+
+	/* abandon any tiles for the previous selection */
+	g_cancellable_cancel (viewer->zoom_cancellable);
+	g_object_unref (viewer->zoom_cancellable);
+	viewer->zoom_cancellable = g_cancellable_new ();
+	viewer->zoom_busy = FALSE;
+	viewer->zoom_failed = FALSE;
+	viewer->zoom_transform_pending = TRUE;
+
+	/* building the transform can take longer than a frame */
+	helper = g_new0 (GcmViewerZoomHelper, 1);
+	helper->pyramid = gcm_pyramid_ref (pyramid);
+	helper->icc = g_object_ref (icc);
+	viewer->zoom_tasks++;
+	task = g_task_new (NULL, viewer->zoom_cancellable,
+			   gcm_viewer_zoom_transform_cb, viewer);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gcm_viewer_zoom_helper_free);
+	g_task_run_in_thread (task, gcm_viewer_zoom_transform_thread_cb);
+}
+
+static void
+gcm_viewer_zoom_set (GcmViewerPrivate *viewer, gdouble zoom)
+{
+	viewer->zoom = zoom;
+	gcm_viewer_zoom_update_size (viewer);
+}
+
+static void
+gcm_viewer_zoom_in_cb (GtkWidget *widget, GcmViewerPrivate *viewer)
+{
+	if (gcm_viewer_get_example_image (viewer) == NULL)
+		return;
+	gcm_viewer_zoom_set (viewer, MIN (gcm_viewer_zoom_get_scale (viewer) * 2,
+					  GCM_VIEWER_ZOOM_MAX));
+}
+
+static void
+gcm_viewer_zoom_out_cb (GtkWidget *widget, GcmViewerPrivate *viewer)
+{
+	GdkPixbuf *source;
+
+	if (gcm_viewer_get_example_image (viewer) == NULL)
+		return;
+
+	/* no smaller than one pixel wide */
+	source = gcm_pyramid_get_level (gcm_viewer_get_example_image (viewer), 0);
+	gcm_viewer_zoom_set (viewer, MAX (gcm_viewer_zoom_get_scale (viewer) / 2,
+					  1.0 / gdk_pixbuf_get_width (source)));
+}
+
+static void
+gcm_viewer_zoom_fit_cb (GtkWidget *widget, GcmViewerPrivate *viewer)
+{
+	gcm_viewer_zoom_set (viewer, 0);
+}
+
+static void
+gcm_viewer_zoom_original_cb (GtkWidget *widget, GcmViewerPrivate *viewer)
+{
+	/* one image pixel for each device pixel */
+	gcm_viewer_zoom_set (viewer, 1.0 / gtk_widget_get_scale_factor (widget));
+}
+
+typedef struct {
+	GcmViewerPrivate	*viewer;
+	GdkPixbuf		*pixbuf;
+	GcmUtilsBanding		*banding;
+	gint			 scale;
+} GcmViewerRampsHelper;
+
+static void
+gcm_viewer_ramps_helper_free (GcmViewerRampsHelper *helper)
+{
+	g_object_unref (helper->pixbuf);
+	gcm_utils_banding_free (helper->banding);
+	g_free (helper);
+}
+
+static void
+gcm_viewer_ramps_converted_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GcmViewerRampsHelper *helper = (GcmViewerRampsHelper *) user_data;
+	GcmViewerPrivate *viewer = helper->viewer;
+	GtkLabel *label;
+	cairo_surface_t *surface;
+	const gchar *channels[] = {
+		/* TRANSLATORS: a color channel */
+		_("Red"),
+		/* TRANSLATORS: a color channel */
+		_("Green"),
+		/* TRANSLATORS: a color channel */
+		_("Blue") };
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	/* the profile changed, or the viewer is closing */
+	viewer->ramps_tasks--;
+	if (!gcm_utils_pixbuf_convert_finish (res, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to convert ramps: %s", error->message);
+		gcm_viewer_ramps_helper_free (helper);
+		return;
+	}
+	surface = gdk_cairo_surface_create_from_pixbuf (helper->pixbuf, helper->scale,
+							gtk_widget_get_window (viewer->ramps_image));
+	gtk_image_set_from_surface (GTK_IMAGE (viewer->ramps_image), surface);
+	cairo_surface_destroy (surface);
+
+	for (guint c = 0; c < 3; c++) {
+		guint levels;
+		guint steps;
+		guint reversals;
+		if (!gcm_utils_banding_get_stats (helper->banding, c, &levels, &steps, &reversals))
+			continue;
+		if (str->len > 0)
+			g_string_append (str, "\n");
+		/* TRANSLATORS: the first is a color channel, then the number of
+		 * distinct output levels, quantization steps and places the
+		 * output falls in the gradients */
+		g_string_append_printf (str, _("%s: %u levels, %u steps, %u reversals"),
+					channels[c], levels, steps, reversals);
+	}
+	label = GTK_LABEL (gtk_builder_get_object (viewer->builder, "label_ramps"));
+	gtk_label_set_label (label, str->str);
+	gcm_viewer_ramps_helper_free (helper);
+}
+
+static void
+gcm_viewer_ramps_convert (GcmViewerPrivate *viewer, CdIcc *icc)
+{
+	GcmViewerRampsHelper *helper;
+	GtkLabel *label;
+
+	/* abandon the ramps for the previous selection */
+	g_cancellable_cancel (viewer->ramps_cancellable);
+	g_object_unref (viewer->ramps_cancellable);
+	viewer->ramps_cancellable = g_cancellable_new ();
+
+	/* do not show the results for another profile in the meantime */
+	gtk_image_clear (GTK_IMAGE (viewer->ramps_image));
+	label = GTK_LABEL (gtk_builder_get_object (viewer->builder, "label_ramps"));
+	gtk_label_set_label (label, "");
+
+	/* use every device pixel, the ramps are always the same size */
+	helper = g_new0 (GcmViewerRampsHelper, 1);
+	helper->viewer = viewer;
+	helper->scale = gtk_widget_get_scale_factor (viewer->ramps_image);
+	helper->pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+					 GCM_VIEWER_RAMPS_WIDTH * helper->scale,
+					 GCM_VIEWER_RAMPS_HEIGHT * helper->scale);
+	helper->banding = gcm_utils_banding_new ();
+	viewer->ramps_tasks++;
+	gcm_utils_pixbuf_ramps_async (helper->pixbuf, icc, helper->banding,
+				      viewer->ramps_cancellable,
+				      gcm_viewer_ramps_converted_cb,
+				      helper);
+}
+
+static void
+gcm_viewer_set_example_image (GcmViewerPrivate *viewer)
+{
+	GdkPixbuf *pixbuf;
+
+	/* still loading */
+	pixbuf = gcm_viewer_get_example_pixbuf (viewer);
+	if (pixbuf == NULL)
+		return;
+
+	/* all previews are converted from the same image */
+	gcm_viewer_preview_set_source (viewer->preview_input, pixbuf, viewer->example_index);
+	gcm_viewer_preview_set_source (viewer->preview_output, pixbuf, viewer->example_index);
+	gcm_viewer_preview_set_source (viewer->preview_proof, pixbuf, viewer->example_index);
+
+	/* a new image starts out fitting the window */
+	gcm_viewer_zoom_set (viewer, 0);
+}
+
+static void
+gcm_viewer_update_previews (GcmViewerPrivate *viewer)
+{
+	CdIcc *icc = viewer->preview_icc;
+	GtkToggleButton *toggle;
+
+	if (icc == NULL)
+		return;
+	if (cd_icc_get_kind (icc) == CD_PROFILE_KIND_NAMED_COLOR)
+		return;
+	if (cd_icc_get_kind (icc) != CD_PROFILE_KIND_DEVICELINK) {
+		gcm_viewer_grid_convert (viewer->grid_intents,
+					 gcm_viewer_get_example_pixbuf (viewer),
+					 icc);
+		gcm_viewer_zoom_convert (viewer, icc);
+	}
+	if (cd_icc_get_kind (icc) == CD_PROFILE_KIND_OUTPUT_DEVICE) {
+		/* sRGB -> profile -> sRGB, with out of gamut colors marked */
+		toggle = GTK_TOGGLE_BUTTON (gtk_builder_get_object (viewer->builder,
+								    "checkbutton_gamut_warning"));
+		gcm_viewer_preview_proof (viewer->preview_proof, icc,
+					  gtk_toggle_button_get_active (toggle));
+	}
+	if (cd_icc_get_kind (icc) == CD_PROFILE_KIND_DISPLAY_DEVICE &&
+	    cd_icc_get_colorspace (icc) == CD_COLORSPACE_RGB) {
+		/* sRGB -> profile -> VCGT, in 16 bits */
+		gcm_viewer_ramps_convert (viewer, icc);
+	}
+	if (cd_icc_get_colorspace (icc) == CD_COLORSPACE_RGB) {
+		/* profile -> sRGB */
+		gcm_viewer_preview_convert (viewer->preview_input, icc, NULL, NULL);
+		/* sRGB -> profile */
+		gcm_viewer_preview_convert (viewer->preview_output, NULL, NULL, icc);
+	} else if (cd_icc_get_colorspace (icc) == CD_COLORSPACE_LAB) {
+		/* sRGB -> profile -> sRGB */
+		gcm_viewer_preview_convert (viewer->preview_input, NULL, icc, NULL);
+	}
+}
+
+static void
+gcm_viewer_load_example_images_thread_cb (GTask *task,
+					  gpointer source_object,
+					  gpointer task_data,
+					  GCancellable *cancellable)
+{
+	GPtrArray *pyramids = g_ptr_array_new_with_free_func ((GDestroyNotify) gcm_pyramid_unref);
+
+	/* any that are missing are skipped */
+	for (guint i = 0; i < GCM_VIEWER_MAX_EXAMPLE_IMAGES; i++) {
+		g_autoptr(GdkPixbuf) pixbuf = NULL;
+		g_autofree gchar *filename = NULL;
+		g_autofree gchar *path = NULL;
+		g_autoptr(GError) error = NULL;
+
+		filename = g_strdup_printf ("viewer-example-%02u.png", i);
+		path = g_build_filename (PKGDATADIR, "figures", filename, NULL);
+		pixbuf = gdk_pixbuf_new_from_file (path, &error);
+		if (pixbuf == NULL) {
+			g_warning ("failed to load %s: %s", filename, error->message);
+			continue;
+		}
+		g_ptr_array_add (pyramids, gcm_pyramid_new (pixbuf));
+	}
+	g_task_return_pointer (task, pyramids, (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+gcm_viewer_load_example_images_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GcmViewerPrivate *viewer = (GcmViewerPrivate *) user_data;
+	g_autoptr(GPtrArray) pyramids = g_task_propagate_pointer (G_TASK (res), NULL);
+
+	/* the viewer is closing */
+	viewer->load_tasks--;
+	if (pyramids == NULL)
+		return;
+
+	/* a dropped image may already be shown, and keeps its index */
+	if (viewer->example_images != NULL) {
+		for (guint i = 0; i < pyramids->len; i++)
+			g_ptr_array_add (viewer->example_images,
+					 gcm_pyramid_ref (g_ptr_array_index (pyramids, i)));
+		return;
+	}
+	viewer->example_images = g_steal_pointer (&pyramids);
+	gcm_viewer_set_example_image (viewer);
+	gcm_viewer_update_previews (viewer);
+}
+
+/* decoding every figure takes longer than showing the window */
+static void
+gcm_viewer_load_example_images (GcmViewerPrivate *viewer)
+{
+	g_autoptr(GTask) task = NULL;
+	viewer->load_tasks++;
+	task = g_task_new (NULL, viewer->load_cancellable,
+			   gcm_viewer_load_example_images_cb, viewer);
+	g_task_run_in_thread (task, gcm_viewer_load_example_images_thread_cb);
+}
+
+/* 16 bit images are converted to sRGB before they are quantized, rather than
+ * truncated to 8 bits when they are loaded */
+static GdkPixbuf *
+gcm_viewer_load_image_deep (const gchar *path, GCancellable *cancellable, GError **error)
+{
+	GBytes *icc_data;
+	guint band_rows;
+	guint bpp;
+	guint height;
+	guint width;
+	gsize row_bytes;
+	g_autofree guint8 *band = NULL;
+	g_autoptr(CdIcc) input = NULL;
+	g_autoptr(GcmTiff) tiff = NULL;
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
 
-	filename = g_strdup_printf ("viewer-example-%02u.png", viewer->example_index);
-	path = g_build_filename (PKGDATADIR, "figures", filename, NULL);
+	tiff = gcm_tiff_new_from_file (path, error);
+	if (tiff == NULL)
+		return NULL;
+	if (gcm_tiff_get_bits_per_sample (tiff) != 16) {
+		g_set_error_literal (error, 1, 0, "not a deep image");
+		return NULL;
+	}
+
+	/* images without a profile are taken to be sRGB */
+	icc_data = gcm_tiff_get_icc_data (tiff);
+	if (icc_data != NULL) {
+		input = cd_icc_new ();
+		if (!cd_icc_load_data (input,
+				       g_bytes_get_data (icc_data, NULL),
+				       g_bytes_get_size (icc_data),
+				       CD_ICC_LOAD_FLAGS_NONE,
+				       error))
+			return NULL;
+	}
+
+	width = gcm_tiff_get_width (tiff);
+	height = gcm_tiff_get_height (tiff);
+	bpp = gcm_tiff_get_has_alpha (tiff) ? 4 : 3;
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, bpp == 4, 8, (gint) width, (gint) height);
+	if (pixbuf == NULL) {
+		g_set_error_literal (error, 1, 0, "failed to allocate image");
+		return NULL;
+	}
+
+	/* the strips are not contiguous or aligned in the file */
+	row_bytes = (gsize) width * bpp * 2;
+	band_rows = CLAMP (GCM_VIEWER_LOAD_BAND_SIZE / row_bytes, 1, height);
+	band = g_malloc (band_rows * row_bytes);
+	for (guint y = 0; y < height; y += band_rows) {
+		guint rows = MIN (band_rows, height - y);
+		g_autoptr(GdkPixbuf) dest = NULL;
+
+		for (guint j = 0; j < rows; j++)
+			memcpy (band + j * row_bytes, gcm_tiff_get_row (tiff, y + j), row_bytes);
+		dest = gdk_pixbuf_new_subpixbuf (pixbuf, 0, (gint) y, (gint) width, (gint) rows);
+		if (!gcm_utils_pixbuf_convert_data (band, row_bytes,
+						    gcm_tiff_get_pixel_format (tiff),
+						    dest, input, NULL, NULL,
+						    CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+						    cancellable, error))
+			return NULL;
+	}
+	return g_steal_pointer (&pixbuf);
+}
+
+/* the previews take the source to be sRGB, so convert from the profile
+ * that the loader found */
+static gboolean
+gcm_viewer_load_image_convert_embedded (GdkPixbuf *pixbuf,
+					GCancellable *cancellable,
+					GError **error)
+{
+	const gchar *option = gdk_pixbuf_get_option (pixbuf, "icc-profile");
+	gsize len = 0;
+	g_autofree guchar *data = NULL;
+	g_autoptr(CdIcc) input = NULL;
+
+	if (option == NULL)
+		return TRUE;
+	data = g_base64_decode (option, &len);
+	input = cd_icc_new ();
+	if (!cd_icc_load_data (input, data, len, CD_ICC_LOAD_FLAGS_NONE, error))
+		return FALSE;
+
+	/* the loader has already converted CMYK and gray to RGB */
+	if (cd_icc_get_colorspace (input) != CD_COLORSPACE_RGB) {
+		g_set_error_literal (error, 1, 0, "not an RGB profile");
+		return FALSE;
+	}
+	return gcm_utils_pixbuf_convert (pixbuf, pixbuf, input, NULL, NULL,
+					 CD_RENDERING_INTENT_PERCEPTUAL, FALSE,
+					 cancellable, error);
+}
+
+static void
+gcm_viewer_load_image_thread_cb (GTask *task,
+				 gpointer source_object,
+				 gpointer task_data,
+				 GCancellable *cancellable)
+{
+	GFile *file = G_FILE (task_data);
+	g_autofree gchar *path = g_file_get_path (file);
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
+	g_autoptr(GdkPixbuf) rotated = NULL;
+	GError *error = NULL;
+	g_autoptr(GError) error_deep = NULL;
+	g_autoptr(GError) error_icc = NULL;
+
+	pixbuf = gcm_viewer_load_image_deep (path, cancellable, &error_deep);
+	if (pixbuf != NULL) {
+		g_task_return_pointer (task, gcm_pyramid_new (pixbuf),
+				       (GDestroyNotify) gcm_pyramid_unref);
+		return;
+	}
+	g_debug ("loading %s as 8 bit: %s", path, error_deep->message);
 	pixbuf = gdk_pixbuf_new_from_file (path, &error);
 	if (pixbuf == NULL) {
-		g_warning ("failed to load %s: %s", filename, error->message);
+		g_task_return_error (task, error);
 		return;
 	}
-	gtk_image_set_from_pixbuf (image, pixbuf);
+	if (!gcm_viewer_load_image_convert_embedded (pixbuf, cancellable, &error_icc))
+		g_debug ("ignoring the profile in %s: %s", path, error_icc->message);
+
+	/* photos are often stored sideways */
+	rotated = gdk_pixbuf_apply_embedded_orientation (pixbuf);
+	g_task_return_pointer (task, gcm_pyramid_new (rotated),
+			       (GDestroyNotify) gcm_pyramid_unref);
+}
+
+static void
+gcm_viewer_load_image_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GcmViewerPrivate *viewer = (GcmViewerPrivate *) user_data;
+	GcmPyramid *pyramid;
+	g_autoptr(GError) error = NULL;
+
+	viewer->load_tasks--;
+	pyramid = g_task_propagate_pointer (G_TASK (res), &error);
+	if (pyramid == NULL) {
+		/* the viewer is closing */
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			return;
+		g_warning ("failed to load image: %s", error->message);
+		return;
+	}
+
+	/* show the dropped image in all the previews */
+	if (viewer->example_images == NULL)
+		viewer->example_images = g_ptr_array_new_with_free_func ((GDestroyNotify) gcm_pyramid_unref);
+	g_ptr_array_add (viewer->example_images, pyramid);
+	viewer->example_index = viewer->example_images->len - 1;
+	gcm_viewer_set_example_image (viewer);
+	gcm_viewer_update_previews (viewer);
+}
+
+/* large photos take a while to decode and shrink */
+static void
+gcm_viewer_load_image (GcmViewerPrivate *viewer, GFile *file)
+{
+	g_autoptr(GTask) task = NULL;
+	viewer->load_tasks++;
+	task = g_task_new (NULL, viewer->load_cancellable,
+			   gcm_viewer_load_image_cb, viewer);
+	g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+	g_task_run_in_thread (task, gcm_viewer_load_image_thread_cb);
+}
+
+static void
+gcm_viewer_notebook_size_allocate_cb (GtkWidget *widget,
+				      GdkRectangle *allocation,
+				      GcmViewerPrivate *viewer)
+{
+	GcmViewerPreview *previews[] = { viewer->preview_input,
+					 viewer->preview_output,
+					 viewer->preview_proof };
+	gboolean changed = FALSE;
+
+	for (guint i = 0; i < G_N_ELEMENTS (previews); i++) {
+		GcmViewerPreview *preview = previews[i];
+		gint spare;
+		gint width_old;
+		gint width_new;
+		gint height;
+		gint scale;
+
+		/* only grow into room that is already free, otherwise the
+		 * window would have to grow with the preview */
+		if (preview->source == NULL || !gtk_widget_get_mapped (preview->widget))
+			continue;
+		spare = allocation->width - gtk_widget_get_allocated_width (preview->page);
+		if (spare < GCM_VIEWER_PREVIEW_GROW_MIN)
+			continue;
+		gcm_viewer_preview_get_size (preview, &width_old, &height, &scale);
+		preview->max_width = gtk_widget_get_allocated_width (preview->widget) + spare;
+		gcm_viewer_preview_get_size (preview, &width_new, &height, &scale);
+
+		/* already showing all of the source */
+		if (width_new != width_old)
+			changed = TRUE;
+	}
+	if (changed)
+		gcm_viewer_update_previews (viewer);
+}
+
+static void
+gcm_viewer_preview_scale_factor_cb (GObject *object,
+				    GParamSpec *pspec,
+				    GcmViewerPrivate *viewer)
+{
+	gcm_viewer_update_previews (viewer);
+}
+
+static void
+gcm_viewer_gamut_warning_toggled_cb (GtkToggleButton *toggle, GcmViewerPrivate *viewer)
+{
+	gcm_viewer_update_previews (viewer);
+}
+
+static void
+gcm_viewer_heatmap_toggled_cb (GtkToggleButton *toggle, GcmViewerPrivate *viewer)
+{
+	GtkToggleButton *toggle_input;
+	GtkToggleButton *toggle_output;
+
+	toggle_input = GTK_TOGGLE_BUTTON (gtk_builder_get_object (viewer->builder,
+								  "checkbutton_heatmap_input"));
+	toggle_output = GTK_TOGGLE_BUTTON (gtk_builder_get_object (viewer->builder,
+								   "checkbutton_heatmap_output"));
+	viewer->preview_input->heatmap = gtk_toggle_button_get_active (toggle_input);
+	viewer->preview_output->heatmap = gtk_toggle_button_get_active (toggle_output);
+	gcm_viewer_update_previews (viewer);
 }
 
 static void
 gcm_viewer_image_next_cb (GtkWidget *widget, GcmViewerPrivate *viewer)
 {
+	if (viewer->example_images == NULL || viewer->example_images->len == 0)
+		return;
 	viewer->example_index++;
-	if (viewer->example_index == GCM_VIEWER_MAX_EXAMPLE_IMAGES)
+	if (viewer->example_index == viewer->example_images->len)
 		viewer->example_index = 0;
-	gcm_viewer_set_example_image (viewer, GTK_IMAGE (viewer->preview_widget_input));
-	gcm_viewer_set_example_image (viewer, GTK_IMAGE (viewer->preview_widget_output));
+	gcm_viewer_set_example_image (viewer);
+	gcm_viewer_update_previews (viewer);
 }
 
 static void
 gcm_viewer_image_prev_cb (GtkWidget *widget, GcmViewerPrivate *viewer)
 {
+	if (viewer->example_images == NULL || viewer->example_images->len == 0)
+		return;
 	if (viewer->example_index == 0)
-		viewer->example_index = GCM_VIEWER_MAX_EXAMPLE_IMAGES;
+		viewer->example_index = viewer->example_images->len;
 	viewer->example_index--;
-	gcm_viewer_set_example_image (viewer, GTK_IMAGE (viewer->preview_widget_input));
-	gcm_viewer_set_example_image (viewer, GTK_IMAGE (viewer->preview_widget_output));
+	gcm_viewer_set_example_image (viewer);
+	gcm_viewer_update_previews (viewer);
 }
 
 static const gchar *
@@ -430,6 +1855,17 @@ gcm_viewer_profile_import_cb (GtkWidget *widget, GcmViewerPrivate *viewer)
 	gcm_viewer_profile_import_file (viewer, file);
 }
 
+static gboolean
+gcm_viewer_is_image_file (GFile *file)
+{
+	g_autofree gchar *path = g_file_get_path (file);
+
+	/* only the header is read */
+	if (path == NULL)
+		return FALSE;
+	return gdk_pixbuf_get_file_info (path, NULL, NULL) != NULL;
+}
+
 static void
 gcm_viewer_drag_data_received_cb (GtkWidget *widget, GdkDragContext *context, gint x, gint y, GtkSelectionData *data, guint _time, GcmViewerPrivate *viewer)
 {
@@ -459,6 +1895,13 @@ gcm_viewer_drag_data_received_cb (GtkWidget *widget, GdkDragContext *context, gi
 		/* convert the URI */
 		file = g_file_new_for_uri (filenames[i]);
 
+		/* preview images with the selected profile */
+		if (gcm_viewer_is_image_file (file)) {
+			gcm_viewer_load_image (viewer, file);
+			success = TRUE;
+			continue;
+		}
+
 		/* try to import it */
 		ret = gcm_viewer_profile_import_file (viewer, file);
 		if (ret)
@@ -614,25 +2057,23 @@ gcm_viewer_profile_colorspace_to_string (CdColorspace colorspace)
 static gboolean
 gcm_viewer_add_named_colors (GcmViewerPrivate *viewer, CdIcc *icc)
 {
-	CdColorSwatch *nc;
-	GPtrArray *ncs = NULL;
-	GtkTreeIter iter;
-	guint i;
+	GtkWidget *widget;
+	g_autoptr(GPtrArray) ncs = NULL;
 
-	/* get profile named colors */
-	gtk_list_store_clear (viewer->liststore_nc);
+	/* the model is backed by the array itself, rows are only read
+	 * when visible so detach the view rather than emitting a signal
+	 * for each of the possibly tens of thousands of colors */
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder,
+						     "entry_named_colors_search"));
+	gtk_entry_set_text (GTK_ENTRY (widget), "");
+	g_clear_pointer (&viewer->index_nc, gcm_named_color_index_free);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder,
+						     "treeview_named_colors"));
+	gtk_tree_view_set_model (GTK_TREE_VIEW (widget), NULL);
 	ncs = cd_icc_get_named_colors (icc);
-	for (i = 0; i < ncs->len; i++) {
-		nc = g_ptr_array_index (ncs, i);
-		gtk_list_store_append (viewer->liststore_nc, &iter);
-		gtk_list_store_set (viewer->liststore_nc,
-				    &iter,
-				    GCM_NAMED_COLORS_COLUMN_SORT, "1",
-				    GCM_NAMED_COLORS_COLUMN_TITLE, cd_color_swatch_get_name (nc),
-				    GCM_NAMED_COLORS_COLUMN_COLOR, cd_color_swatch_get_value (nc),
-				    -1);
-	}
-	g_ptr_array_unref (ncs);
+	gcm_named_color_model_set_colors (viewer->model_nc, ncs);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (widget),
+				 GTK_TREE_MODEL (viewer->model_nc));
 	return TRUE;
 }
 
@@ -854,6 +2295,9 @@ gcm_viewer_set_profile (GcmViewerPrivate *viewer, CdProfile *profile)
 	guint filesize;
 	gboolean show_section_to = FALSE;
 	gboolean show_section_from = FALSE;
+	gboolean show_section_proof = FALSE;
+	gboolean show_section_intents = FALSE;
+	gboolean show_section_ramps = FALSE;
 	gchar **warnings;
 	guint i;
 	CdProfileWarning warning;
@@ -885,19 +2329,21 @@ gcm_viewer_set_profile (GcmViewerPrivate *viewer, CdProfile *profile)
 	    cd_profile_get_kind (profile) != CD_PROFILE_KIND_NAMED_COLOR) {
 		show_section_to = TRUE;
 		show_section_from = TRUE;
-		/* profile -> sRGB */
-		gcm_utils_image_convert (GTK_IMAGE (viewer->preview_widget_input),
-					 icc, NULL, NULL, NULL);
-		/* sRGB -> profile */
-		gcm_utils_image_convert (GTK_IMAGE (viewer->preview_widget_output),
-					 NULL, NULL, icc, NULL);
 	} else if (cd_profile_get_colorspace (profile) == CD_COLORSPACE_LAB &&
 		   cd_profile_get_kind (profile) != CD_PROFILE_KIND_NAMED_COLOR) {
-		/* sRGB -> profile -> sRGB */
-		gcm_utils_image_convert (GTK_IMAGE (viewer->preview_widget_input),
-					 NULL, icc, NULL, NULL);
 		show_section_to = TRUE;
 	}
+	if (cd_profile_get_kind (profile) == CD_PROFILE_KIND_OUTPUT_DEVICE)
+		show_section_proof = TRUE;
+	if (cd_profile_get_kind (profile) == CD_PROFILE_KIND_DISPLAY_DEVICE &&
+	    cd_profile_get_colorspace (profile) == CD_COLORSPACE_RGB)
+		show_section_ramps = TRUE;
+	if (cd_profile_get_kind (profile) != CD_PROFILE_KIND_NAMED_COLOR &&
+	    cd_profile_get_kind (profile) != CD_PROFILE_KIND_DEVICELINK)
+		show_section_intents = TRUE;
+	g_clear_object (&viewer->preview_icc);
+	viewer->preview_icc = g_object_ref (icc);
+	gcm_viewer_update_previews (viewer);
 
 	/* setup cie widget */
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_cie"));
@@ -912,7 +2358,9 @@ gcm_viewer_set_profile (GcmViewerPrivate *viewer, CdProfile *profile)
 
 	/* get curve data */
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_trc"));
+	gcm_utils_icc_lock ();
 	clut_trc = cd_icc_get_response (icc, 256, NULL);
+	gcm_utils_icc_unlock ();
 	if (clut_trc != NULL) {
 		g_object_set (viewer->trc_widget,
 			      "data", clut_trc,
@@ -924,7 +2372,9 @@ gcm_viewer_set_profile (GcmViewerPrivate *viewer, CdProfile *profile)
 
 	/* get vcgt data */
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_vcgt"));
+	gcm_utils_icc_lock ();
 	clut_vcgt = cd_icc_get_vcgt (icc, 256, NULL);
+	gcm_utils_icc_unlock ();
 	if (clut_vcgt != NULL) {
 		g_object_set (viewer->vcgt_widget,
 			      "data", clut_vcgt,
@@ -1117,6 +2567,12 @@ gcm_viewer_set_profile (GcmViewerPrivate *viewer, CdProfile *profile)
 	gtk_widget_set_visible (widget, show_section_to);
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_from_srgb"));
 	gtk_widget_set_visible (widget, show_section_from);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_proof"));
+	gtk_widget_set_visible (widget, show_section_proof);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_intents"));
+	gtk_widget_set_visible (widget, show_section_intents);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_ramps"));
+	gtk_widget_set_visible (widget, show_section_ramps);
 }
 
 static void
@@ -1193,29 +2649,29 @@ gcm_viewer_add_named_colors_columns (GcmViewerPrivate *viewer,
 	GtkCellRenderer *renderer;
 	GtkTreeViewColumn *column;
 
-	/* column for text */
+	/* column for text, fixed size so only the visible rows are read */
 	renderer = gtk_cell_renderer_text_new ();
 	g_object_set (renderer,
-		      "wrap-mode", PANGO_WRAP_WORD,
+		      "ellipsize", PANGO_ELLIPSIZE_END,
 		      NULL);
 	column = gtk_tree_view_column_new_with_attributes ("", renderer,
-							   "text", GCM_NAMED_COLORS_COLUMN_TITLE,
+							   "text", GCM_NAMED_COLOR_MODEL_COLUMN_TITLE,
 							   NULL);
-	gtk_tree_view_column_set_sort_column_id (column, GCM_NAMED_COLORS_COLUMN_SORT);
-	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (viewer->liststore_nc),
-					      GCM_NAMED_COLORS_COLUMN_SORT,
-					      GTK_SORT_ASCENDING);
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
 	gtk_tree_view_append_column (treeview, column);
 	gtk_tree_view_column_set_expand (column, TRUE);
 
-	/* image */
+	/* image, sharing the width of the view with the text as fixed
+	 * height mode cannot measure the rows */
 	renderer = gcm_cell_renderer_color_new ();
 	g_object_set (renderer, "stock-size", GTK_ICON_SIZE_MENU, NULL);
 	column = gtk_tree_view_column_new_with_attributes ("", renderer,
-							   "color", GCM_NAMED_COLORS_COLUMN_COLOR,
+							   "color", GCM_NAMED_COLOR_MODEL_COLUMN_COLOR,
 							   NULL);
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
 	gtk_tree_view_append_column (treeview, column);
-	gtk_tree_view_column_set_expand (column, FALSE);
+	gtk_tree_view_column_set_expand (column, TRUE);
+	gtk_tree_view_set_fixed_height_mode (treeview, TRUE);
 }
 
 static void
@@ -1247,6 +2703,86 @@ gcm_viewer_add_metadata_columns (GcmViewerPrivate *viewer,
 	gtk_tree_view_column_set_expand (column, TRUE);
 }
 
+static void
+gcm_viewer_named_colors_search_cb (GtkSearchEntry *entry, GcmViewerPrivate *viewer)
+{
+	GtkWidget *widget;
+	const gchar *query;
+	g_autoptr(GArray) results = NULL;
+
+	if (viewer->model_nc->colors == NULL)
+		return;
+
+	/* only index the names when the user actually searches */
+	query = gtk_entry_get_text (GTK_ENTRY (entry));
+	if (viewer->index_nc == NULL && query[0] != '\0')
+		viewer->index_nc = gcm_named_color_index_new (viewer->model_nc->colors);
+	if (viewer->index_nc != NULL)
+		results = gcm_named_color_index_search (viewer->index_nc, query);
+
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder,
+						     "treeview_named_colors"));
+	gtk_tree_view_set_model (GTK_TREE_VIEW (widget), NULL);
+	gcm_named_color_model_set_filter (viewer->model_nc, results);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (widget),
+				 GTK_TREE_MODEL (viewer->model_nc));
+}
+
+static void
+gcm_viewer_named_colors_export_cb (GtkWidget *widget, GcmViewerPrivate *viewer)
+{
+	GtkFileFilter *filter;
+	GtkWidget *dialog;
+	GtkWindow *window;
+	const gchar *title;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+
+	if (viewer->model_nc->colors == NULL)
+		return;
+
+	/* create new dialog */
+	window = GTK_WINDOW(gtk_builder_get_object (viewer->builder, "dialog_viewer"));
+	/* TRANSLATORS: dialog for exporting the named colors */
+	dialog = gtk_file_chooser_dialog_new (_("Export Palette"), window,
+					       GTK_FILE_CHOOSER_ACTION_SAVE,
+					       _("_Cancel"), GTK_RESPONSE_CANCEL,
+					       _("_Export"), GTK_RESPONSE_ACCEPT,
+					      NULL);
+	gtk_window_set_icon_name (GTK_WINDOW (dialog), GCM_STOCK_ICON);
+	gtk_file_chooser_set_do_overwrite_confirmation (GTK_FILE_CHOOSER(dialog), TRUE);
+	gtk_file_chooser_set_current_folder (GTK_FILE_CHOOSER(dialog), g_get_home_dir ());
+	title = gtk_window_get_title (window);
+	filename = g_strdup_printf ("%s.gpl", title != NULL ? title : "palette");
+	g_strdelimit (filename, G_DIR_SEPARATOR_S, '_');
+	gtk_file_chooser_set_current_name (GTK_FILE_CHOOSER(dialog), filename);
+
+	/* setup the filter */
+	filter = gtk_file_filter_new ();
+	gtk_file_filter_add_pattern (filter, "*.gpl");
+	gtk_file_filter_add_pattern (filter, "*.ase");
+	gtk_file_filter_add_pattern (filter, "*.cxf");
+	/* TRANSLATORS: filter name on the export dialog */
+	gtk_file_filter_set_name (filter, _("GIMP, Adobe and CxF palettes"));
+	gtk_file_chooser_add_filter (GTK_FILE_CHOOSER(dialog), filter);
+
+	/* did user choose file */
+	if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT)
+		file = gtk_file_chooser_get_file (GTK_FILE_CHOOSER(dialog));
+	gtk_widget_destroy (dialog);
+	if (file == NULL)
+		return;
+
+	/* write the swatches straight to the file */
+	if (!gcm_palette_export_file (viewer->model_nc->colors, title,
+				      file, NULL, &error)) {
+		/* TRANSLATORS: could not write the palette file */
+		gcm_viewer_error_dialog (viewer, _("Failed to export palette"), error->message);
+		return;
+	}
+}
+
 static void
 gcm_viewer_named_color_treeview_clicked (GtkTreeSelection *selection, GcmViewerPrivate *viewer)
 {
@@ -1428,21 +2964,47 @@ gcm_viewer_startup_cb (GApplication *application, GcmViewerPrivate *viewer)
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_image_prev1"));
 	g_signal_connect (widget, "clicked",
 			  G_CALLBACK (gcm_viewer_image_prev_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_image_next2"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_image_next_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_image_prev2"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_image_prev_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_image_next3"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_image_next_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_image_prev3"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_image_prev_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "checkbutton_gamut_warning"));
+	g_signal_connect (widget, "toggled",
+			  G_CALLBACK (gcm_viewer_gamut_warning_toggled_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "checkbutton_heatmap_input"));
+	g_signal_connect (widget, "toggled",
+			  G_CALLBACK (gcm_viewer_heatmap_toggled_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "checkbutton_heatmap_output"));
+	g_signal_connect (widget, "toggled",
+			  G_CALLBACK (gcm_viewer_heatmap_toggled_cb), viewer);
 
 	/* use named colors */
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder,
 						     "treeview_named_colors"));
-	viewer->liststore_nc = gtk_list_store_new (GCM_NAMED_COLORS_COLUMN_LAST,
-					       G_TYPE_STRING,
-					       G_TYPE_STRING,
-					       CD_TYPE_COLOR_XYZ);
+	viewer->model_nc = gcm_named_color_model_new ();
 	gtk_tree_view_set_model (GTK_TREE_VIEW (widget),
-				 GTK_TREE_MODEL (viewer->liststore_nc));
+				 GTK_TREE_MODEL (viewer->model_nc));
 	gcm_viewer_add_named_colors_columns (viewer, GTK_TREE_VIEW (widget));
 	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (widget));
 	gtk_tree_selection_set_mode (selection, GTK_SELECTION_BROWSE);
 	g_signal_connect (selection, "changed",
 			  G_CALLBACK (gcm_viewer_named_color_treeview_clicked), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder,
+						     "entry_named_colors_search"));
+	g_signal_connect (widget, "search-changed",
+			  G_CALLBACK (gcm_viewer_named_colors_search_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder,
+						     "button_named_colors_export"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_named_colors_export_cb), viewer);
 
 	/* use metadata */
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder,
@@ -1473,18 +3035,62 @@ gcm_viewer_startup_cb (GApplication *application, GcmViewerPrivate *viewer)
 	gtk_box_reorder_child (GTK_BOX(widget), viewer->vcgt_widget, 0);
 
 	/* use preview input */
-	viewer->preview_widget_input = GTK_WIDGET (gtk_image_new ());
+	viewer->preview_input = gcm_viewer_preview_new ();
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_preview_input"));
-	gtk_box_pack_end (GTK_BOX(widget), viewer->preview_widget_input, FALSE, FALSE, 0);
-	gcm_viewer_set_example_image (viewer, GTK_IMAGE (viewer->preview_widget_input));
-	gtk_widget_set_visible (viewer->preview_widget_input, TRUE);
+	gtk_box_pack_end (GTK_BOX(widget), viewer->preview_input->widget, FALSE, FALSE, 0);
+	gtk_widget_set_visible (viewer->preview_input->widget, TRUE);
 
 	/* use preview output */
-	viewer->preview_widget_output = GTK_WIDGET (gtk_image_new ());
+	viewer->preview_output = gcm_viewer_preview_new ();
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_preview_output"));
-	gtk_box_pack_end (GTK_BOX(widget), viewer->preview_widget_output, FALSE, FALSE, 0);
-	gcm_viewer_set_example_image (viewer, GTK_IMAGE (viewer->preview_widget_output));
-	gtk_widget_set_visible (viewer->preview_widget_output, TRUE);
+	gtk_box_pack_end (GTK_BOX(widget), viewer->preview_output->widget, FALSE, FALSE, 0);
+	gtk_widget_set_visible (viewer->preview_output->widget, TRUE);
+
+	/* use preview proof */
+	viewer->preview_proof = gcm_viewer_preview_new ();
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_preview_proof"));
+	gtk_box_pack_end (GTK_BOX(widget), viewer->preview_proof->widget, FALSE, FALSE, 0);
+	gtk_widget_set_visible (viewer->preview_proof->widget, TRUE);
+
+	/* zoom into the selected image */
+	viewer->zoom_area = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "drawingarea_zoom"));
+	viewer->zoom_cancellable = g_cancellable_new ();
+	g_signal_connect (viewer->zoom_area, "draw",
+			  G_CALLBACK (gcm_viewer_zoom_draw_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_zoom_in"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_zoom_in_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_zoom_out"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_zoom_out_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_zoom_fit"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_zoom_fit_cb), viewer);
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "button_zoom_original"));
+	g_signal_connect (widget, "clicked",
+			  G_CALLBACK (gcm_viewer_zoom_original_cb), viewer);
+
+	/* show banding in gradients */
+	viewer->ramps_image = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "image_ramps"));
+	viewer->ramps_cancellable = g_cancellable_new ();
+
+	/* use intent comparison */
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "grid_intents"));
+	viewer->grid_intents = gcm_viewer_grid_new (GTK_GRID (widget));
+	viewer->load_cancellable = g_cancellable_new ();
+	gcm_viewer_load_example_images (viewer);
+
+	/* convert at the displayed size */
+	viewer->preview_input->page = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_from_srgb"));
+	viewer->preview_output->page = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_to_srgb"));
+	viewer->preview_proof->page = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "vbox_proof"));
+	viewer->preview_input->label_stats = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "label_heatmap_input"));
+	viewer->preview_output->label_stats = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "label_heatmap_output"));
+	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder, "notebook1"));
+	g_signal_connect (widget, "size-allocate",
+			  G_CALLBACK (gcm_viewer_notebook_size_allocate_cb), viewer);
+	g_signal_connect (viewer->preview_input->widget, "notify::scale-factor",
+			  G_CALLBACK (gcm_viewer_preview_scale_factor_cb), viewer);
 
 	/* make profiles toolbar sexy */
 	widget = GTK_WIDGET (gtk_builder_get_object (viewer->builder,
@@ -1581,6 +3187,44 @@ gcm_viewer_startup_cb (GApplication *application, GcmViewerPrivate *viewer)
 	gcm_viewer_update_profile_list (viewer);
 }
 
+/* every task that uses the viewer has to finish before it is freed, and the
+ * threads write into the buffers of busy previews until their callbacks run,
+ * so once everything is cancelled let the callbacks finish */
+static void
+gcm_viewer_wait_for_tasks (GcmViewerPrivate *viewer)
+{
+	GcmViewerPreview *previews[] = { viewer->preview_input,
+					 viewer->preview_output,
+					 viewer->preview_proof };
+	gboolean busy = TRUE;
+
+	for (guint i = 0; i < G_N_ELEMENTS (previews); i++) {
+		if (previews[i] == NULL)
+			continue;
+		previews[i]->pending = FALSE;
+		g_cancellable_cancel (previews[i]->cancellable);
+	}
+	if (viewer->grid_intents != NULL) {
+		viewer->grid_intents->pending = FALSE;
+		g_cancellable_cancel (viewer->grid_intents->cancellable);
+	}
+	g_cancellable_cancel (viewer->zoom_cancellable);
+	g_cancellable_cancel (viewer->load_cancellable);
+	g_cancellable_cancel (viewer->ramps_cancellable);
+	while (busy) {
+		busy = viewer->zoom_tasks > 0 || viewer->load_tasks > 0 ||
+		       viewer->ramps_tasks > 0;
+		if (viewer->grid_intents != NULL && viewer->grid_intents->busy)
+			busy = TRUE;
+		for (guint i = 0; i < G_N_ELEMENTS (previews); i++) {
+			if (previews[i] != NULL && previews[i]->busy)
+				busy = TRUE;
+		}
+		if (busy)
+			g_main_context_iteration (NULL, TRUE);
+	}
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1640,11 +3284,33 @@ main (int argc, char **argv)
 	/* wait */
 	status = g_application_run (G_APPLICATION (viewer->application), argc, argv);
 
+	gcm_viewer_wait_for_tasks (viewer);
 	g_object_unref (viewer->application);
 	if (viewer->builder != NULL)
 		g_object_unref (viewer->builder);
 	if (viewer->client != NULL)
 		g_object_unref (viewer->client);
+	if (viewer->model_nc != NULL)
+		g_object_unref (viewer->model_nc);
+	if (viewer->preview_icc != NULL)
+		g_object_unref (viewer->preview_icc);
+	if (viewer->preview_input != NULL)
+		gcm_viewer_preview_free (viewer->preview_input);
+	if (viewer->preview_output != NULL)
+		gcm_viewer_preview_free (viewer->preview_output);
+	if (viewer->preview_proof != NULL)
+		gcm_viewer_preview_free (viewer->preview_proof);
+	if (viewer->grid_intents != NULL)
+		gcm_viewer_grid_free (viewer->grid_intents);
+	if (viewer->zoom_cancellable != NULL)
+		g_object_unref (viewer->zoom_cancellable);
+	if (viewer->load_cancellable != NULL)
+		g_object_unref (viewer->load_cancellable);
+	if (viewer->ramps_cancellable != NULL)
+		g_object_unref (viewer->ramps_cancellable);
+	if (viewer->example_images != NULL)
+		g_ptr_array_unref (viewer->example_images);
+	gcm_named_color_index_free (viewer->index_nc);
 	g_free (viewer->profile_id);
 	g_free (viewer->filename);
 	g_free (viewer);